@@ -1,6 +1,8 @@
 #pragma once
 
+#include <memory>
 #include <optional>
+#include <type_traits>
 
 namespace pbpt {
 
@@ -40,4 +42,9 @@ concept Iterable = requires(T x) { std::begin(x), std::end(x); };
 template <typename T>
 concept Indexable = requires(T x) { x[std::declval<std::size_t>()]; };
 
+// Asks the cache to start loading the object; a no-op in constant expressions.
+constexpr auto prefetch(const auto &object) {
+  if (!std::is_constant_evaluated()) __builtin_prefetch(std::addressof(object));
+}
+
 }  // namespace pbpt
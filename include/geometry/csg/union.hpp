@@ -4,106 +4,108 @@
 
 namespace pbpt::geometry::csg {
 
-template <typename Geometry1, typename Geometry2>
-struct Union : std::pair<Geometry1, Geometry2> {
-  using std::pair<Geometry1, Geometry2>::pair;
-
-  constexpr auto intersect(const auto &ray) const {
-    auto occupations_1 = this->first.intersect(ray);
-    auto occupations_2 = this->second.intersect(ray);
+// Occupations of the union of two geometries along a ray, from the occupations of each along the same ray.
+template <typename Occupations>
+constexpr auto unite(Occupations occupations_1, auto occupations_2) {
+  Occupations occupations;
 
-    decltype(occupations_1) occupations;
+  auto invert_normal = [&]<typename Intersection>(const Intersection &intersection) constexpr -> Intersection {
+    auto inverted_normal_evaluator = [normal_evaluator = intersection.surface().normal_evaluator()](
+                                         const auto &position
+                                     ) constexpr { return -normal_evaluator(position); };
+    typename Intersection::second_type surface(inverted_normal_evaluator, intersection.surface().material_reference());
+    return {intersection.distance(), std::move(surface)};
+  };
 
-    auto invert_normal = [&]<typename Intersection>(const Intersection &intersection) constexpr -> Intersection {
-      auto inverted_normal_evaluator = [normal_evaluator = intersection.surface().normal_evaluator(
-                                        )](const auto &position) constexpr { return -normal_evaluator(position); };
-      typename Intersection::second_type surface(
-          inverted_normal_evaluator, intersection.surface().material_reference()
-      );
-      return {intersection.distance(), std::move(surface)};
-    };
-
-    while (!occupations_1.empty() && !occupations_2.empty()) {
-      if (occupations_1.top().min().distance() < occupations_2.top().min().distance()
-              ? occupations_1.top().max().distance() > occupations_2.top().min().distance()
-              : occupations_1.top().min().distance() < occupations_2.top().max().distance()) {
-        if (occupations_1.top().min().distance() < occupations_2.top().min().distance()) {
-          /**********************************
-           *   <-------1------->             *
-           *            <-------2------->    *
-           *   <---1---><-------2------->    *
-           **********************************/
-          if (occupations_1.top().max().distance() < occupations_2.top().max().distance()) {
-            occupations.emplace(occupations_1.top().min(), invert_normal(occupations_2.top().min()));
-            occupations_1.pop();
-          }
-          /**********************************
-           *   <------------1------------>   *
-           *        <-------2------->        *
-           *   <-1-><-------2-------><-1->   *
-           **********************************/
-          else {
-            occupations_1.emplace(invert_normal(occupations_2.top().max()), occupations_1.top().max());
-            occupations.emplace(occupations_1.top().min(), invert_normal(occupations_2.top().min()));
-            occupations_1.pop();
-            occupations.push(occupations_2.top());
-            occupations_2.pop();
-          }
-        } else {
-          /**********************************
-           *            <-------1------->    *
-           *   <-------2------->             *
-           *   <---2---><-------1------->    *
-           **********************************/
-          if (occupations_2.top().max().distance() < occupations_1.top().max().distance()) {
-            occupations.emplace(occupations_2.top().min(), invert_normal(occupations_1.top().min()));
-            occupations_2.pop();
-          }
-          /**********************************
-           *        <-------1------->        *
-           *   <------------2------------>   *
-           *   <-2-><-------1-------><-2->   *
-           **********************************/
-          else {
-            occupations_2.emplace(invert_normal(occupations_1.top().max()), occupations_2.top().max());
-            occupations.emplace(occupations_2.top().min(), invert_normal(occupations_1.top().min()));
-            occupations_2.pop();
-            occupations.push(occupations_1.top());
-            occupations_1.pop();
-          }
-        }
-      } else {
+  while (!occupations_1.empty() && !occupations_2.empty()) {
+    if (occupations_1.top().min().distance() < occupations_2.top().min().distance()
+            ? occupations_1.top().max().distance() > occupations_2.top().min().distance()
+            : occupations_1.top().min().distance() < occupations_2.top().max().distance()) {
+      if (occupations_1.top().min().distance() < occupations_2.top().min().distance()) {
         /**********************************
-         *   <---1--->                     *
+         *   <-------1------->             *
          *            <-------2------->    *
          *   <---1---><-------2------->    *
          **********************************/
-        if (occupations_1.top().min().distance() < occupations_2.top().min().distance()) {
-          occupations.push(occupations_1.top());
+        if (occupations_1.top().max().distance() < occupations_2.top().max().distance()) {
+          occupations.emplace(occupations_1.top().min(), invert_normal(occupations_2.top().min()));
           occupations_1.pop();
         }
+        /**********************************
+         *   <------------1------------>   *
+         *        <-------2------->        *
+         *   <-1-><-------2-------><-1->   *
+         **********************************/
+        else {
+          occupations_1.emplace(invert_normal(occupations_2.top().max()), occupations_1.top().max());
+          occupations.emplace(occupations_1.top().min(), invert_normal(occupations_2.top().min()));
+          occupations_1.pop();
+          occupations.push(occupations_2.top());
+          occupations_2.pop();
+        }
+      } else {
         /**********************************
          *            <-------1------->    *
-         *   <---2--->                     *
+         *   <-------2------->             *
          *   <---2---><-------1------->    *
          **********************************/
+        if (occupations_2.top().max().distance() < occupations_1.top().max().distance()) {
+          occupations.emplace(occupations_2.top().min(), invert_normal(occupations_1.top().min()));
+          occupations_2.pop();
+        }
+        /**********************************
+         *        <-------1------->        *
+         *   <------------2------------>   *
+         *   <-2-><-------1-------><-2->   *
+         **********************************/
         else {
-          occupations.push(occupations_2.top());
+          occupations_2.emplace(invert_normal(occupations_1.top().max()), occupations_2.top().max());
+          occupations.emplace(occupations_2.top().min(), invert_normal(occupations_1.top().min()));
           occupations_2.pop();
+          occupations.push(occupations_1.top());
+          occupations_1.pop();
         }
       }
+    } else {
+      /**********************************
+       *   <---1--->                     *
+       *            <-------2------->    *
+       *   <---1---><-------2------->    *
+       **********************************/
+      if (occupations_1.top().min().distance() < occupations_2.top().min().distance()) {
+        occupations.push(occupations_1.top());
+        occupations_1.pop();
+      }
+      /**********************************
+       *            <-------1------->    *
+       *   <---2--->                     *
+       *   <---2---><-------1------->    *
+       **********************************/
+      else {
+        occupations.push(occupations_2.top());
+        occupations_2.pop();
+      }
     }
+  }
 
-    while (!occupations_1.empty()) {
-      occupations.push(occupations_1.top());
-      occupations_1.pop();
-    }
-    while (!occupations_2.empty()) {
-      occupations.push(occupations_2.top());
-      occupations_2.pop();
-    }
+  while (!occupations_1.empty()) {
+    occupations.push(occupations_1.top());
+    occupations_1.pop();
+  }
+  while (!occupations_2.empty()) {
+    occupations.push(occupations_2.top());
+    occupations_2.pop();
+  }
 
-    return occupations;
+  return occupations;
+}
+
+template <typename Geometry1, typename Geometry2>
+struct Union : std::pair<Geometry1, Geometry2> {
+  using std::pair<Geometry1, Geometry2>::pair;
+
+  constexpr auto intersect(const auto &ray) const {
+    return unite(this->first.intersect(ray), this->second.intersect(ray));
   }
 };
 
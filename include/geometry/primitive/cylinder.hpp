@@ -39,7 +39,7 @@ struct Cylinder {
 
   constexpr auto intersect(const auto &ray) const {
     using NormalEvaluator = std::function<Vector<Scalar, 3>(const Vector<Scalar, 3> &)>;
-    using MaterialReference = std::reference_wrapper<const Material<Scalar, Vector>>;
+    using MaterialReference = pbpt::material::material_reference_t<Material<Scalar, Vector>>;
     using OccupationType = Occupation<Scalar, NormalEvaluator, MaterialReference>;
     using OccupationQueue = std::priority_queue<OccupationType, std::vector<OccupationType>, OccupationComparator>;
 
@@ -52,22 +52,28 @@ struct Cylinder {
     };
     auto circle_normal = [this](const auto &position) constexpr -> Vector<Scalar, 3> {
       auto [position_x, position_y, position_z] = position;
-      return {0.0, position_y > 0.0 ? 1.0 : -1.0, 0.0};
+      return {0, Scalar(position_y > 0 ? 1 : -1), 0};
     };
 
     auto cylinder_position = [&]() constexpr -> std::optional<std::pair<Scalar, Scalar>> {
-      auto norm_ray_position = Vector<Scalar, 2>{ray_position_z, ray_position_x} / m_radii;
-      auto norm_ray_direction = Vector<Scalar, 2>{ray_direction_z, ray_direction_x} / m_radii;
+      using Wide = pbpt::math::wide_t<Scalar>;
+      auto norm_ray_position = pbpt::tensor::cast<Wide>(Vector<Scalar, 2>{ray_position_z, ray_position_x} / m_radii);
+      auto norm_ray_direction =
+          pbpt::tensor::cast<Wide>(Vector<Scalar, 2>{ray_direction_z, ray_direction_x} / m_radii);
 
       auto A = pbpt::tensor::dot(norm_ray_direction, norm_ray_direction);
       auto B = pbpt::tensor::dot(norm_ray_direction, norm_ray_position);
-      auto C = pbpt::tensor::dot(norm_ray_position, norm_ray_position);
-      auto D = B * B - A * C + A;
+      auto C = pbpt::tensor::dot(norm_ray_position, norm_ray_position) - 1;
+      // B^2 - AC as A (1 - |p - (B / A) d|^2), which does not cancel for large radii
+      auto perpendicular = norm_ray_position - B / A * norm_ray_direction;
+      auto D = A * (1 - pbpt::tensor::dot(perpendicular, perpendicular));
 
       if (D >= 0) {
-        auto min_distance = (-B - pbpt::math::sqrt(D)) / A;
-        auto max_distance = (-B + pbpt::math::sqrt(D)) / A;
-        return std::make_pair(min_distance, max_distance);
+        // the root farther from the vertex -B / A is taken from the sum, the other one from the product
+        auto Q = -(B + std::copysign(pbpt::math::sqrt(D), B));
+        auto distance_1 = Q / A;
+        auto distance_2 = Q ? C / Q : Wide(0);
+        return std::make_pair(Scalar(std::min(distance_1, distance_2)), Scalar(std::max(distance_1, distance_2)));
       }
       return {};
     };
@@ -76,9 +82,10 @@ struct Cylinder {
       auto [normal_z, normal_x] = pbpt::tensor::normalized(
           Vector<Scalar, 2>{position_z, position_x} / pbpt::tensor::elemwise(pbpt::math::square<Scalar>, m_radii)
       );
-      return Vector<Scalar, 3>{normal_x, 0.0, normal_z};
+      return Vector<Scalar, 3>{normal_x, 0, normal_z};
     };
 
+    auto material_reference = pbpt::material::make_material_reference(material());
     OccupationQueue occupations;
     if (auto intersection = cylinder_position()) {
       auto [min_distance, max_distance] = intersection.value();
@@ -86,21 +93,21 @@ struct Cylinder {
       auto [max_intersection_x, max_intersection_y, max_intersection_z] = ray.at(max_distance);
       if (-m_height <= min_intersection_y && min_intersection_y <= m_height) {
         if (-m_height <= max_intersection_y && max_intersection_y <= m_height) {
-          if (max_distance > 0.0) {
-            Surface<NormalEvaluator, MaterialReference> surface(cylinder_normal, std::cref(material()));
+          if (max_distance > 0) {
+            Surface<NormalEvaluator, MaterialReference> surface(cylinder_normal, material_reference);
             Intersection<Scalar, NormalEvaluator, MaterialReference> min_intersection(min_distance, surface);
             Intersection<Scalar, NormalEvaluator, MaterialReference> max_intersection(max_distance, surface);
             occupations.emplace(std::move(min_intersection), std::move(max_intersection));
           }
         } else if (auto intersection = circle_position(ray_direction_y > 0 ? m_height : -m_height)) {
           auto max_distance = intersection.value();
-          if (max_distance > 0.0) {
+          if (max_distance > 0) {
             auto [max_intersection_x, max_intersection_y, max_intersection_z] = ray.at(max_distance);
             auto max_intersection = Vector<Scalar, 2>{max_intersection_z, max_intersection_x};
             auto norm_max_intersection = max_intersection / m_radii;
-            if (pbpt::tensor::dot(norm_max_intersection, norm_max_intersection) <= 1.0) {
-              Surface<NormalEvaluator, MaterialReference> min_surface(cylinder_normal, std::cref(material()));
-              Surface<NormalEvaluator, MaterialReference> max_surface(circle_normal, std::cref(material()));
+            if (pbpt::tensor::dot(norm_max_intersection, norm_max_intersection) <= 1) {
+              Surface<NormalEvaluator, MaterialReference> min_surface(cylinder_normal, material_reference);
+              Surface<NormalEvaluator, MaterialReference> max_surface(circle_normal, material_reference);
               Intersection<Scalar, NormalEvaluator, MaterialReference> min_intersection(min_distance, min_surface);
               Intersection<Scalar, NormalEvaluator, MaterialReference> max_intersection(max_distance, max_surface);
               occupations.emplace(std::move(min_intersection), std::move(max_intersection));
@@ -108,15 +115,15 @@ struct Cylinder {
           }
         }
       } else if (-m_height <= max_intersection_y && max_intersection_y <= m_height) {
-        if (max_distance > 0.0) {
+        if (max_distance > 0) {
           if (auto intersection = circle_position(ray_direction_y > 0 ? -m_height : m_height)) {
             auto min_distance = intersection.value();
             auto [min_intersection_x, min_intersection_y, min_intersection_z] = ray.at(min_distance);
             auto min_intersection = Vector<Scalar, 2>{min_intersection_z, min_intersection_x};
             auto norm_min_intersection = min_intersection / m_radii;
-            if (pbpt::tensor::dot(norm_min_intersection, norm_min_intersection) <= 1.0) {
-              Surface<NormalEvaluator, MaterialReference> min_surface(circle_normal, std::cref(material()));
-              Surface<NormalEvaluator, MaterialReference> max_surface(cylinder_normal, std::cref(material()));
+            if (pbpt::tensor::dot(norm_min_intersection, norm_min_intersection) <= 1) {
+              Surface<NormalEvaluator, MaterialReference> min_surface(circle_normal, material_reference);
+              Surface<NormalEvaluator, MaterialReference> max_surface(cylinder_normal, material_reference);
               Intersection<Scalar, NormalEvaluator, MaterialReference> min_intersection(min_distance, min_surface);
               Intersection<Scalar, NormalEvaluator, MaterialReference> max_intersection(max_distance, max_surface);
               occupations.emplace(std::move(min_intersection), std::move(max_intersection));
@@ -127,18 +134,18 @@ struct Cylinder {
     } else {
       if (auto intersection = circle_position(ray_direction_y > 0 ? m_height : -m_height)) {
         auto max_distance = intersection.value();
-        if (max_distance > 0.0) {
+        if (max_distance > 0) {
           auto [max_intersection_x, max_intersection_y, max_intersection_z] = ray.at(max_distance);
           auto max_intersection = Vector<Scalar, 2>{max_intersection_z, max_intersection_x};
           auto norm_max_intersection = max_intersection / m_radii;
-          if (pbpt::tensor::dot(norm_max_intersection, norm_max_intersection) <= 1.0) {
+          if (pbpt::tensor::dot(norm_max_intersection, norm_max_intersection) <= 1) {
             if (auto intersection = circle_position(ray_direction_y > 0 ? -m_height : m_height)) {
               auto min_distance = intersection.value();
               auto [min_intersection_x, min_intersection_y, min_intersection_z] = ray.at(min_distance);
               auto min_intersection = Vector<Scalar, 2>{min_intersection_z, min_intersection_x};
               auto norm_min_intersection = min_intersection / m_radii;
-              if (pbpt::tensor::dot(norm_min_intersection, norm_min_intersection) <= 1.0) {
-                Surface<NormalEvaluator, MaterialReference> surface(circle_normal, std::cref(material()));
+              if (pbpt::tensor::dot(norm_min_intersection, norm_min_intersection) <= 1) {
+                Surface<NormalEvaluator, MaterialReference> surface(circle_normal, material_reference);
                 Intersection<Scalar, NormalEvaluator, MaterialReference> min_intersection(min_distance, surface);
                 Intersection<Scalar, NormalEvaluator, MaterialReference> max_intersection(max_distance, surface);
                 occupations.emplace(std::move(min_intersection), std::move(max_intersection));
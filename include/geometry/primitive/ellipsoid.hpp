@@ -1,8 +1,10 @@
 #pragma once
 
 #include <algorithm>
+#include <numbers>
 #include <optional>
 #include <queue>
+#include <tuple>
 #include <utility>
 
 #include "../occupation.hpp"
@@ -34,23 +36,28 @@ struct Ellipsoid {
 
   constexpr auto intersect(const auto &ray) const {
     using NormalEvaluator = std::function<Vector<Scalar, 3>(const Vector<Scalar, 3> &)>;
-    using MaterialReference = std::reference_wrapper<const Material<Scalar, Vector>>;
+    using MaterialReference = pbpt::material::material_reference_t<Material<Scalar, Vector>>;
     using OccupationType = Occupation<Scalar, NormalEvaluator, MaterialReference>;
     using OccupationQueue = std::priority_queue<OccupationType, std::vector<OccupationType>, OccupationComparator>;
 
     auto ellipsoid_position = [&]() constexpr -> std::optional<std::pair<Scalar, Scalar>> {
-      auto norm_ray_position = ray.position() / m_radii;
-      auto norm_ray_direction = ray.direction() / m_radii;
+      using Wide = pbpt::math::wide_t<Scalar>;
+      auto norm_ray_position = pbpt::tensor::cast<Wide>(ray.position() / m_radii);
+      auto norm_ray_direction = pbpt::tensor::cast<Wide>(ray.direction() / m_radii);
 
       auto A = pbpt::tensor::dot(norm_ray_direction, norm_ray_direction);
       auto B = pbpt::tensor::dot(norm_ray_direction, norm_ray_position);
-      auto C = pbpt::tensor::dot(norm_ray_position, norm_ray_position);
-      auto D = B * B - A * C + A;
+      auto C = pbpt::tensor::dot(norm_ray_position, norm_ray_position) - 1;
+      // B^2 - AC as A (1 - |p - (B / A) d|^2), which does not cancel for large radii
+      auto perpendicular = norm_ray_position - B / A * norm_ray_direction;
+      auto D = A * (1 - pbpt::tensor::dot(perpendicular, perpendicular));
 
       if (D >= 0) {
-        auto min_distance = (-B - pbpt::math::sqrt(D)) / A;
-        auto max_distance = (-B + pbpt::math::sqrt(D)) / A;
-        return std::make_pair(min_distance, max_distance);
+        // the root farther from the vertex -B / A is taken from the sum, the other one from the product
+        auto Q = -(B + std::copysign(pbpt::math::sqrt(D), B));
+        auto distance_1 = Q / A;
+        auto distance_2 = Q ? C / Q : Wide(0);
+        return std::make_pair(Scalar(std::min(distance_1, distance_2)), Scalar(std::max(distance_1, distance_2)));
       }
       return {};
     };
@@ -58,11 +65,12 @@ struct Ellipsoid {
       return pbpt::tensor::normalized(position / pbpt::tensor::elemwise(pbpt::math::square<Scalar>, m_radii));
     };
 
+    auto material_reference = pbpt::material::make_material_reference(material());
     OccupationQueue occupations;
     if (auto intersection = ellipsoid_position()) {
       auto [min_distance, max_distance] = intersection.value();
-      if (max_distance > 0.0) {
-        Surface<NormalEvaluator, MaterialReference> surface(ellipsoid_normal, std::cref(material()));
+      if (max_distance > 0) {
+        Surface<NormalEvaluator, MaterialReference> surface(ellipsoid_normal, material_reference);
         Intersection<Scalar, NormalEvaluator, MaterialReference> min_intersection(min_distance, surface);
         Intersection<Scalar, NormalEvaluator, MaterialReference> max_intersection(max_distance, surface);
         occupations.emplace(std::move(min_intersection), std::move(max_intersection));
@@ -71,6 +79,41 @@ struct Ellipsoid {
     return occupations;
   }
 
+  // Point and outward normal of the surface at the image of a uniform point of the unit sphere, (u, v) in [0, 1)^2.
+  constexpr auto sample(Scalar u, Scalar v) const -> std::tuple<Vector<Scalar, 3>, Vector<Scalar, 3>> {
+    auto cos_theta = 1 - 2 * u;
+    auto sin_theta = pbpt::math::sqrt(std::max(1 - pbpt::math::square(cos_theta), Scalar(0)));
+    auto [sin_phi, cos_phi] = pbpt::math::DefaultPolicy::sincos(2 * std::numbers::pi_v<Scalar> * v);
+    auto direction = Vector<Scalar, 3>{sin_theta * cos_phi, sin_theta * sin_phi, cos_theta};
+    return {direction * m_radii, pbpt::tensor::normalized(direction / m_radii)};
+  }
+
+  // Density of sample() per unit area: the unit sphere is stretched by r_x r_y r_z |n / r| around the direction n.
+  constexpr auto pdf(const Vector<Scalar, 3> &position) const -> Scalar {
+    auto [radius_x, radius_y, radius_z] = m_radii;
+    auto stretch = radius_x * radius_y * radius_z * pbpt::tensor::norm(position / (m_radii * m_radii));
+    return 1 / (4 * std::numbers::pi_v<Scalar> * stretch);
+  }
+
+  // Box containing the surface.
+  constexpr auto bounds() const -> std::tuple<Vector<Scalar, 3>, Vector<Scalar, 3>> {
+    return {pbpt::tensor::evaluate(-m_radii), m_radii};
+  }
+
+  // Surface area, by Knud Thomsen's approximation (within 1.1%).
+  constexpr auto area() const {
+    constexpr auto p = Scalar(1.6075);
+    auto [radius_x, radius_y, radius_z] = m_radii;
+    auto power_x = pbpt::math::pow(radius_x, p);
+    auto power_y = pbpt::math::pow(radius_y, p);
+    auto power_z = pbpt::math::pow(radius_z, p);
+    auto mean = (power_x * power_y + power_x * power_z + power_y * power_z) / 3;
+    return 4 * std::numbers::pi_v<Scalar> * pbpt::math::pow(mean, 1 / p);
+  }
+
+  // Cone containing the normals: axis and cosine of its half angle, here every direction.
+  constexpr auto normal_cone() const -> std::tuple<Vector<Scalar, 3>, Scalar> { return {{0, 0, 1}, -1}; }
+
  private:
   Vector<Scalar, 3> m_radii;
   Material<Scalar, Vector> m_material;
@@ -4,6 +4,7 @@
 #include <numbers>
 #include <optional>
 #include <queue>
+#include <tuple>
 #include <utility>
 
 #include "../occupation.hpp"
@@ -35,7 +36,7 @@ struct Plane {
 
   constexpr auto intersect(const auto &ray) const {
     using NormalEvaluator = std::function<Vector<Scalar, 3>(const Vector<Scalar, 3> &)>;
-    using MaterialReference = std::reference_wrapper<const Material<Scalar, Vector>>;
+    using MaterialReference = pbpt::material::material_reference_t<Material<Scalar, Vector>>;
     using OccupationType = Occupation<Scalar, NormalEvaluator, MaterialReference>;
     using OccupationQueue = std::priority_queue<OccupationType, std::vector<OccupationType>, OccupationComparator>;
 
@@ -48,15 +49,16 @@ struct Plane {
     };
     auto plane_normal = [this](const auto &position) constexpr -> Vector<Scalar, 3> { return {0.0, -1.0, 0.0}; };
 
+    auto material_reference = pbpt::material::make_material_reference(material());
     OccupationQueue occupations;
     if (auto intersection = plane_position()) {
       auto distance = intersection.value();
-      if (distance > 0.0) {
+      if (distance > 0) {
         auto [intersection_x, intersection_y, intersection_z] = ray.at(distance);
         auto [depth, width] = m_radii;
         if ((-depth <= intersection_z) && (intersection_z <= depth)) {
           if ((-width <= intersection_x) && (intersection_x <= width)) {
-            Surface<NormalEvaluator, MaterialReference> surface(plane_normal, std::cref(material()));
+            Surface<NormalEvaluator, MaterialReference> surface(plane_normal, material_reference);
             Intersection<Scalar, NormalEvaluator, MaterialReference> min_intersection(distance, surface);
             Intersection<Scalar, NormalEvaluator, MaterialReference> max_intersection(distance, surface);
             occupations.emplace(std::move(min_intersection), std::move(max_intersection));
@@ -67,6 +69,32 @@ struct Plane {
     return occupations;
   }
 
+  // Uniform point of the rectangle for (u, v) in [0, 1)^2, with the normal of the lit side.
+  constexpr auto sample(Scalar u, Scalar v) const -> std::tuple<Vector<Scalar, 3>, Vector<Scalar, 3>> {
+    auto [depth, width] = m_radii;
+    return {{(2 * v - 1) * width, 0, (2 * u - 1) * depth}, {0, -1, 0}};
+  }
+
+  // Density of sample() per unit area.
+  constexpr auto pdf(const Vector<Scalar, 3> &position) const -> Scalar {
+    auto [depth, width] = m_radii;
+    return 1 / (4 * depth * width);
+  }
+
+  // Box containing the surface.
+  constexpr auto bounds() const -> std::tuple<Vector<Scalar, 3>, Vector<Scalar, 3>> {
+    auto [depth, width] = m_radii;
+    return {{-width, 0, -depth}, {width, 0, depth}};
+  }
+
+  constexpr auto area() const {
+    auto [depth, width] = m_radii;
+    return 4 * depth * width;
+  }
+
+  // Cone containing the normals: axis and cosine of its half angle, here the normal of the lit side alone.
+  constexpr auto normal_cone() const -> std::tuple<Vector<Scalar, 3>, Scalar> { return {{0, -1, 0}, 1}; }
+
  private:
   Vector<Scalar, 2> m_radii;
   Material<Scalar, Vector> m_material;
@@ -50,7 +50,7 @@ struct Rotation {
 };
 
 template <
-    typename Geometry, typename Scalar = double, template <typename, auto, auto> typename Matrix = pbpt::tensor::Matrix>
+    typename Scalar = double, template <typename, auto, auto> typename Matrix = pbpt::tensor::Matrix, typename Geometry>
 constexpr auto make_rotation(Geometry &&geometry, auto &&...args) {
   return Rotation<std::decay_t<Geometry>, Scalar, Matrix>(
       std::forward<Geometry>(geometry), std::forward<decltype(args)>(args)...
@@ -62,9 +62,9 @@ template <
     template <typename, auto, auto> typename Matrix = pbpt::tensor::Matrix>
 constexpr auto make_rotation_matrix(const auto &axis, auto angle) {
   auto [x, y, z] = axis;
-  auto cos = std::cos(angle);
-  auto sin = std::sin(angle);
-  return (1.0 - cos) *
+  auto cos = Scalar(std::cos(angle));
+  auto sin = Scalar(std::sin(angle));
+  return (1 - cos) *
              Matrix<Scalar, 3, 3>{
                  Vector<Scalar, 3>{x * x, x * y, x * z}, Vector<Scalar, 3>{y * x, y * y, y * z},
                  Vector<Scalar, 3>{z * x, z * y, z * z}
@@ -53,7 +53,7 @@ struct Translation {
   Vector<Scalar, 3> m_translation;
 };
 
-template <typename Geometry, typename Scalar = double, template <typename, auto> typename Vector = pbpt::tensor::Vector>
+template <typename Scalar = double, template <typename, auto> typename Vector = pbpt::tensor::Vector, typename Geometry>
 constexpr auto make_translation(Geometry &&geometry, auto &&...args) {
   return Translation<std::decay_t<Geometry>, Scalar, Vector>(
       std::forward<Geometry>(geometry), std::forward<decltype(args)>(args)...
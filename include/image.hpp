@@ -1 +1,3 @@
+#include "image/accumulator.hpp"
+#include "image/pfm.hpp"
 #include "image/ppm.hpp"
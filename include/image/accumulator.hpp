@@ -0,0 +1,137 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+#include "math.hpp"
+#include "tensor.hpp"
+
+namespace pbpt::image {
+
+/****************************************************************
+ * Accumulation Buffer
+ * Keeps the running sums of linear radiance and the sample counts per pixel.
+ *   Compensated : Kahan-Babuska summation so that float sums stay exact over thousands of samples
+ *   Moments     : Welford second moments (sum of squared deviations) for variance estimates; the running means
+ *                 are kept instead of the sums, which stay accurate in float without compensation
+ * Per pixel, that is 16 bytes for float sums, 28 with moments and 12 more with compensation.
+ * Samples with a non-finite component are dropped before they reach the sums, and only counted, so that one NaN or
+ * inf path does not poison its pixel for good.
+ * Display transforms are applied only when the buffer is resolved into an image.
+ * Each pixel must be written by one thread at a time.
+ ****************************************************************/
+template <
+    typename Scalar = float, template <typename, auto> typename Vector = pbpt::tensor::Vector, bool Compensated = true,
+    bool Moments = false>
+struct AccumulationBuffer {
+  constexpr AccumulationBuffer() = default;
+  constexpr AccumulationBuffer(std::size_t size)
+      : m_values(size), m_compensations(Compensated ? size : 0), m_moments(Moments ? size : 0), m_counts(size) {}
+
+  constexpr auto size() const { return m_counts.size(); }
+
+  constexpr auto &counts() & { return m_counts; }
+  constexpr const auto &counts() const & { return m_counts; }
+  constexpr auto &&counts() && { return std::move(m_counts); }
+  constexpr const auto &&counts() const && { return std::move(m_counts); }
+
+  constexpr auto count(auto index) const { return m_counts[index]; }
+
+  // number of non-finite samples dropped over all pixels
+  auto num_dropped() const { return m_num_dropped.load(std::memory_order_relaxed); }
+
+  constexpr auto mean(auto index) const -> Vector<Scalar, 3> {
+    if (!m_counts[index]) return {};
+    if constexpr (Moments) {
+      return value(index);
+    } else {
+      return value(index) / static_cast<Scalar>(m_counts[index]);
+    }
+  }
+
+  constexpr auto variance(auto index) const -> Vector<Scalar, 3>
+    requires Moments
+  {
+    if (m_counts[index] < 2) return {};
+    return Vector<Scalar, 3>(m_moments[index]) / static_cast<Scalar>(m_counts[index] - 1);
+  }
+
+  constexpr auto add(auto index, const auto &color) {
+    auto sample = [&]<auto... Is>(std::index_sequence<Is...>) constexpr -> Vector<Scalar, 3> {
+      return {static_cast<Scalar>(pbpt::tensor::get<Is>(color))...};
+    }(std::make_index_sequence<3>{});
+    if (!(std::isfinite(sample[0]) && std::isfinite(sample[1]) && std::isfinite(sample[2]))) {
+      m_num_dropped.fetch_add(1, std::memory_order_relaxed);
+      return;
+    }
+
+    auto old_mean = mean(index);
+    ++m_counts[index];
+
+    // the sum grows by the sample, the running mean by its share of the deviation
+    Vector<Scalar, 3> increment;
+    if constexpr (Moments) {
+      increment = (sample - old_mean) / static_cast<Scalar>(m_counts[index]);
+    } else {
+      increment = sample;
+    }
+
+    for (std::size_t channel = 0; channel < 3; ++channel) {
+      auto &total = m_values[index][channel];
+      if constexpr (Compensated) {
+        auto &compensation = m_compensations[index][channel];
+        auto new_total = total + increment[channel];
+        compensation += std::abs(total) >= std::abs(increment[channel]) ? (total - new_total) + increment[channel]
+                                                                        : (increment[channel] - new_total) + total;
+        total = new_total;
+      } else {
+        total += increment[channel];
+      }
+    }
+
+    if constexpr (Moments) {
+      auto new_mean = mean(index);
+      m_moments[index] = Vector<Scalar, 3>(m_moments[index]) + (sample - old_mean) * (sample - new_mean);
+    }
+  }
+
+  // Returns the mean of each pixel mapped through a display transform.
+  constexpr auto resolve(auto display_transform) const {
+    std::vector<std::array<Scalar, 3>> colors(size());
+    for (std::size_t index = 0; index < size(); ++index) colors[index] = display_transform(mean(index));
+    return colors;
+  }
+
+ private:
+  // sum of the samples, or their mean when moments are kept
+  constexpr auto value(auto index) const -> Vector<Scalar, 3> {
+    if constexpr (Compensated) {
+      return Vector<Scalar, 3>(m_values[index]) + Vector<Scalar, 3>(m_compensations[index]);
+    } else {
+      return Vector<Scalar, 3>(m_values[index]);
+    }
+  }
+
+  std::vector<std::array<Scalar, 3>> m_values;
+  std::vector<std::array<Scalar, 3>> m_compensations;
+  std::vector<std::array<Scalar, 3>> m_moments;
+  std::vector<std::uint32_t> m_counts;
+  // shared by all pixels, hence atomic
+  std::atomic<std::size_t> m_num_dropped = 0;
+};
+
+// Gamma 2 encoding of a linear color clamped into [0, 1].
+constexpr auto gamma_correction(const auto &color) {
+  return pbpt::tensor::elemwise(
+      [](auto component) constexpr {
+        using Scalar = decltype(component);
+        return pbpt::math::sqrt(pbpt::math::clamp(component, Scalar(0), Scalar(1)));
+      },
+      color
+  );
+}
+
+}  // namespace pbpt::image
@@ -0,0 +1,81 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <tuple>
+#include <vector>
+
+#include "tensor.hpp"
+
+namespace pbpt::image {
+
+// Reads a Portable Float Map, color (PF) or grayscale (Pf), into rows from top to bottom.
+// Returns no colors and a size of zero when the file cannot be read as one.
+template <typename Scalar = float, template <typename, auto> typename Vector = pbpt::tensor::Vector>
+auto read_pfm(const auto &filename) -> std::tuple<std::vector<Vector<Scalar, 3>>, std::size_t, std::size_t> {
+  auto failure = std::tuple<std::vector<Vector<Scalar, 3>>, std::size_t, std::size_t>({}, 0, 0);
+  std::ifstream istream(filename, std::ios::binary);
+
+  std::string magic;
+  std::size_t width = 0, height = 0;
+  double scale = 0;
+  istream >> magic >> width >> height >> scale;
+  // a single whitespace character ends the header
+  istream.get();
+  if (!istream || (magic != "PF" && magic != "Pf") || !width || !height || scale == 0) return failure;
+
+  std::size_t num_channels = magic == "PF" ? 3 : 1;
+  // negative scales mark little-endian data
+  auto swapped = (scale < 0) != (std::endian::native == std::endian::little);
+  std::vector<std::uint32_t> words(num_channels * width * height);
+  if (!istream.read(reinterpret_cast<char *>(words.data()), std::streamsize(words.size() * sizeof(std::uint32_t)))) {
+    return failure;
+  }
+
+  std::vector<Vector<Scalar, 3>> colors(width * height);
+  for (std::size_t row = 0; row < height; ++row) {
+    for (std::size_t column = 0; column < width; ++column) {
+      // the file stores the bottom row first
+      auto index = (height - 1 - row) * width + column;
+      std::array<Scalar, 3> values;
+      for (std::size_t channel = 0; channel < 3; ++channel) {
+        auto word = words[num_channels * index + std::min(channel, num_channels - 1)];
+        if (swapped) word = (word >> 24) | ((word >> 8) & 0xff00) | ((word << 8) & 0xff0000) | (word << 24);
+        float value;
+        std::memcpy(&value, &word, sizeof(value));
+        values[channel] = Scalar(value);
+      }
+      colors[row * width + column] = Vector<Scalar, 3>{values[0], values[1], values[2]};
+    }
+  }
+  return {colors, width, height};
+}
+
+// Writes colors, in rows from top to bottom, as a little-endian color Portable Float Map.
+auto write_pfm(const auto &filename, const auto &colors, std::size_t width, std::size_t height) {
+  std::ofstream ostream(filename, std::ios::binary);
+  ostream << "PF\n" << width << " " << height << "\n-1\n";
+
+  std::vector<std::uint32_t> words;
+  words.reserve(3 * width * height);
+  // the file stores the bottom row first
+  for (std::size_t row = height; row--;) {
+    for (std::size_t column = 0; column < width; ++column) {
+      for (const auto &component : colors[row * width + column]) {
+        auto word = std::bit_cast<std::uint32_t>(float(component));
+        if (std::endian::native == std::endian::big) {
+          word = (word >> 24) | ((word >> 8) & 0xff00) | ((word << 8) & 0xff0000) | (word << 24);
+        }
+        words.push_back(word);
+      }
+    }
+  }
+  ostream.write(reinterpret_cast<const char *>(words.data()), std::streamsize(words.size() * sizeof(std::uint32_t)));
+}
+
+}  // namespace pbpt::image
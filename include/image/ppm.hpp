@@ -1,5 +1,6 @@
 #pragma once
 
+#include <algorithm>
 #include <cmath>
 #include <cstdint>
 #include <fstream>
@@ -15,7 +16,7 @@ auto write_ppm(const auto &filename, const auto &colors, auto width, auto height
 
   for (const auto &color : colors) {
     for (const auto &component : color) {
-      ostream << +static_cast<std::uint8_t>(std::clamp(component, 0.0, 1.0) * ((1 << 8) - 1)) << " ";
+      ostream << +static_cast<std::uint8_t>(std::clamp<double>(component, 0.0, 1.0) * ((1 << 8) - 1)) << " ";
     }
     ostream << "\n";
   }
@@ -2,4 +2,5 @@
 #include "material/emissive.hpp"
 #include "material/lambertian.hpp"
 #include "material/metal.hpp"
+#include "material/table.hpp"
 #include "material/utility.hpp"
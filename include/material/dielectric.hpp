@@ -12,23 +12,28 @@ namespace pbpt::material {
 template <typename Scalar = double, template <typename, auto> typename Vector = pbpt::tensor::Vector>
 struct Dielectric {
   constexpr Dielectric() = default;
-  constexpr Dielectric(Scalar refractive_index) : m_refractive_index(refractive_index) {}
+  constexpr Dielectric(Scalar refractive_index) : m_refractive_index(refractive_index) { bake(); }
 
   constexpr auto &refractive_index() & { return m_refractive_index; }
   constexpr const auto &refractive_index() const & { return m_refractive_index; }
   constexpr auto &&refractive_index() && { return std::move(m_refractive_index); }
   constexpr const auto &&refractive_index() const && { return std::move(m_refractive_index); }
 
+  constexpr auto bake() { m_baked = derive(); }
+
   constexpr auto operator()(const auto &ray, const auto &normal, auto &generator) const {
-    return [&, &out_position = ray.position(), out_direction = -ray.direction()]() constexpr {
+    auto shade = [&, &out_position = ray.position(), out_direction = -ray.direction()](
+                     const Constants &constants, auto &generator
+                 ) constexpr {
       auto cos_theta = pbpt::tensor::dot(out_direction, normal);
       auto oriented_normal = cos_theta > 0 ? normal : -normal;
-      auto refractive_index = cos_theta > 0 ? m_refractive_index : 1.0 / m_refractive_index;
+      auto refractive_index = cos_theta > 0 ? m_refractive_index : constants.inverse_refractive_index;
       return [&, &normal = oriented_normal]() constexpr {
-        auto specular_reflectance = pbpt::math::square((1.0 - refractive_index) / (1.0 + refractive_index));
-        auto fresnel_reflectance = schlick_approx(specular_reflectance, std::abs(cos_theta));
-        auto sin_theta = pbpt::math::sqrt(1.0 - pbpt::math::square(cos_theta));
-        if (sin_theta > refractive_index || pbpt::random::uniform(generator, 0.0, 1.0) < fresnel_reflectance) {
+        // the reflectance at normal incidence is the same from both sides
+        auto fresnel_reflectance = schlick_approx(constants.specular_reflectance, std::abs(cos_theta));
+        auto sin_theta = pbpt::math::sqrt(1 - pbpt::math::square(cos_theta));
+        if (sin_theta > refractive_index ||
+            pbpt::random::uniform(generator, Scalar(0), Scalar(1)) < fresnel_reflectance) {
           /****************************************************************
            * Importance Sampling for Monte Carlo
            ****************************************************************/
@@ -43,10 +48,10 @@ struct Dielectric {
                             const auto &in_direction) constexpr -> Vector<Scalar, 3> {
             return {fresnel_reflectance, fresnel_reflectance, fresnel_reflectance};
           };
-          auto in_position = out_position + numbers::epsilon * normal;
+          auto in_position = out_position + numbers::epsilon<Scalar> * normal;
           auto in_direction = sampler(out_position, out_direction);
           auto reflectance = shader(out_position, out_direction, in_direction);
-          auto weight = 1.0 / fresnel_reflectance;
+          auto weight = 1 / fresnel_reflectance;
           auto reflected_ray = std::decay_t<decltype(ray)>(std::move(in_position), std::move(in_direction), weight);
           return std::make_tuple(reflectance * ray.weight(), std::make_optional(std::move(reflected_ray)));
         } else {
@@ -62,22 +67,33 @@ struct Dielectric {
            ****************************************************************/
           auto shader = [&](const auto &out_position, const auto &out_direction,
                             const auto &in_direction) constexpr -> Vector<Scalar, 3> {
-            auto transmittance = (1.0 - fresnel_reflectance) * pbpt::math::square(refractive_index);
+            auto transmittance = (1 - fresnel_reflectance) * pbpt::math::square(refractive_index);
             return {transmittance, transmittance, transmittance};
           };
-          auto in_position = out_position - numbers::epsilon * normal;
+          auto in_position = out_position - numbers::epsilon<Scalar> * normal;
           auto in_direction = sampler(out_position, out_direction);
           auto transmittance = shader(out_position, out_direction, in_direction);
-          auto weight = 1.0 / (1.0 - fresnel_reflectance);
+          auto weight = 1 / (1 - fresnel_reflectance);
           auto transmitted_ray = std::decay_t<decltype(ray)>(std::move(in_position), std::move(in_direction), weight);
           return std::make_tuple(transmittance * ray.weight(), std::make_optional(std::move(transmitted_ray)));
         }
       }();
-    }();
+    };
+    return validated("Dielectric", shade, m_baked, [&]() constexpr { return derive(); }, generator);
   }
 
  private:
+  struct Constants {
+    Scalar inverse_refractive_index;
+    Scalar specular_reflectance;
+  };
+
+  constexpr auto derive() const -> Constants {
+    return {1 / m_refractive_index, normal_reflectance(m_refractive_index)};
+  }
+
   Scalar m_refractive_index;
+  Constants m_baked;
 };
 
 template <typename Scalar = double, template <typename, auto> typename Vector = pbpt::tensor::Vector>
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <optional>
+#include <type_traits>
 
 #include "material.hpp"
 #include "tensor.hpp"
@@ -36,6 +37,15 @@ struct Emissive {
   Vector<Scalar, 3> m_emission;
 };
 
+template <typename>
+struct is_emissive : std::false_type {};
+
+template <typename Scalar, template <typename, auto> typename Vector>
+struct is_emissive<Emissive<Scalar, Vector>> : std::true_type {};
+
+template <typename T>
+constexpr auto is_emissive_v = is_emissive<T>::value;
+
 template <typename Scalar = double, template <typename, auto> typename Vector = pbpt::tensor::Vector>
 constexpr auto make_emissive(auto &&...args) {
   return Material<Scalar, Vector>(Emissive<Scalar, Vector>(std::forward<decltype(args)>(args)...));
@@ -1,47 +1,70 @@
 #pragma once
 
+#include <algorithm>
 #include <numbers>
 #include <optional>
 
 #include "material.hpp"
 #include "random.hpp"
 #include "tensor.hpp"
+#include "utility.hpp"
 
 namespace pbpt::material {
 
 template <typename Scalar, template <typename, auto> typename Vector = pbpt::tensor::Vector>
 struct Lambertian {
   constexpr Lambertian() = default;
-  constexpr Lambertian(const Vector<Scalar, 3> &reflectance) : m_reflectance(reflectance) {}
-  constexpr Lambertian(Vector<Scalar, 3> &&reflectance) : m_reflectance(std::move(reflectance)) {}
+  constexpr Lambertian(const Vector<Scalar, 3> &reflectance) : m_reflectance(reflectance) { bake(); }
+  constexpr Lambertian(Vector<Scalar, 3> &&reflectance) : m_reflectance(std::move(reflectance)) { bake(); }
 
   constexpr auto &reflectance() & { return m_reflectance; }
   constexpr const auto &reflectance() const & { return m_reflectance; }
   constexpr auto &&reflectance() && { return std::move(m_reflectance); }
   constexpr const auto &&reflectance() const && { return std::move(m_reflectance); }
 
+  constexpr auto bake() { m_baked = derive(); }
+
+  // BRDF times the cosine of the incident direction, for light sampled by other means than operator().
+  constexpr auto evaluate(const auto &out_direction, const auto &normal, const auto &in_direction) const
+      -> Vector<Scalar, 3> {
+    auto shade = [&](const Constants &constants) constexpr -> Vector<Scalar, 3> {
+      return constants.brdf * std::max(pbpt::tensor::dot(in_direction, normal), Scalar(0));
+    };
+    return validated("Lambertian", shade, m_baked, [&]() constexpr { return derive(); });
+  }
+
+  // Density per solid angle with which operator() samples the incident direction.
+  constexpr auto pdf(const auto &out_direction, const auto &normal, const auto &in_direction) const -> Scalar {
+    return std::max(pbpt::tensor::dot(in_direction, normal), Scalar(0)) / std::numbers::pi_v<Scalar>;
+  }
+
   constexpr auto operator()(const auto &ray, const auto &normal, auto &generator) const {
-    return [&, &out_position = ray.position(), out_direction = -ray.direction()]() constexpr {
+    auto shade = [&, &out_position = ray.position(), out_direction = -ray.direction()](
+                     const Constants &constants, auto &generator
+                 ) constexpr {
       /****************************************************************
        * BRDF (Bidirectional Reflectance Distribution Fucntion)
        ****************************************************************/
       auto brdf = [&](const auto &out_position, const auto &out_direction, const auto &in_direction) constexpr {
-        return m_reflectance / std::numbers::pi;
+        return constants.brdf;
       };
       /****************************************************************
        * PDF (Probability Density Function) for Importance Sampling
        ****************************************************************/
       auto pdf = [&](const auto &in_direction) constexpr {
-        return pbpt::tensor::dot(in_direction, normal) / std::numbers::pi;
+        return pbpt::tensor::dot(in_direction, normal) / std::numbers::pi_v<Scalar>;
       };
       /****************************************************************
        * Importance Sampling for Monte Carlo
        ****************************************************************/
       auto sampler = [&](const auto &out_position, const auto &out_direction) constexpr {
         auto [coord_x, coord_y, coord_z] = pbpt::random::cosine_on_unit_semisphere<Scalar, Vector>(generator);
-        auto tangent = pbpt::tensor::normalized(pbpt::tensor::cross(normal, Vector<Scalar, 3>{1.0, 0.0, 0.0}));
+        auto tangent = pbpt::tensor::normalized(pbpt::tensor::cross(normal, Vector<Scalar, 3>{1, 0, 0}));
         auto bitangent = pbpt::tensor::cross(normal, tangent);
-        return coord_x * tangent + coord_y * bitangent + coord_z * normal;
+        return pbpt::tensor::evaluate(
+            coord_x * pbpt::tensor::lazy(tangent) + coord_y * pbpt::tensor::lazy(bitangent) +
+            coord_z * pbpt::tensor::lazy(normal)
+        );
       };
       /****************************************************************
        * Rendering Equation
@@ -50,17 +73,25 @@ struct Lambertian {
       auto shader = [&](const auto &out_position, const auto &out_direction, const auto &in_direction) constexpr {
         return brdf(out_position, out_direction, in_direction) * pbpt::tensor::dot(in_direction, normal);
       };
-      auto in_position = out_position + numbers::epsilon * normal;
+      auto in_position = out_position + numbers::epsilon<Scalar> * normal;
       auto in_direction = sampler(out_position, out_direction);
       auto reflectance = shader(out_position, out_direction, in_direction);
-      auto weight = 1.0 / pdf(in_direction);
+      auto weight = 1 / pdf(in_direction);
       auto reflected_ray = std::decay_t<decltype(ray)>(std::move(in_position), std::move(in_direction), weight);
       return std::make_tuple(reflectance * ray.weight(), std::make_optional(std::move(reflected_ray)));
-    }();
+    };
+    return validated("Lambertian", shade, m_baked, [&]() constexpr { return derive(); }, generator);
   }
 
  private:
+  struct Constants {
+    Vector<Scalar, 3> brdf;
+  };
+
+  constexpr auto derive() const -> Constants { return {m_reflectance / std::numbers::pi_v<Scalar>}; }
+
   Vector<Scalar, 3> m_reflectance;
+  Constants m_baked;
 };
 
 template <typename Scalar = double, template <typename, auto> typename Vector = pbpt::tensor::Vector>
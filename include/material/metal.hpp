@@ -1,5 +1,6 @@
 #pragma once
 
+#include <cmath>
 #include <complex>
 #include <optional>
 
@@ -12,17 +13,25 @@ namespace pbpt::material {
 template <typename Scalar = double, template <typename, auto> typename Vector = pbpt::tensor::Vector>
 struct Metal {
   constexpr Metal() = default;
-  constexpr Metal(const Vector<std::complex<Scalar>, 3> &refractive_index) : m_refractive_index(refractive_index) {}
+  constexpr Metal(const Vector<std::complex<Scalar>, 3> &refractive_index) : m_refractive_index(refractive_index) {
+    bake();
+  }
   constexpr Metal(Vector<std::complex<Scalar>, 3> &&refractive_index)
-      : m_refractive_index(std::move(refractive_index)) {}
+      : m_refractive_index(std::move(refractive_index)) {
+    bake();
+  }
 
   constexpr auto &refractive_index() & { return m_refractive_index; }
   constexpr const auto &refractive_index() const & { return m_refractive_index; }
   constexpr auto &&refractive_index() && { return std::move(m_refractive_index); }
   constexpr const auto &&refractive_index() const && { return std::move(m_refractive_index); }
 
+  constexpr auto bake() { m_baked = derive(); }
+
   constexpr auto operator()(const auto &ray, const auto &normal, auto &generator) const {
-    return [&, &out_position = ray.position(), out_direction = -ray.direction()]() constexpr {
+    auto shade = [&, &out_position = ray.position(), out_direction = -ray.direction()](
+                     const Constants &constants
+                 ) constexpr {
       /****************************************************************
        * Importance Sampling for Monte Carlo
        ****************************************************************/
@@ -35,25 +44,33 @@ struct Metal {
        ****************************************************************/
       auto shader = [&](const auto &out_position, const auto &out_direction,
                         const auto &in_direction) constexpr -> Vector<Scalar, 3> {
-        auto complex_reflectance = pbpt::tensor::elemwise(
-            pbpt::math::square<std::complex<Scalar>>, (1.0 - m_refractive_index) / (1.0 + m_refractive_index)
-        );
-        auto specular_reflectance = [&]<auto... Is>(std::index_sequence<Is...>) -> Vector<Scalar, 3> {
-          return {std::abs(pbpt::tensor::get<Is>(complex_reflectance))...};
-        }(std::make_index_sequence<pbpt::tensor::dimension_v<decltype(complex_reflectance), 0>>{});
-        auto fresnel_reflectance = schlick_approx(specular_reflectance, pbpt::tensor::dot(out_direction, normal));
+        // the normal may face away at CSG junctions, where a negative cosine would lift the reflectance above one
+        auto cos_theta = pbpt::tensor::dot(out_direction, normal);
+        auto fresnel_reflectance = schlick_approx(constants.specular_reflectance, std::abs(cos_theta));
         return fresnel_reflectance;
       };
-      auto in_position = out_position + numbers::epsilon * normal;
+      auto in_position = out_position + numbers::epsilon<Scalar> * normal;
       auto in_direction = sampler(out_position, out_direction);
       auto reflectance = shader(out_position, out_direction, in_direction);
-      auto reflected_ray = std::decay_t<decltype(ray)>(std::move(in_position), std::move(in_direction), 1.0);
+      auto reflected_ray = std::decay_t<decltype(ray)>(std::move(in_position), std::move(in_direction), Scalar(1));
       return std::make_tuple(reflectance * ray.weight(), std::make_optional(std::move(reflected_ray)));
-    }();
+    };
+    return validated("Metal", shade, m_baked, [&]() constexpr { return derive(); });
   }
 
  private:
+  struct Constants {
+    Vector<Scalar, 3> specular_reflectance;
+  };
+
+  constexpr auto derive() const -> Constants {
+    return {[&]<auto... Is>(std::index_sequence<Is...>) constexpr -> Vector<Scalar, 3> {
+      return {normal_reflectance(pbpt::tensor::get<Is>(m_refractive_index))...};
+    }(std::make_index_sequence<pbpt::tensor::dimension_v<Vector<std::complex<Scalar>, 3>, 0>>{})};
+  }
+
   Vector<std::complex<Scalar>, 3> m_refractive_index;
+  Constants m_baked;
 };
 
 template <typename Scalar = double, template <typename, auto> typename Vector = pbpt::tensor::Vector>
@@ -0,0 +1,172 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <functional>
+#include <stdexcept>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <variant>
+
+#include "common.hpp"
+#include "dielectric.hpp"
+#include "emissive.hpp"
+#include "lambertian.hpp"
+#include "material.hpp"
+#include "metal.hpp"
+#include "tensor.hpp"
+
+namespace pbpt::material {
+
+// ================================================================
+// id
+
+// 32-bit handle to a material in a table: the material type in the high bits, its slot in the low ones.
+struct MaterialId {
+  static constexpr auto tag_bits = 4;
+  static constexpr auto index_bits = 32 - tag_bits;
+
+  constexpr MaterialId() = default;
+  constexpr MaterialId(std::uint32_t tag, std::uint32_t index) : m_value(tag << index_bits | index) {}
+
+  constexpr auto tag() const { return m_value >> index_bits; }
+  constexpr auto index() const { return m_value & ((std::uint32_t(1) << index_bits) - 1); }
+  constexpr auto value() const { return m_value; }
+
+ private:
+  std::uint32_t m_value = 0;
+};
+
+// Material parameter for the geometry templates that makes primitives store ids instead of materials.
+template <typename Scalar, template <typename, auto> typename Vector>
+using MaterialIndex = MaterialId;
+
+// ================================================================
+// reference
+
+// What a surface hands to the renderer: a reference to an embedded material, or an id into a table.
+template <typename Material>
+struct material_reference {
+  using type = std::reference_wrapper<const Material>;
+};
+
+template <>
+struct material_reference<MaterialId> {
+  using type = MaterialId;
+};
+
+template <typename Material>
+using material_reference_t = typename material_reference<Material>::type;
+
+template <typename Material>
+constexpr auto make_material_reference(const Material &material) -> material_reference_t<Material> {
+  return material_reference_t<Material>(material);
+}
+
+// Dispatcher for geometry that embeds its materials: the reference is the material itself.
+struct EmbeddedMaterials {
+  constexpr auto operator()(const auto &material_reference, auto &&...args) const {
+    return material_reference(std::forward<decltype(args)>(args)...);
+  }
+
+  // Calls the function with the alternative that the embedded material holds.
+  constexpr auto visit(const auto &material_reference, auto &&function) const {
+    return std::visit(function, material_reference.get());
+  }
+
+  constexpr auto prefetch(const auto &material_reference) const { pbpt::prefetch(material_reference.get()); }
+};
+
+/****************************************************************
+ * Material Table
+ * Materials stored once, segregated by type into contiguous arrays of fixed capacity,
+ * so that each primitive keeps a 32-bit id and shading dispatches on the id's tag.
+ * The capacities are compile-time constants because the table is built in constant expressions;
+ * exceeding one throws std::length_error, which is a compile error in a constant expression.
+ ****************************************************************/
+template <auto Capacities, typename... Materials>
+struct GenericMaterialTable {
+  static_assert(sizeof...(Materials) <= (1 << MaterialId::tag_bits));
+  // every slot of a segment must be addressable by the index bits of an id
+  static_assert([] {
+    for (std::size_t capacity : Capacities) {
+      if (capacity > (std::size_t(1) << MaterialId::index_bits)) return false;
+    }
+    return true;
+  }());
+
+  constexpr GenericMaterialTable() = default;
+
+  template <auto I>
+  constexpr auto &segment() & {
+    return std::get<I>(m_segments);
+  }
+  template <auto I>
+  constexpr const auto &segment() const & {
+    return std::get<I>(m_segments);
+  }
+
+  template <auto I>
+  constexpr auto size() const {
+    return m_sizes[I];
+  }
+
+  template <typename... Ms>
+  constexpr auto add(const GenericMaterial<Ms...> &material) -> MaterialId {
+    return std::visit([this](const auto &material) constexpr { return add(material); }, material);
+  }
+
+  template <typename Material>
+  constexpr auto add(const Material &material) -> MaterialId
+    requires(std::is_same_v<Material, Materials> || ...)
+  {
+    constexpr auto tag = tag_of<Material>();
+    if (m_sizes[tag] == Capacities[tag]) throw std::length_error("GenericMaterialTable: segment is full");
+    auto index = m_sizes[tag]++;
+    std::get<tag>(m_segments)[index] = material;
+    return {static_cast<std::uint32_t>(tag), static_cast<std::uint32_t>(index)};
+  }
+
+  // Calls the function with the material the id refers to; the chain of tag comparisons compiles into a switch.
+  template <auto I = 0>
+  constexpr auto visit(MaterialId id, auto &&function) const {
+    if constexpr (I + 1 < sizeof...(Materials)) {
+      if (id.tag() != I) return visit<I + 1>(id, function);
+    }
+    return function(std::get<I>(m_segments)[id.index()]);
+  }
+
+  constexpr auto operator()(MaterialId id, auto &&...args) const {
+    return visit(id, [&](const auto &material) constexpr { return material(args...); });
+  }
+
+  constexpr auto prefetch(MaterialId id) const {
+    visit(id, [](const auto &material) constexpr { pbpt::prefetch(material); });
+  }
+
+ private:
+  template <typename Material>
+  static constexpr auto tag_of() {
+    return [&]<auto... Is>(std::index_sequence<Is...>) constexpr {
+      return ((std::is_same_v<Material, Materials> ? Is : 0) + ...);
+    }(std::index_sequence_for<Materials...>{});
+  }
+
+  using Segments = decltype([]<auto... Is>(std::index_sequence<Is...>) {
+    return std::tuple<std::array<Materials, Capacities[Is]>...>{};
+  }(std::index_sequence_for<Materials...>{}));
+
+  Segments m_segments{};
+  std::array<std::size_t, sizeof...(Materials)> m_sizes{};
+};
+
+template <
+    typename Scalar = double, template <typename, auto> typename Vector = pbpt::tensor::Vector,
+    std::size_t NumLambertians = 0, std::size_t NumMetals = 0, std::size_t NumDielectrics = 0,
+    std::size_t NumEmissives = 0>
+using MaterialTable = GenericMaterialTable<
+    std::array{NumLambertians, NumMetals, NumDielectrics, NumEmissives}, Lambertian<Scalar, Vector>,
+    Metal<Scalar, Vector>, Dielectric<Scalar, Vector>, Emissive<Scalar, Vector>>;
+
+}  // namespace pbpt::material
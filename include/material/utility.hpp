@@ -1,6 +1,14 @@
 #pragma once
 
+#include <algorithm>
+#include <cmath>
+#include <complex>
+#include <cstdlib>
+#include <iostream>
+#include <limits>
 #include <numbers>
+#include <tuple>
+#include <type_traits>
 
 #include "math.hpp"
 #include "tensor.hpp"
@@ -8,21 +16,103 @@
 namespace pbpt::material {
 
 constexpr auto reflect(const auto &incident, const auto &normal) {
-  return 2.0 * pbpt::tensor::dot(incident, normal) * normal - incident;
+  return pbpt::tensor::evaluate(2 * pbpt::tensor::dot(incident, normal) * pbpt::tensor::lazy(normal) - incident);
 }
 
 constexpr auto refract(const auto &incident, const auto &normal, auto refractive_index) {
-  auto parallel = (pbpt::tensor::dot(incident, normal) * normal - incident) / refractive_index;
-  auto perpendicular = -pbpt::math::sqrt(1.0 - pbpt::tensor::dot(parallel, parallel)) * normal;
-  return parallel + perpendicular;
+  auto parallel = pbpt::tensor::evaluate(
+      (pbpt::tensor::dot(incident, normal) * pbpt::tensor::lazy(normal) - incident) / refractive_index
+  );
+  auto perpendicular = pbpt::math::sqrt(1 - pbpt::tensor::dot(parallel, parallel));
+  return pbpt::tensor::evaluate(pbpt::tensor::lazy(parallel) - perpendicular * pbpt::tensor::lazy(normal));
 }
 
 constexpr auto schlick_approx(auto specular_reflectance, auto cos_theta) {
-  return specular_reflectance + (1.0 - specular_reflectance) * pbpt::math::pow(1.0 - cos_theta, 5);
+  return specular_reflectance + (1 - specular_reflectance) * pbpt::math::pow<5>(1 - cos_theta);
+}
+
+// Fresnel reflectance at normal incidence for a real or complex refractive index.
+constexpr auto normal_reflectance(auto refractive_index) {
+  using Index = decltype(refractive_index);
+  auto reflectance = pbpt::math::square((Index(1) - refractive_index) / (Index(1) + refractive_index));
+  if constexpr (std::is_arithmetic_v<Index>) {
+    return reflectance;
+  } else {
+    // std::abs is not constexpr for complex numbers
+    return pbpt::math::sqrt(std::norm(reflectance));
+  }
+}
+
+/****************************************************************
+ * Baking
+ * Materials derive their shading constants from their parameters once, in bake(), instead of on every hit.
+ * bake() must be called again after a parameter is modified through its accessor.
+ * With PBPT_VALIDATE_MATERIALS defined, every shading call also shades with constants freshly derived from the
+ * parameters, drawing the same random numbers from a copy of the generator, and aborts with a report when the two
+ * results disagree. The check is explicit, so it holds in release builds too.
+ ****************************************************************/
+
+// Largest relative difference between two shading results: colors, densities, rays or tuples and optionals of them.
+constexpr auto shading_error(const auto &result, const auto &reference) -> double {
+  using Result = std::decay_t<decltype(result)>;
+  if constexpr (std::is_arithmetic_v<Result>) {
+    return std::abs(double(result) - double(reference)) / std::max(1.0, std::abs(double(reference)));
+  } else if constexpr (pbpt::tensor::TensorShaped<Result>) {
+    auto error = 0.0;
+    for (std::size_t index = 0; index < pbpt::tensor::dimension_v<Result, 0>; ++index) {
+      error = std::max(error, shading_error(result[index], reference[index]));
+    }
+    return error;
+  } else if constexpr (requires { result.position(), result.direction(), result.weight(); }) {
+    return std::max(
+        {shading_error(result.position(), reference.position()),
+         shading_error(result.direction(), reference.direction()), shading_error(result.weight(), reference.weight())}
+    );
+  } else if constexpr (requires { result.has_value(); }) {
+    if (result.has_value() != reference.has_value()) return std::numeric_limits<double>::infinity();
+    return result ? shading_error(result.value(), reference.value()) : 0.0;
+  } else {
+    return std::apply(
+        [&](const auto &...elements) constexpr {
+          return std::apply(
+              [&](const auto &...references) constexpr { return std::max({shading_error(elements, references)...}); },
+              reference
+          );
+        },
+        result
+    );
+  }
+}
+
+// shade(constants, generators...) with the baked constants, validated against derive() as described above.
+// material and derive are only read when PBPT_VALIDATE_MATERIALS is defined.
+constexpr auto validated(
+    [[maybe_unused]] const char *material, const auto &shade, const auto &baked, [[maybe_unused]] const auto &derive,
+    auto &...generators
+) {
+#ifdef PBPT_VALIDATE_MATERIALS
+  if (!std::is_constant_evaluated()) {
+    auto reference_generators = std::make_tuple(generators...);
+    auto result = shade(baked, generators...);
+    auto reference = std::apply(
+        [&](auto &...reference_generators) { return shade(derive(), reference_generators...); }, reference_generators
+    );
+    auto error = shading_error(result, reference);
+    if (!(error <= 1e-4)) {
+      std::cerr << material << ": shading with the baked constants is off by " << error
+                << " from the parameters, call bake() after editing them" << std::endl;
+      std::abort();
+    }
+    return result;
+  }
+#endif
+  return shade(baked, generators...);
 }
 
 namespace numbers {
-inline constexpr auto epsilon = 1e-6;
+// offset of secondary ray origins off the surface, which must exceed the intersection error at the scene scale
+template <typename Scalar = double>
+inline constexpr auto epsilon = std::is_same_v<Scalar, float> ? Scalar(1e-3) : Scalar(1e-6);
 }
 
 }  // namespace pbpt::material
@@ -1 +1,2 @@
 #include "math/arithmetic.hpp"
+#include "math/fast.hpp"
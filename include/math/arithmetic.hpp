@@ -1,20 +1,41 @@
 #pragma once
 
+#include <algorithm>
+#include <cmath>
 #include <complex>
 #include <concepts>
 #include <type_traits>
 
 namespace pbpt::math {
 
+// Floating-point type wide enough for computations that cancel most digits at single precision.
+template <typename T>
+using wide_t = std::conditional_t<std::is_same_v<T, float>, double, T>;
+
 constexpr auto sqrt(auto x) { return std::sqrt(x); }
 
 constexpr auto cbrt(auto x) { return std::cbrt(x); }
 
 constexpr auto pow(auto x, auto n) { return std::pow(x, n); }
 
-constexpr auto square(auto x) { return std::pow(x, 2); }
+// Integer power unrolled into ceil(log2(N)) squarings at compile time.
+template <auto N>
+constexpr auto pow(auto x) {
+  if constexpr (N < 0) {
+    return 1 / pow<-N>(x);
+  } else if constexpr (N == 0) {
+    return decltype(x)(1);
+  } else if constexpr (N % 2) {
+    return x * pow<N - 1>(x);
+  } else {
+    auto y = pow<N / 2>(x);
+    return y * y;
+  }
+}
+
+constexpr auto square(auto x) { return x * x; }
 
-constexpr auto cube(auto x) { return std::pow(x, 3); }
+constexpr auto cube(auto x) { return x * x * x; }
 
 constexpr auto clamp(auto in_val, auto out_min, auto out_max) { return std::clamp(in_val, out_min, out_max); }
 
@@ -0,0 +1,136 @@
+#pragma once
+
+#include <bit>
+#include <cmath>
+#include <concepts>
+#include <cstdint>
+#include <numbers>
+#include <tuple>
+#include <type_traits>
+
+namespace pbpt::math {
+
+/****************************************************************
+ * Fast Kernels
+ * Branch-free approximations of the transcendental functions that dominate sampling.
+ * Being branch-free, they vectorize when applied over lanes and they are usable in constant expressions.
+ * Maximum errors against long double references over 10^7 arguments, as measured by tests/math/fast.cpp:
+ *   fast_sincos : 2 ulp (float), 2.5 ulp (double) for |x| <= 2^16
+ *   fast_rsqrt  : 1.5 ulp (float and double) for normal x > 0
+ *   fast_sqrt   : 2 ulp (float and double) for normal x > 0
+ *   fast_cbrt   : 1 ulp (float and double) for normal x up to a third of the largest finite value
+ ****************************************************************/
+template <std::floating_point T>
+constexpr auto polynomial(T x, auto... coefficients) {
+  T result = 0;
+  ((result = result * x + static_cast<T>(coefficients)), ...);
+  return result;
+}
+
+// Sine and cosine on [-pi/4, pi/4] by minimax polynomials (Cephes), without any range reduction.
+template <std::floating_point T>
+constexpr auto fast_sincos_kernel(T r) -> std::tuple<T, T> {
+  auto r2 = r * r;
+  auto sin = r + r * r2 *
+                     polynomial(
+                         r2, 1.58962301576546568060e-10, -2.50507477628578072866e-8, 2.75573136213857245213e-6,
+                         -1.98412698295895385996e-4, 8.33333333332211858878e-3, -1.66666666666666307295e-1
+                     );
+  auto cos = T(1) - T(0.5) * r2 +
+             r2 * r2 *
+                 polynomial(
+                     r2, -1.13585365213876817300e-11, 2.08757008419747316778e-9, -2.75573141792967388112e-7,
+                     2.48015872888517045348e-5, -1.38888888888730564116e-3, 4.16666666666665929218e-2
+                 );
+  return {sin, cos};
+}
+
+template <std::floating_point T>
+constexpr auto fast_sincos(T x) -> std::tuple<T, T> {
+  // Cody-Waite reduction into [-pi/4, pi/4] around the nearest multiple of pi/2
+  auto quadrant = std::round(x * T(2 * std::numbers::inv_pi));
+  auto r = static_cast<T>(
+      ((static_cast<double>(x) - quadrant * 1.57079632673412561417e+00) - quadrant * 6.07710050630396597660e-11) -
+      quadrant * 2.02226624871116645580e-21
+  );
+  auto [sin, cos] = fast_sincos_kernel(r);
+  // rotate by the quadrant
+  auto index = static_cast<std::int64_t>(quadrant) & 3;
+  auto swapped_sin = index & 1 ? cos : sin;
+  auto swapped_cos = index & 1 ? sin : cos;
+  return {index & 2 ? -swapped_sin : swapped_sin, (index + 1) & 2 ? -swapped_cos : swapped_cos};
+}
+
+// Bit-level initial guess refined by Newton iterations y' = y (3 - x y^2) / 2.
+template <std::floating_point T>
+constexpr auto fast_rsqrt(T x) {
+  using Bits = std::conditional_t<std::is_same_v<T, float>, std::uint32_t, std::uint64_t>;
+  constexpr auto magic = std::is_same_v<T, float> ? Bits(0x5f375a86) : Bits(0x5fe6eb50c7b537a9);
+  constexpr auto iterations = std::is_same_v<T, float> ? 2 : 3;
+  auto y = std::bit_cast<T>(static_cast<Bits>(magic - (std::bit_cast<Bits>(x) >> 1)));
+  for (auto iteration = 0; iteration < iterations; ++iteration) y = y * (T(1.5) - T(0.5) * x * y * y);
+  // a last correction on the residual recovers the rounding lost by the iterations
+  return y + T(0.5) * y * (T(1) - x * y * y);
+}
+
+template <std::floating_point T>
+constexpr auto fast_sqrt(T x) {
+  return x > 0 ? x * fast_rsqrt(x) : T(0);
+}
+
+// Exponent divided by 3 at the bit level, refined by Halley iterations y' = y - y (y^3 - x) / (2y^3 + x).
+template <std::floating_point T>
+constexpr auto fast_cbrt(T x) {
+  using Bits = std::conditional_t<std::is_same_v<T, float>, std::uint32_t, std::uint64_t>;
+  constexpr auto sign_mask = Bits(1) << (sizeof(T) * 8 - 1);
+  constexpr auto magic = std::is_same_v<T, float> ? Bits(709958130) : Bits(715094163) << 32;
+  constexpr auto iterations = std::is_same_v<T, float> ? 2 : 3;
+  auto bits = std::bit_cast<Bits>(x);
+  auto magnitude = std::bit_cast<T>(static_cast<Bits>(bits & ~sign_mask));
+  auto y = std::bit_cast<T>(static_cast<Bits>((bits & ~sign_mask) / 3 + magic));
+  for (auto iteration = 0; iteration < iterations; ++iteration) {
+    auto y3 = y * y * y;
+    y -= y * ((y3 - magnitude) / (2 * y3 + magnitude));
+  }
+  return magnitude > 0 ? std::bit_cast<T>(static_cast<Bits>(std::bit_cast<Bits>(y) | (bits & sign_mask))) : x;
+}
+
+// ================================================================
+// policy
+
+// The standard library, correctly rounded or nearly so.
+struct ExactPolicy {
+  static constexpr auto sqrt(auto x) { return std::sqrt(x); }
+
+  static constexpr auto rsqrt(auto x) { return 1 / std::sqrt(x); }
+
+  static constexpr auto cbrt(auto x) { return std::cbrt(x); }
+
+  static constexpr auto sincos(auto x) { return std::tuple(std::sin(x), std::cos(x)); }
+
+  static constexpr auto tan(auto x) { return std::tan(x); }
+};
+
+// The fast kernels above.
+struct FastPolicy {
+  static constexpr auto sqrt(auto x) { return fast_sqrt(x); }
+
+  static constexpr auto rsqrt(auto x) { return fast_rsqrt(x); }
+
+  static constexpr auto cbrt(auto x) { return fast_cbrt(x); }
+
+  static constexpr auto sincos(auto x) { return fast_sincos(x); }
+
+  static constexpr auto tan(auto x) {
+    auto [sin, cos] = fast_sincos(x);
+    return sin / cos;
+  }
+};
+
+#ifdef PBPT_FAST_MATH
+using DefaultPolicy = FastPolicy;
+#else
+using DefaultPolicy = ExactPolicy;
+#endif
+
+}  // namespace pbpt::math
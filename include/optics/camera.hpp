@@ -1,6 +1,11 @@
 #pragma once
 
+#include <cmath>
+#include <optional>
+#include <tuple>
+
 #include "common.hpp"
+#include "math.hpp"
 #include "random.hpp"
 #include "ray.hpp"
 #include "tensor.hpp"
@@ -22,6 +27,8 @@ struct Camera {
         m_aspect_ratio(aspect_ratio),
         m_focal_distance(focal_distance),
         m_aperture_radius(aperture_radius),
+        m_screen_height(2 * std::tan(vertical_fov / 2)),
+        m_screen_width(m_screen_height * aspect_ratio),
         m_response_function(response_function),
         m_position(position),
         m_orientation(orientation) {}
@@ -34,18 +41,17 @@ struct Camera {
         m_aspect_ratio(aspect_ratio),
         m_focal_distance(focal_distance),
         m_aperture_radius(aperture_radius),
+        m_screen_height(2 * std::tan(vertical_fov / 2)),
+        m_screen_width(m_screen_height * aspect_ratio),
         m_response_function(response_function),
         m_position(std::move(position)),
         m_orientation(std::move(orientation)) {}
 
-  constexpr auto &vertical_fov() & { return m_vertical_fov; }
+  // read-only, since the screen size is derived from them once at construction
   constexpr const auto &vertical_fov() const & { return m_vertical_fov; }
-  constexpr auto &&vertical_fov() && { return std::move(m_vertical_fov); }
   constexpr const auto &&vertical_fov() const && { return std::move(m_vertical_fov); }
 
-  constexpr auto &aspect_ratio() & { return m_aspect_ratio; }
   constexpr const auto &aspect_ratio() const & { return m_aspect_ratio; }
-  constexpr auto &&aspect_ratio() && { return std::move(m_aspect_ratio); }
   constexpr const auto &&aspect_ratio() const && { return std::move(m_aspect_ratio); }
 
   constexpr auto &focal_distance() & { return m_focal_distance; }
@@ -75,29 +81,68 @@ struct Camera {
 
   constexpr auto ray(auto coord_u, auto coord_v, auto &generator) const -> Ray<Scalar, Vector> {
     // ---------------- screen ---------------- //
-    auto screen_height = 2.0 * std::tan(m_vertical_fov / 2.0);
-    auto screen_width = screen_height * m_aspect_ratio;
-    auto coord_x = pbpt::math::lerp(coord_u, 0.0, 1.0, -screen_width / 2.0, screen_width / 2.0);
-    auto coord_y = pbpt::math::lerp(coord_v, 0.0, 1.0, -screen_height / 2.0, screen_height / 2.0);
+    auto [screen_width, screen_height] = screen_size();
+    auto coord_x = pbpt::math::lerp(Scalar(coord_u), Scalar(0), Scalar(1), -screen_width / 2, screen_width / 2);
+    auto coord_y = pbpt::math::lerp(Scalar(coord_v), Scalar(0), Scalar(1), -screen_height / 2, screen_height / 2);
     // ---------------- defocus ---------------- //
-    auto target = m_position + m_orientation % Vector<Scalar, 3>{coord_x, coord_y, 1.0} * m_focal_distance;
+    Vector<Scalar, 3> target =
+        pbpt::tensor::lazy(m_orientation % Vector<Scalar, 3>{coord_x, coord_y, 1}) * m_focal_distance + m_position;
+    auto in_position = sample_lens(generator);
+    Vector<Scalar, 3> in_direction = pbpt::tensor::normalized(pbpt::tensor::lazy(target) - in_position);
+    return {std::move(in_position), std::move(in_direction), weight(in_direction)};
+  }
+
+  // Uniform point of the lens.
+  constexpr auto sample_lens(auto &generator) const -> Vector<Scalar, 3> {
     auto [offset_x, offset_y] = pbpt::random::uniform_in_unit_circle<Scalar, Vector>(generator) * m_aperture_radius;
-    auto in_position = m_position + m_orientation % Vector<Scalar, 3>{offset_x, offset_y, 0.0};
-    auto in_direction = pbpt::tensor::normalized(target - in_position);
-    // ---------------- sampling ---------------- //
-    auto lens_normal = m_orientation % Vector<Scalar, 3>{0.0, 0.0, 1.0};
+    return m_position + m_orientation % Vector<Scalar, 3>{offset_x, offset_y, 0};
+  }
+
+  constexpr auto normal() const -> Vector<Scalar, 3> { return m_orientation % Vector<Scalar, 3>{0, 0, 1}; }
+
+  // Area of the screen at unit distance, over which ray() spreads (coord_u, coord_v) in [0, 1)^2.
+  constexpr auto screen_area() const {
+    auto [screen_width, screen_height] = screen_size();
+    return screen_width * screen_height;
+  }
+
+  // Weight of a ray leaving the lens in the direction.
+  constexpr auto weight(const Vector<Scalar, 3> &in_direction) const {
+    auto lens_normal = normal();
     auto response = m_response_function(in_direction, lens_normal);
     auto cos_theta = pbpt::tensor::dot(in_direction, lens_normal);
     // reference: https://rayspace.xyz/CG/contents/DoF/
-    auto weight = response * pbpt::math::pow(cos_theta, 4);
-    return {std::move(in_position), std::move(in_direction), weight};
+    return response * pbpt::math::pow<4>(cos_theta);
+  }
+
+  // Screen coordinates (coord_u, coord_v) of the ray from the point of the lens through the position,
+  // or nothing if the position is behind the lens; the inverse of ray() for a given point of the lens.
+  constexpr auto raster(const Vector<Scalar, 3> &lens_position, const Vector<Scalar, 3> &position) const
+      -> std::optional<std::tuple<Scalar, Scalar>> {
+    auto [screen_width, screen_height] = screen_size();
+    auto local_lens_position = pbpt::tensor::transposed(m_orientation) % (lens_position - m_position);
+    auto local_direction = pbpt::tensor::transposed(m_orientation) % (position - lens_position);
+    auto [lens_x, lens_y, lens_z] = local_lens_position;
+    auto [direction_x, direction_y, direction_z] = local_direction;
+    if (direction_z <= 0) return std::nullopt;
+    // the ray meets the plane in focus where the ray of the same screen point from the lens center does
+    auto coord_x = (lens_x + direction_x * m_focal_distance / direction_z) / m_focal_distance;
+    auto coord_y = (lens_y + direction_y * m_focal_distance / direction_z) / m_focal_distance;
+    auto coord_u = coord_x / screen_width + Scalar(0.5);
+    auto coord_v = coord_y / screen_height + Scalar(0.5);
+    return std::make_tuple(coord_u, coord_v);
   }
 
  private:
+  constexpr auto screen_size() const -> std::tuple<Scalar, Scalar> { return {m_screen_width, m_screen_height}; }
+
   Scalar m_vertical_fov;
   Scalar m_aspect_ratio;
   Scalar m_focal_distance;
   Scalar m_aperture_radius;
+  // extent of the screen at unit distance
+  Scalar m_screen_height;
+  Scalar m_screen_width;
   ResponseFunction m_response_function;
   Vector<Scalar, 3> m_position;
   Matrix<Scalar, 3, 3> m_orientation;
@@ -1,3 +1,5 @@
+#include "random/alias.hpp"
+#include "random/batch.hpp"
 #include "random/distributions.hpp"
 #include "random/generators.hpp"
 #include "random/samplers.hpp"
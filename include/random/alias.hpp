@@ -0,0 +1,78 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <vector>
+
+namespace pbpt::random {
+
+/****************************************************************
+ * Alias Table
+ * Draws index i with probability w_i / Σ w in constant time: u picks a column uniformly, and the column keeps
+ * its own index with its probability or else gives its alias (reference: Vose, A Linear Algorithm for Generating
+ * Random Numbers with a Given Distribution). Built in linear time from nonnegative weights.
+ ****************************************************************/
+template <typename Scalar = double>
+struct AliasTable {
+  AliasTable() = default;
+  AliasTable(const std::vector<Scalar> &weights) { build(weights); }
+
+  auto size() const { return m_probabilities.size(); }
+  auto empty() const { return m_total <= 0; }
+
+  auto &total() & { return m_total; }
+  const auto &total() const & { return m_total; }
+  auto &&total() && { return std::move(m_total); }
+  const auto &&total() const && { return std::move(m_total); }
+
+  // Index for u in [0, 1).
+  auto sample(Scalar u) const -> std::size_t {
+    auto scaled = u * Scalar(size());
+    auto column = std::min(static_cast<std::size_t>(scaled), size() - 1);
+    return scaled - Scalar(column) < m_probabilities[column] ? column : m_aliases[column];
+  }
+
+  auto pdf(std::size_t index) const -> Scalar { return empty() ? Scalar(0) : m_weights[index] / m_total; }
+
+ private:
+  auto build(const std::vector<Scalar> &weights) {
+    auto num_weights = weights.size();
+    m_weights = weights;
+    m_total = 0;
+    for (auto weight : weights) m_total += weight;
+    m_probabilities.assign(num_weights, 1);
+    m_aliases.resize(num_weights);
+    for (std::size_t index = 0; index < num_weights; ++index) m_aliases[index] = index;
+    if (m_total <= 0) return;
+
+    // columns below the mean are filled up by the ones above it
+    std::vector<Scalar> scaled(num_weights);
+    std::vector<std::size_t> small, large;
+    for (std::size_t index = 0; index < num_weights; ++index) {
+      scaled[index] = weights[index] * Scalar(num_weights) / m_total;
+      (scaled[index] < 1 ? small : large).push_back(index);
+    }
+    while (!small.empty() && !large.empty()) {
+      auto small_index = small.back();
+      auto large_index = large.back();
+      small.pop_back();
+      m_probabilities[small_index] = scaled[small_index];
+      m_aliases[small_index] = large_index;
+      scaled[large_index] -= 1 - scaled[small_index];
+      if (scaled[large_index] < 1) {
+        large.pop_back();
+        small.push_back(large_index);
+      }
+    }
+    // what remains is one up to rounding
+    for (auto index : small) m_probabilities[index] = 1;
+    for (auto index : large) m_probabilities[index] = 1;
+  }
+
+  std::vector<Scalar> m_weights;
+  std::vector<Scalar> m_probabilities;
+  std::vector<std::size_t> m_aliases;
+  Scalar m_total = 0;
+};
+
+}  // namespace pbpt::random
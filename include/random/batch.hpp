@@ -0,0 +1,182 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <numbers>
+#include <type_traits>
+
+#include "math.hpp"
+#include "tensor.hpp"
+
+namespace pbpt::random::batch {
+
+/****************************************************************
+ * Batch Sampling
+ * Samplers that fill structure-of-arrays batches (pbpt::tensor::TensorBatch) with N samples per call.
+ * Every lane runs the same branch-free arithmetic, so the lane loops compile into SIMD instructions.
+ ****************************************************************/
+
+// N independent xoshiro128+ streams stored lane by lane, seeded from one seed by SplitMix64.
+// reference: https://prng.di.unimi.it/
+template <auto N>
+struct Xoshiro128PlusGenerator {
+  constexpr Xoshiro128PlusGenerator() : Xoshiro128PlusGenerator(0) {}
+  constexpr Xoshiro128PlusGenerator(std::uint64_t seed) {
+    auto split_mix = [&seed]() constexpr {
+      auto z = (seed += 0x9e3779b97f4a7c15);
+      z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9;
+      z = (z ^ (z >> 27)) * 0x94d049bb133111eb;
+      return z ^ (z >> 31);
+    };
+    for (std::size_t lane = 0; lane < N; ++lane) {
+      auto bits_1 = split_mix();
+      auto bits_2 = split_mix();
+      m_states[0][lane] = static_cast<std::uint32_t>(bits_1);
+      m_states[1][lane] = static_cast<std::uint32_t>(bits_1 >> 32);
+      m_states[2][lane] = static_cast<std::uint32_t>(bits_2);
+      m_states[3][lane] = static_cast<std::uint32_t>(bits_2 >> 32) | 1;
+    }
+  }
+
+  constexpr auto operator()() {
+    auto &[s0, s1, s2, s3] = m_states;
+    pbpt::tensor::Lanes<std::uint32_t, N> result{};
+    for (std::size_t lane = 0; lane < N; ++lane) {
+      result[lane] = s0[lane] + s3[lane];
+      auto t = s1[lane] << 9;
+      s2[lane] ^= s0[lane];
+      s3[lane] ^= s1[lane];
+      s1[lane] ^= s2[lane];
+      s0[lane] ^= s3[lane];
+      s2[lane] ^= t;
+      s3[lane] = (s3[lane] << 11) | (s3[lane] >> 21);
+    }
+    return result;
+  }
+
+  static constexpr auto lanes() { return N; }
+
+ private:
+  pbpt::tensor::Lanes<std::uint32_t, N> m_states[4];
+};
+
+// ================================================================
+// distributions
+
+// Uniform in [min, max), built from the high bits with a single multiplication (no integer lerp).
+// xoshiro128+ has weak low bits, so only the high ones fill the mantissa: the top 24 bits of one draw for float,
+// and the top 26 bits of two draws for double.
+template <typename Scalar = double, auto N>
+constexpr auto uniform(Xoshiro128PlusGenerator<N> &generator, Scalar min, Scalar max) {
+  auto bits = generator();
+  pbpt::tensor::Lanes<Scalar, N> result{};
+  if constexpr (std::is_same_v<Scalar, float>) {
+    for (std::size_t lane = 0; lane < N; ++lane) {
+      result[lane] = min + (max - min) * (Scalar(bits[lane] >> 8) * Scalar(0x1.0p-24));
+    }
+  } else {
+    auto low_bits = generator();
+    for (std::size_t lane = 0; lane < N; ++lane) {
+      auto mantissa = std::uint64_t(bits[lane] >> 6) << 26 | std::uint64_t(low_bits[lane] >> 6);
+      result[lane] = min + (max - min) * (Scalar(mantissa) * Scalar(0x1.0p-52));
+    }
+  }
+  return result;
+}
+
+// ================================================================
+// samplers
+
+template <typename Scalar = double, typename MathPolicy = pbpt::math::DefaultPolicy, auto N>
+constexpr auto uniform_on_unit_circle(Xoshiro128PlusGenerator<N> &generator)
+    -> pbpt::tensor::VectorBatch<Scalar, N, 2> {
+  auto theta = uniform<Scalar>(generator, -std::numbers::pi_v<Scalar>, std::numbers::pi_v<Scalar>);
+  pbpt::tensor::VectorBatch<Scalar, N, 2> samples{};
+  auto &[coord_x, coord_y] = samples;
+  for (std::size_t lane = 0; lane < N; ++lane) {
+    auto [sin_theta, cos_theta] = MathPolicy::sincos(theta[lane]);
+    coord_x[lane] = cos_theta;
+    coord_y[lane] = sin_theta;
+  }
+  return samples;
+}
+
+// Shirley-Chiu concentric mapping of the square onto the disk.
+// The angle stays within [-pi/4, pi/4] of an axis, where sine and cosine are plain polynomials.
+template <typename Scalar = double, auto N>
+constexpr auto uniform_in_unit_circle(Xoshiro128PlusGenerator<N> &generator)
+    -> pbpt::tensor::VectorBatch<Scalar, N, 2> {
+  auto coord_u = uniform<Scalar>(generator, Scalar(-1), Scalar(1));
+  auto coord_v = uniform<Scalar>(generator, Scalar(-1), Scalar(1));
+  pbpt::tensor::VectorBatch<Scalar, N, 2> samples{};
+  auto &[coord_x, coord_y] = samples;
+  for (std::size_t lane = 0; lane < N; ++lane) {
+    auto horizontal = std::abs(coord_u[lane]) > std::abs(coord_v[lane]);
+    auto radius = horizontal ? coord_u[lane] : coord_v[lane];
+    auto ratio = radius ? (horizontal ? coord_v[lane] : coord_u[lane]) / radius : Scalar(0);
+    auto [sin_phi, cos_phi] = pbpt::math::fast_sincos_kernel(std::numbers::pi_v<Scalar> / 4 * ratio);
+    // the vertical wedges are rotated by pi/2 - phi, which swaps sine and cosine
+    coord_x[lane] = radius * (horizontal ? cos_phi : sin_phi);
+    coord_y[lane] = radius * (horizontal ? sin_phi : cos_phi);
+  }
+  return samples;
+}
+
+template <typename Scalar = double, typename MathPolicy = pbpt::math::DefaultPolicy, auto N>
+constexpr auto uniform_on_unit_sphere(Xoshiro128PlusGenerator<N> &generator)
+    -> pbpt::tensor::VectorBatch<Scalar, N, 3> {
+  auto cos_theta = uniform<Scalar>(generator, Scalar(-1), Scalar(1));
+  auto phi = uniform<Scalar>(generator, -std::numbers::pi_v<Scalar>, std::numbers::pi_v<Scalar>);
+  pbpt::tensor::VectorBatch<Scalar, N, 3> samples{};
+  auto &[coord_x, coord_y, coord_z] = samples;
+  for (std::size_t lane = 0; lane < N; ++lane) {
+    auto sin_theta = MathPolicy::sqrt(1 - pbpt::math::square(cos_theta[lane]));
+    auto [sin_phi, cos_phi] = MathPolicy::sincos(phi[lane]);
+    coord_x[lane] = sin_theta * cos_phi;
+    coord_y[lane] = sin_theta * sin_phi;
+    coord_z[lane] = cos_theta[lane];
+  }
+  return samples;
+}
+
+template <typename Scalar = double, typename MathPolicy = pbpt::math::DefaultPolicy, auto N>
+constexpr auto uniform_in_unit_sphere(Xoshiro128PlusGenerator<N> &generator)
+    -> pbpt::tensor::VectorBatch<Scalar, N, 3> {
+  auto samples = uniform_on_unit_sphere<Scalar, MathPolicy>(generator);
+  auto radius = uniform<Scalar>(generator, Scalar(0), Scalar(1));
+  for (std::size_t lane = 0; lane < N; ++lane) radius[lane] = MathPolicy::cbrt(radius[lane]);
+  return samples * radius;
+}
+
+template <typename Scalar = double, typename MathPolicy = pbpt::math::DefaultPolicy, auto N>
+constexpr auto uniform_on_unit_semisphere(Xoshiro128PlusGenerator<N> &generator)
+    -> pbpt::tensor::VectorBatch<Scalar, N, 3> {
+  auto cos_theta = uniform<Scalar>(generator, Scalar(0), Scalar(1));
+  auto phi = uniform<Scalar>(generator, -std::numbers::pi_v<Scalar>, std::numbers::pi_v<Scalar>);
+  pbpt::tensor::VectorBatch<Scalar, N, 3> samples{};
+  auto &[coord_x, coord_y, coord_z] = samples;
+  for (std::size_t lane = 0; lane < N; ++lane) {
+    auto sin_theta = MathPolicy::sqrt(1 - pbpt::math::square(cos_theta[lane]));
+    auto [sin_phi, cos_phi] = MathPolicy::sincos(phi[lane]);
+    coord_x[lane] = sin_theta * cos_phi;
+    coord_y[lane] = sin_theta * sin_phi;
+    coord_z[lane] = cos_theta[lane];
+  }
+  return samples;
+}
+
+// Malley's method: concentric disk samples lifted onto the hemisphere.
+template <typename Scalar = double, typename MathPolicy = pbpt::math::DefaultPolicy, auto N>
+constexpr auto cosine_on_unit_semisphere(Xoshiro128PlusGenerator<N> &generator)
+    -> pbpt::tensor::VectorBatch<Scalar, N, 3> {
+  auto [disk_x, disk_y] = uniform_in_unit_circle<Scalar>(generator);
+  pbpt::tensor::VectorBatch<Scalar, N, 3> samples{disk_x, disk_y};
+  auto &coord_z = pbpt::tensor::get<2>(samples);
+  for (std::size_t lane = 0; lane < N; ++lane) {
+    auto squared_radius = pbpt::math::square(disk_x[lane]) + pbpt::math::square(disk_y[lane]);
+    coord_z[lane] = MathPolicy::sqrt(std::max(Scalar(0), 1 - squared_radius));
+  }
+  return samples;
+}
+
+}  // namespace pbpt::random::batch
@@ -1,6 +1,13 @@
 #pragma once
+#include <algorithm>
+#include <cmath>
 #include <cstdint>
 #include <iostream>
+#include <limits>
+#include <numbers>
+#include <vector>
+
+#include "distributions.hpp"
 
 namespace pbpt::random {
 
@@ -30,4 +37,91 @@ struct LinearCongruentialGenerator {
   T x = 0;
 };
 
+/****************************************************************
+ * Primary Sample Generator
+ * Replays a vector of primary samples in [0, 1), one per call, so that whatever consumed them can be run again on
+ * a mutation of the same vector (reference: Kelemen et al., A Simple and Robust Mutation Strategy for the
+ * Metropolis Light Transport Algorithm). mutate() begins a proposal, either
+ *   - a large step, drawing every sample afresh from the wrapped generator, or
+ *   - a small step, offsetting every sample by a normal deviate of standard deviation σ, wrapped around [0, 1),
+ * and samples are only mutated once they are drawn, by as many steps as they have missed.
+ * accept() keeps the proposal and reject() restores the samples it drew.
+ ****************************************************************/
+template <typename Scalar = double, typename Generator = LinearCongruentialGenerator<>>
+struct PrimarySampleGenerator {
+  constexpr PrimarySampleGenerator(auto seed, Scalar sigma, Scalar large_step_probability)
+      : m_generator(seed), m_sigma(sigma), m_large_step_probability(large_step_probability) {}
+
+  constexpr std::uint32_t operator()() {
+    if (m_index == m_samples.size()) m_samples.emplace_back();
+    auto &sample = m_samples[m_index++];
+    // a sample not drawn since the last accepted large step starts from what that step would have drawn
+    if (sample.iteration < m_last_large_step) {
+      sample.value = uniform(m_generator, Scalar(0), Scalar(1));
+      sample.iteration = m_last_large_step;
+    }
+    sample.backup_value = sample.value;
+    sample.backup_iteration = sample.iteration;
+    if (m_large_step) {
+      sample.value = uniform(m_generator, Scalar(0), Scalar(1));
+    } else {
+      auto num_steps = m_iteration - sample.iteration;
+      sample.value += normal() * m_sigma * std::sqrt(Scalar(num_steps));
+      sample.value -= std::floor(sample.value);
+    }
+    sample.iteration = m_iteration;
+    return static_cast<std::uint32_t>(std::min(double(sample.value) * 0x1.0p32, double(max())));
+  }
+
+  static constexpr std::uint32_t min() { return 0; }
+  static constexpr std::uint32_t max() { return 0xffffffff; }
+
+  constexpr auto large_step() const { return m_large_step; }
+
+  constexpr auto mutate() {
+    ++m_iteration;
+    m_large_step = uniform(m_generator, Scalar(0), Scalar(1)) < m_large_step_probability;
+    m_index = 0;
+  }
+
+  constexpr auto accept() {
+    if (m_large_step) m_last_large_step = m_iteration;
+  }
+
+  constexpr auto reject() {
+    for (auto &sample : m_samples) {
+      if (sample.iteration != m_iteration) continue;
+      sample.value = sample.backup_value;
+      sample.iteration = sample.backup_iteration;
+    }
+    --m_iteration;
+  }
+
+ private:
+  struct Sample {
+    Scalar value = 0;
+    // iteration of the last mutation
+    std::size_t iteration = 0;
+    Scalar backup_value = 0;
+    std::size_t backup_iteration = 0;
+  };
+
+  // Box-Muller transform
+  constexpr auto normal() {
+    auto unit = std::max(uniform(m_generator, Scalar(0), Scalar(1)), std::numeric_limits<Scalar>::min());
+    auto radius = std::sqrt(-2 * std::log(unit));
+    return radius * std::cos(2 * std::numbers::pi_v<Scalar> * uniform(m_generator, Scalar(0), Scalar(1)));
+  }
+
+  Generator m_generator;
+  Scalar m_sigma;
+  Scalar m_large_step_probability;
+  std::vector<Sample> m_samples;
+  std::size_t m_index = 0;
+  std::size_t m_iteration = 0;
+  std::size_t m_last_large_step = 0;
+  // the first run draws every sample afresh
+  bool m_large_step = true;
+};
+
 }  // namespace pbpt::random
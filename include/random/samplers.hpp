@@ -8,46 +8,62 @@
 
 namespace pbpt::random {
 
-template <typename Scalar = double, template <typename, auto> typename Vector = pbpt::tensor::Vector>
+template <
+    typename Scalar = double, template <typename, auto> typename Vector = pbpt::tensor::Vector,
+    typename MathPolicy = pbpt::math::DefaultPolicy>
 constexpr auto uniform_on_unit_circle(auto &generator) -> Vector<Scalar, 2> {
-  auto theta = pbpt::random::uniform(generator, -std::numbers::pi, std::numbers::pi);
-  return {std::cos(theta), std::sin(theta)};
+  auto theta = pbpt::random::uniform(generator, -std::numbers::pi_v<Scalar>, std::numbers::pi_v<Scalar>);
+  auto [sin_theta, cos_theta] = MathPolicy::sincos(theta);
+  return {cos_theta, sin_theta};
 }
 
-template <typename Scalar = double, template <typename, auto> typename Vector = pbpt::tensor::Vector>
+template <
+    typename Scalar = double, template <typename, auto> typename Vector = pbpt::tensor::Vector,
+    typename MathPolicy = pbpt::math::DefaultPolicy>
 constexpr auto uniform_in_unit_circle(auto &generator) {
-  auto radius = pbpt::math::sqrt(pbpt::random::uniform(generator, 0.0, 1.0));
-  return uniform_on_unit_circle<Scalar, Vector>(generator) * radius;
+  auto radius = MathPolicy::sqrt(pbpt::random::uniform(generator, Scalar(0), Scalar(1)));
+  return uniform_on_unit_circle<Scalar, Vector, MathPolicy>(generator) * radius;
 }
 
-template <typename Scalar = double, template <typename, auto> typename Vector = pbpt::tensor::Vector>
+template <
+    typename Scalar = double, template <typename, auto> typename Vector = pbpt::tensor::Vector,
+    typename MathPolicy = pbpt::math::DefaultPolicy>
 constexpr auto uniform_on_unit_sphere(auto &generator) -> Vector<Scalar, 3> {
-  auto cos_theta = pbpt::random::uniform(generator, -1.0, 1.0);
-  auto sin_theta = pbpt::math::sqrt(1.0 - pbpt::math::square(cos_theta));
-  auto phi = pbpt::random::uniform(generator, -std::numbers::pi, std::numbers::pi);
-  return {sin_theta * std::cos(phi), sin_theta * std::sin(phi), cos_theta};
+  auto cos_theta = pbpt::random::uniform(generator, Scalar(-1), Scalar(1));
+  auto sin_theta = MathPolicy::sqrt(1 - pbpt::math::square(cos_theta));
+  auto phi = pbpt::random::uniform(generator, -std::numbers::pi_v<Scalar>, std::numbers::pi_v<Scalar>);
+  auto [sin_phi, cos_phi] = MathPolicy::sincos(phi);
+  return {sin_theta * cos_phi, sin_theta * sin_phi, cos_theta};
 }
 
-template <typename Scalar = double, template <typename, auto> typename Vector = pbpt::tensor::Vector>
+template <
+    typename Scalar = double, template <typename, auto> typename Vector = pbpt::tensor::Vector,
+    typename MathPolicy = pbpt::math::DefaultPolicy>
 constexpr auto uniform_in_unit_sphere(auto &generator) {
-  auto radius = pbpt::math::cbrt(pbpt::random::uniform(generator, 0.0, 1.0));
-  return uniform_on_unit_sphere<Scalar, Vector>(generator) * radius;
+  auto radius = MathPolicy::cbrt(pbpt::random::uniform(generator, Scalar(0), Scalar(1)));
+  return uniform_on_unit_sphere<Scalar, Vector, MathPolicy>(generator) * radius;
 }
 
-template <typename Scalar = double, template <typename, auto> typename Vector = pbpt::tensor::Vector>
+template <
+    typename Scalar = double, template <typename, auto> typename Vector = pbpt::tensor::Vector,
+    typename MathPolicy = pbpt::math::DefaultPolicy>
 constexpr auto uniform_on_unit_semisphere(auto &generator) -> Vector<Scalar, 3> {
-  auto cos_theta = pbpt::random::uniform(generator, 0.0, 1.0);
-  auto sin_theta = pbpt::math::sqrt(1.0 - pbpt::math::square(cos_theta));
-  auto phi = pbpt::random::uniform(generator, -std::numbers::pi, std::numbers::pi);
-  return {sin_theta * std::cos(phi), sin_theta * std::sin(phi), cos_theta};
+  auto cos_theta = pbpt::random::uniform(generator, Scalar(0), Scalar(1));
+  auto sin_theta = MathPolicy::sqrt(1 - pbpt::math::square(cos_theta));
+  auto phi = pbpt::random::uniform(generator, -std::numbers::pi_v<Scalar>, std::numbers::pi_v<Scalar>);
+  auto [sin_phi, cos_phi] = MathPolicy::sincos(phi);
+  return {sin_theta * cos_phi, sin_theta * sin_phi, cos_theta};
 }
 
-template <typename Scalar = double, template <typename, auto> typename Vector = pbpt::tensor::Vector>
+template <
+    typename Scalar = double, template <typename, auto> typename Vector = pbpt::tensor::Vector,
+    typename MathPolicy = pbpt::math::DefaultPolicy>
 constexpr auto cosine_on_unit_semisphere(auto &generator) -> Vector<Scalar, 3> {
-  auto cos_theta = pbpt::math::sqrt(pbpt::random::uniform(generator, 0.0, 1.0));
-  auto sin_theta = pbpt::math::sqrt(1.0 - pbpt::math::square(cos_theta));
-  auto phi = pbpt::random::uniform(generator, -std::numbers::pi, std::numbers::pi);
-  return {sin_theta * std::cos(phi), sin_theta * std::sin(phi), cos_theta};
+  auto cos_theta = MathPolicy::sqrt(pbpt::random::uniform(generator, Scalar(0), Scalar(1)));
+  auto sin_theta = MathPolicy::sqrt(1 - pbpt::math::square(cos_theta));
+  auto phi = pbpt::random::uniform(generator, -std::numbers::pi_v<Scalar>, std::numbers::pi_v<Scalar>);
+  auto [sin_phi, cos_phi] = MathPolicy::sincos(phi);
+  return {sin_theta * cos_phi, sin_theta * sin_phi, cos_theta};
 }
 
 }  // namespace pbpt::random
@@ -1 +1,16 @@
+#include "renderer/bdpt.hpp"
+#include "renderer/environment.hpp"
+#include "renderer/guiding.hpp"
+#include "renderer/interleaved.hpp"
+#include "renderer/lights.hpp"
+#include "renderer/mlt.hpp"
 #include "renderer/path_tracer.hpp"
+#include "renderer/photon_map.hpp"
+#include "renderer/preview.hpp"
+#include "renderer/radiance_cache.hpp"
+#include "renderer/restir.hpp"
+#include "renderer/scheduler.hpp"
+#include "renderer/sorting.hpp"
+#include "renderer/termination.hpp"
+#include "renderer/traversal.hpp"
+#include "renderer/utility.hpp"
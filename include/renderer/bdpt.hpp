@@ -0,0 +1,421 @@
+#pragma once
+
+#include <cmath>
+#include <optional>
+#include <type_traits>
+#include <vector>
+
+#include "lights.hpp"
+#include "material.hpp"
+#include "math.hpp"
+#include "optics.hpp"
+#include "random.hpp"
+#include "scheduler.hpp"
+#include "tensor.hpp"
+#include "utility.hpp"
+
+namespace pbpt::renderer {
+
+/****************************************************************
+ * Bidirectional Path Tracing (BDPT)
+ * Every pixel traces a camera subpath z_0 .. z_t from the lens and a light subpath y_0 .. y_s from a point
+ * on an emitter chosen by power, then joins every prefix pair with at most max_depth bounces:
+ *   s = 0:  z_t lies on an emitter,            C := β(z_t) Le(z_t)
+ *   s = 1:  a new point y on an emitter,        C := β(z_t) light_contribution(y) V / (p(emitter) p(y))
+ *   t = 1:  a new point z on the lens,          C := β(y_s) f(y_s) W(z) G(y_s, z) V, splatted where z sees y_s
+ *   else:                                       C := β(y_s) f(y_s) G(y_s, z_t) f(z_t) β(z_t) V
+ * Each C is weighted by the multiple importance sampling heuristic (see Heuristic) over all (s', t') able to
+ * produce the same path, from the densities per unit area of every vertex sampled from either side:
+ *   w_s,t := p_s,t^k / Σ p_s',t'^k
+ * with k := 2 for the power heuristic and k := 1 otherwise.
+ * Caustics, light reaching the camera through specular surfaces off a diffuse one, are found by t = 1.
+ * Specular vertices sample a direction only and never connect. Light subpaths leave emitters as sample_emission().
+ * The light traced to the camera is summed by atomic adds into a buffer added to the pixels once all are done.
+ ****************************************************************/
+template <
+    typename Scalar = double, template <typename, auto> typename Vector = pbpt::tensor::Vector,
+    typename Generator = pbpt::random::LinearCongruentialGenerator<>>
+constexpr auto bidirectional_path_tracer(
+    const auto &object, const auto &materials, const auto &lights, const auto &camera, auto background,
+    auto image_width, auto image_height, auto start_index, auto stop_index, std::size_t max_depth, auto random_seed,
+    const auto &pixel_selector, auto &image_writer
+) {
+  using Ray = std::decay_t<decltype(camera.ray(Scalar(0), Scalar(0), std::declval<Generator &>()))>;
+  using MaterialReference =
+      std::decay_t<decltype(object.intersect(std::declval<const Ray &>()).top().min().surface().material_reference())>;
+
+  enum class Kind { camera, light, surface };
+
+  // every member has a default, so vertices are built with designated initializers naming only what they set
+  struct Vertex {
+    Kind kind = Kind::surface;
+    Vector<Scalar, 3> position{};
+    Vector<Scalar, 3> normal{};
+    // towards the previous vertex of the subpath
+    Vector<Scalar, 3> out_direction{};
+    std::optional<MaterialReference> material_reference{};
+    std::optional<std::size_t> emitter_index{};
+    Vector<Scalar, 3> throughput{};
+    // radiance emitted along out_direction by a surface ending a camera subpath
+    Vector<Scalar, 3> emission{};
+    bool delta = false;
+    // densities per unit area of sampling the vertex from the previous and from the next vertex
+    Scalar pdf_forward = 0;
+    Scalar pdf_reverse = 0;
+  };
+
+  constexpr auto epsilon = pbpt::material::numbers::epsilon<Scalar>;
+
+  auto num_pixels = stop_index - start_index;
+  decltype(num_pixels) num_selected_pixels = 0;
+  for (auto pixel_index = start_index; pixel_index < stop_index; ++pixel_index) {
+    if (pixel_selector(pixel_index)) ++num_selected_pixels;
+  }
+  if (!num_selected_pixels) return;
+  // one light subpath per selected pixel lands on the whole screen, so every pixel sees the screen shrunk
+  // to the share of the pixels that traced one
+  auto screen_area = camera.screen_area() * Scalar(num_selected_pixels) / Scalar(image_width * image_height);
+
+  using PixelIndex = std::decay_t<decltype(start_index)>;
+  // the pixel whose jittered camera rays from the point of the lens pass through the position
+  auto pixel_of = [&](const Vector<Scalar, 3> &lens_position,
+                      const Vector<Scalar, 3> &position) -> std::optional<PixelIndex> {
+    auto coords = camera.raster(lens_position, position);
+    if (!coords) return std::nullopt;
+    auto [coord_u, coord_v] = coords.value();
+    auto pixel_u = static_cast<PixelIndex>(std::floor(coord_u * image_width + Scalar(0.5)));
+    auto pixel_v = static_cast<PixelIndex>(std::floor(coord_v * image_height + Scalar(0.5)));
+    if (pixel_u < 0 || pixel_u >= image_width || pixel_v < 0 || pixel_v >= image_height) return std::nullopt;
+    return pixel_v * image_width + pixel_u;
+  };
+
+  // ================================================================
+  // densities
+
+  // per solid angle at the vertex to per unit area at the next one
+  auto convert = [](Scalar pdf, const Vertex &vertex, const Vertex &next) {
+    auto displacement = next.position - vertex.position;
+    auto squared_distance = pbpt::tensor::dot(displacement, displacement);
+    if (next.kind != Kind::camera) {
+      pdf *= std::abs(pbpt::tensor::dot(next.normal, displacement)) / pbpt::math::sqrt(squared_distance);
+    }
+    return pdf / squared_distance;
+  };
+  auto camera_pdf = [&](const Vector<Scalar, 3> &lens_position, const Vector<Scalar, 3> &position) -> Scalar {
+    auto in_direction = pbpt::tensor::normalized(position - lens_position);
+    auto cos_theta = pbpt::tensor::dot(in_direction, camera.normal());
+    if (cos_theta <= 0 || !pixel_of(lens_position, position)) return 0;
+    return 1 / (screen_area * pbpt::math::pow<3>(cos_theta));
+  };
+  // the emitter at the vertex sending light to the next one
+  auto light_pdf = [&](const Vertex &vertex, const Vertex &next) {
+    auto out_direction = pbpt::tensor::normalized(next.position - vertex.position);
+    return convert(emission_pdf<Scalar>(vertex.normal, out_direction), vertex, next);
+  };
+  // the light subpath starting at the vertex
+  auto light_origin_pdf = [&](const Vertex &vertex) -> Scalar {
+    if (!vertex.emitter_index) return 0;
+    auto index = vertex.emitter_index.value();
+    return lights.pdf(index) * lights.emitters()[index].pdf(vertex.position);
+  };
+  // the vertex, reached from the previous one, sampling the next one
+  auto pdf = [&](const Vertex &vertex, const Vertex *previous, const Vertex &next) -> Scalar {
+    if (vertex.kind == Kind::light) return light_pdf(vertex, next);
+    if (vertex.kind == Kind::camera) return convert(camera_pdf(vertex.position, next.position), vertex, next);
+    auto out_direction = pbpt::tensor::normalized(previous->position - vertex.position);
+    auto in_direction = pbpt::tensor::normalized(next.position - vertex.position);
+    auto direction_pdf = material_pdf<Scalar>(
+        materials, vertex.material_reference.value(), out_direction, vertex.normal, in_direction
+    );
+    return convert(direction_pdf.value_or(Scalar(0)), vertex, next);
+  };
+
+  // ================================================================
+  // subpaths
+
+  // BRDF times the cosine of in_direction at a surface vertex, scattering towards out_direction
+  auto reflectance = [&](const Vertex &vertex, const Vector<Scalar, 3> &in_direction) -> Vector<Scalar, 3> {
+    return material_reflectance<Scalar, Vector>(
+        materials, vertex.material_reference.value(), vertex.out_direction, vertex.normal, in_direction
+    );
+  };
+  auto connectible = [&](const Vertex &vertex) {
+    if (vertex.kind != Kind::surface) return true;
+    return !vertex.delta && evaluable(materials, vertex.material_reference.value(), vertex.normal);
+  };
+
+  // extends the path from its last vertex along the ray, sampled there with density direction_pdf per solid angle,
+  // until it holds max_vertices or stops on an emitter; escaped rays are handed to escape(throughput, ray)
+  auto random_walk = [&](std::vector<Vertex> &path, Ray ray, Vector<Scalar, 3> throughput, Scalar direction_pdf,
+                         std::size_t max_vertices, auto &generator, const auto &escape) {
+    while (path.size() < max_vertices) {
+      auto traced_ray = closest_hit(
+          object, ray,
+          [&](const auto &ray, const auto &normal, const auto &material_reference) -> std::optional<Ray> {
+            auto vertex = Vertex{
+                .kind = Kind::surface,
+                .position = ray.position(),
+                .normal = normal,
+                .out_direction = -ray.direction(),
+                .material_reference = material_reference,
+                .emitter_index = lights.find(material_reference),
+                .throughput = throughput,
+            };
+            vertex.pdf_forward = convert(direction_pdf, path.back(), vertex);
+            auto [radiance, traced_ray] = materials(material_reference, ray, normal, generator);
+            if (!traced_ray) {
+              vertex.emission = radiance;
+              path.push_back(std::move(vertex));
+              return std::nullopt;
+            }
+            path.push_back(std::move(vertex));
+            if (path.size() == max_vertices) return std::nullopt;
+
+            auto &current = path.back();
+            auto &previous = path[path.size() - 2];
+            const auto &out_direction = current.out_direction;
+            const auto &in_direction = traced_ray.value().direction();
+            throughput = throughput * radiance * traced_ray.value().weight();
+            if (evaluable(materials, material_reference, normal)) {
+              auto forward_pdf =
+                  material_pdf<Scalar>(materials, material_reference, out_direction, normal, in_direction);
+              auto reverse_pdf =
+                  material_pdf<Scalar>(materials, material_reference, in_direction, normal, out_direction);
+              direction_pdf = forward_pdf.value_or(Scalar(0));
+              previous.pdf_reverse = convert(reverse_pdf.value_or(Scalar(0)), current, previous);
+            } else {
+              current.delta = true;
+              direction_pdf = 0;
+              previous.pdf_reverse = 0;
+            }
+            return Ray(traced_ray.value().position(), in_direction, 1);
+          },
+          [&]() -> std::optional<Ray> {
+            escape(throughput, ray);
+            return std::nullopt;
+          }
+      );
+      if (!traced_ray) break;
+      ray = std::move(traced_ray.value());
+    }
+  };
+
+  // ================================================================
+  // multiple importance sampling
+
+  auto heuristic = [&](Scalar pdf) {
+    // a density of zero marks a specular vertex, which no other technique can sample anyway
+    if (pdf == 0) pdf = 1;
+    return lights.heuristic() == Heuristic::power ? pdf * pdf : pdf;
+  };
+  // weight of joining the first s vertices of the light subpath with the first t of the camera subpath,
+  // where a vertex sampled for the join replaces the last of a single-vertex prefix
+  auto mis_weight = [&](const std::vector<Vertex> &light_path, const std::vector<Vertex> &camera_path, std::size_t s,
+                        std::size_t t, const Vertex *sampled) -> Scalar {
+    if (s + t == 2) return 1;
+    const auto *light_end = s ? (s == 1 && sampled ? sampled : &light_path[s - 1]) : nullptr;
+    const auto *camera_end = t == 1 && sampled ? sampled : &camera_path[t - 1];
+    const auto *light_previous = s > 1 ? &light_path[s - 2] : nullptr;
+    const auto *camera_previous = t > 1 ? &camera_path[t - 2] : nullptr;
+    // emission reached only by the camera subpath cannot be sampled from the lights
+    if (!s && !camera_end->emitter_index) return 1;
+
+    // the densities of sampling the ends of the join and their predecessors from the other side
+    auto camera_end_reverse = s ? pdf(*light_end, light_previous, *camera_end) : light_origin_pdf(*camera_end);
+    auto camera_previous_reverse =
+        !camera_previous ? Scalar(0)
+        : s              ? pdf(*camera_end, light_end, *camera_previous)
+                         : light_pdf(*camera_end, *camera_previous);
+    auto light_end_reverse = s ? pdf(*camera_end, camera_previous, *light_end) : Scalar(0);
+    auto light_previous_reverse = light_previous ? pdf(*light_end, camera_end, *light_previous) : Scalar(0);
+
+    // ratios of the densities of the other techniques to this one, walking away from the join on either side
+    Scalar sum = 0, ratio = 1;
+    for (auto index = t - 1; index > 0; --index) {
+      const auto &vertex = index == t - 1 ? *camera_end : camera_path[index];
+      auto reverse_pdf = index == t - 1   ? camera_end_reverse
+                         : index == t - 2 ? camera_previous_reverse
+                                          : vertex.pdf_reverse;
+      ratio *= heuristic(reverse_pdf) / heuristic(vertex.pdf_forward);
+      auto delta = index != t - 1 && vertex.delta;
+      if (!delta && !camera_path[index - 1].delta) sum += ratio;
+    }
+    ratio = 1;
+    for (auto index = s; index-- > 0;) {
+      const auto &vertex = index == s - 1 ? *light_end : light_path[index];
+      auto reverse_pdf = index == s - 1   ? light_end_reverse
+                         : index == s - 2 ? light_previous_reverse
+                                          : vertex.pdf_reverse;
+      ratio *= heuristic(reverse_pdf) / heuristic(vertex.pdf_forward);
+      auto delta = index != s - 1 && vertex.delta;
+      if (!delta && !(index && light_path[index - 1].delta)) sum += ratio;
+    }
+    return 1 / (1 + sum);
+  };
+
+  // ================================================================
+  // rendering
+
+  std::vector<Vector<Scalar, 3>> radiances(num_pixels);
+  // light traced to the camera, per pixel and channel
+  std::vector<Scalar> splats(3 * num_pixels);
+  auto splat = [&](PixelIndex pixel_index, const Vector<Scalar, 3> &radiance) {
+    for (std::size_t channel = 0; channel < 3; ++channel) {
+#ifdef _OPENMP
+#pragma omp atomic
+#endif
+      splats[3 * (pixel_index - start_index) + channel] += radiance[channel];
+    }
+  };
+
+#ifdef _OPENMP
+#pragma omp parallel for
+#endif
+  for (auto pixel_index = start_index; pixel_index < stop_index; ++pixel_index) {
+    if (!pixel_selector(pixel_index)) continue;
+
+    Generator generator(random_seed + pixel_index);
+    auto uniform = [&]() { return pbpt::random::uniform(generator, Scalar(0), Scalar(1)); };
+    Vector<Scalar, 3> radiance{};
+
+    // camera subpath
+    std::vector<Vertex> camera_path;
+    camera_path.reserve(max_depth + 2);
+    auto primary_ray = camera_ray<Scalar>(camera, pixel_index, image_width, image_height, generator);
+    auto camera_weight = primary_ray.weight();
+    camera_path.push_back(Vertex{
+        .kind = Kind::camera,
+        .position = primary_ray.position(),
+        .normal = camera.normal(),
+        .throughput = Vector<Scalar, 3>{camera_weight, camera_weight, camera_weight},
+    });
+    random_walk(
+        camera_path, Ray(primary_ray.position(), primary_ray.direction(), 1), camera_path.front().throughput,
+        camera_pdf(primary_ray.position(), primary_ray.position() + primary_ray.direction()), max_depth + 2, generator,
+        // only the camera subpath reaches the background
+        [&](const auto &throughput, const auto &ray) { radiance = radiance + throughput * background(ray); }
+    );
+
+    // light subpath
+    std::vector<Vertex> light_path;
+    light_path.reserve(max_depth + 1);
+    if (auto emitter_sample = lights.sample(uniform())) {
+      auto [emitter, emitter_probability] = emitter_sample.value();
+      auto [light_position, light_normal] = emitter.sample(uniform(), uniform());
+      auto origin_pdf = emitter_probability * emitter.pdf(light_position);
+      auto out_direction = sample_emission<Scalar, Vector>(light_normal, generator);
+      auto cos_theta = pbpt::tensor::dot(out_direction, light_normal);
+      auto direction_pdf = emission_pdf<Scalar>(light_normal, out_direction);
+      if (origin_pdf > 0 && direction_pdf > 0) {
+        // the emissive material gives Le(y, ω) (ω · n_y) along the ray arriving from ω
+        auto emission_ray = Ray(light_position, -out_direction, 1);
+        auto emittance = std::get<0>(materials(emitter.material_reference(), emission_ray, light_normal, generator));
+        light_path.push_back(Vertex{
+            .kind = Kind::light,
+            .position = light_position,
+            .normal = light_normal,
+            .material_reference = emitter.material_reference(),
+            .emitter_index = lights.find(emitter.material_reference()),
+            .throughput = emittance / origin_pdf,
+            .pdf_forward = origin_pdf,
+        });
+        random_walk(
+            light_path, Ray(pbpt::tensor::evaluate(light_position + epsilon * light_normal), out_direction, 1),
+            emittance * (cos_theta / (origin_pdf * direction_pdf)), direction_pdf, max_depth + 1, generator,
+            [](const auto &, const auto &) {}
+        );
+      }
+    }
+
+    // joins
+    for (std::size_t t = 1; t <= camera_path.size(); ++t) {
+      for (std::size_t s = 0; s <= light_path.size(); ++s) {
+        if ((s == 1 && t == 1) || s + t < 2 || s + t - 2 > max_depth) continue;
+        const auto &camera_end = camera_path[t - 1];
+
+        if (s == 0) {
+          // the camera subpath has run into an emitter
+          if (camera_end.kind != Kind::surface) continue;
+          auto contribution = camera_end.throughput * camera_end.emission;
+          if (pbpt::tensor::max(contribution) == 0 && pbpt::tensor::min(contribution) == 0) continue;
+          radiance = radiance + contribution * mis_weight(light_path, camera_path, s, t, nullptr);
+        } else if (t == 1) {
+          // the light subpath is seen through a point of the lens
+          const auto &light_end = light_path[s - 1];
+          if (!connectible(light_end)) continue;
+          auto lens_position = camera.sample_lens(generator);
+          auto target_index = pixel_of(lens_position, light_end.position);
+          if (!target_index) continue;
+          auto target_pixel = target_index.value();
+          if (target_pixel < start_index || target_pixel >= stop_index || !pixel_selector(target_pixel)) continue;
+          auto displacement = light_end.position - lens_position;
+          auto squared_distance = pbpt::tensor::dot(displacement, displacement);
+          auto in_direction = pbpt::tensor::evaluate(displacement / pbpt::math::sqrt(squared_distance));
+          auto cos_theta = pbpt::tensor::dot(in_direction, camera.normal());
+          if (cos_theta <= 0) continue;
+          auto contribution = light_end.throughput * reflectance(light_end, -in_direction) *
+                              (camera.weight(in_direction) /
+                               (screen_area * pbpt::math::pow<3>(cos_theta) * squared_distance));
+          if (pbpt::tensor::max(contribution) <= 0) continue;
+          auto light_origin = pbpt::tensor::evaluate(light_end.position + epsilon * light_end.normal);
+          if (!visible<Scalar, Vector>(object, light_origin, lens_position)) continue;
+          auto sampled = Vertex{.kind = Kind::camera, .position = lens_position, .normal = camera.normal()};
+          splat(target_pixel, contribution * mis_weight(light_path, camera_path, s, t, &sampled));
+        } else if (s == 1) {
+          // a new point on an emitter, chosen as for the light subpaths
+          if (!connectible(camera_end)) continue;
+          auto emitter_sample = lights.sample(uniform());
+          if (!emitter_sample) continue;
+          auto [emitter, emitter_probability] = emitter_sample.value();
+          auto [light_position, light_normal] = emitter.sample(uniform(), uniform());
+          auto origin_pdf = emitter_probability * emitter.pdf(light_position);
+          if (origin_pdf <= 0) continue;
+          auto end_ray = Ray(camera_end.position, -camera_end.out_direction, 1);
+          auto contribution = camera_end.throughput * light_contribution<Scalar, Vector>(
+                                                          materials, end_ray, camera_end.normal,
+                                                          camera_end.material_reference.value(), emitter,
+                                                          light_position, light_normal, generator
+                                                      ) /
+                              origin_pdf;
+          if (pbpt::tensor::max(contribution) <= 0) continue;
+          auto receiver = pbpt::tensor::evaluate(camera_end.position + epsilon * camera_end.normal);
+          if (!visible<Scalar, Vector>(object, receiver, light_position)) continue;
+          auto sampled = Vertex{
+              .kind = Kind::light,
+              .position = light_position,
+              .normal = light_normal,
+              .material_reference = emitter.material_reference(),
+              .emitter_index = lights.find(emitter.material_reference()),
+              .pdf_forward = origin_pdf,
+          };
+          radiance = radiance + contribution * mis_weight(light_path, camera_path, s, t, &sampled);
+        } else {
+          // both subpaths end on surfaces that scatter
+          const auto &light_end = light_path[s - 1];
+          if (!connectible(camera_end) || !connectible(light_end)) continue;
+          auto displacement = light_end.position - camera_end.position;
+          auto squared_distance = pbpt::tensor::dot(displacement, displacement);
+          auto in_direction = pbpt::tensor::evaluate(displacement / pbpt::math::sqrt(squared_distance));
+          auto contribution = light_end.throughput * reflectance(light_end, -in_direction) *
+                              reflectance(camera_end, in_direction) * camera_end.throughput / squared_distance;
+          if (pbpt::tensor::max(contribution) <= 0) continue;
+          auto receiver = pbpt::tensor::evaluate(camera_end.position + epsilon * camera_end.normal);
+          if (!visible<Scalar, Vector>(object, receiver, light_end.position)) continue;
+          radiance = radiance + contribution * mis_weight(light_path, camera_path, s, t, nullptr);
+        }
+      }
+    }
+
+    radiances[pixel_index - start_index] = radiance;
+  }
+
+  for (auto pixel_index = start_index; pixel_index < stop_index; ++pixel_index) {
+    if (!pixel_selector(pixel_index)) continue;
+    auto local_index = pixel_index - start_index;
+    auto splat_radiance =
+        Vector<Scalar, 3>{splats[3 * local_index], splats[3 * local_index + 1], splats[3 * local_index + 2]};
+    image_writer(pixel_index, radiances[local_index] + splat_radiance);
+  }
+}
+
+}  // namespace pbpt::renderer
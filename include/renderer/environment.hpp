@@ -0,0 +1,186 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <memory>
+#include <numbers>
+#include <optional>
+#include <tuple>
+#include <vector>
+
+#include "lights.hpp"
+#include "material.hpp"
+#include "math.hpp"
+#include "optics.hpp"
+#include "random.hpp"
+#include "tensor.hpp"
+#include "utility.hpp"
+
+namespace pbpt::renderer {
+
+/****************************************************************
+ * Environment Map
+ * Radiance arriving from infinitely far away, read from a latitude-longitude image whose rows run from the zenith
+ * to the nadir and whose columns run around the vertical axis: in the local frame, where y is up,
+ *   (x, y, z) := (sin θ cos φ, cos θ, sin θ sin φ), column := (φ + π) W / 2π, row := θ H / π
+ * and world := rotation % local. It is a background, so env(ray) is the radiance along the ray times its weight,
+ * and it samples the directions it shines from: an alias table picks pixels in proportion to their luminance
+ * times sin θ, and the direction is uniform in (φ, θ) within the pixel, so
+ *   pdf(wi) := p(pixel) W H / (2π^2 sin θ)
+ * per solid angle, matching the piecewise constant radiance. Copies share the image.
+ ****************************************************************/
+template <
+    typename Scalar = double, template <typename, auto> typename Vector = pbpt::tensor::Vector,
+    template <typename, auto, auto> typename Matrix = pbpt::tensor::Matrix>
+class EnvironmentMap {
+ public:
+  EnvironmentMap(
+      std::vector<Vector<Scalar, 3>> colors, std::size_t width, std::size_t height,
+      const Matrix<Scalar, 3, 3> &rotation
+  )
+      : m_image(std::make_shared<Image>(std::move(colors), width, height)), m_rotation(rotation) {}
+
+  auto &rotation() & { return m_rotation; }
+  const auto &rotation() const & { return m_rotation; }
+  auto &&rotation() && { return std::move(m_rotation); }
+  const auto &&rotation() const && { return std::move(m_rotation); }
+
+  auto width() const { return m_image->width; }
+  auto height() const { return m_image->height; }
+
+  auto operator()(const auto &ray) const { return radiance(ray.direction()) * ray.weight(); }
+
+  auto radiance(const Vector<Scalar, 3> &direction) const -> Vector<Scalar, 3> {
+    return m_image->colors[pixel(direction)];
+  }
+
+  // Direction wi towards the environment, with pdf(wi); the pdf is zero for a black environment.
+  auto sample(auto &generator) const -> std::tuple<Vector<Scalar, 3>, Scalar> {
+    const auto &image = *m_image;
+    if (image.table.empty()) return {Vector<Scalar, 3>{0, 1, 0}, Scalar(0)};
+    auto index = image.table.sample(pbpt::random::uniform(generator, Scalar(0), Scalar(1)));
+    auto row = index / image.width;
+    auto column = index % image.width;
+    auto phi = (Scalar(column) + pbpt::random::uniform(generator, Scalar(0), Scalar(1))) /
+                   Scalar(image.width) * 2 * std::numbers::pi_v<Scalar> -
+               std::numbers::pi_v<Scalar>;
+    auto theta = (Scalar(row) + pbpt::random::uniform(generator, Scalar(0), Scalar(1))) / Scalar(image.height) *
+                 std::numbers::pi_v<Scalar>;
+    auto sin_theta = std::sin(theta);
+    auto local = Vector<Scalar, 3>{sin_theta * std::cos(phi), std::cos(theta), sin_theta * std::sin(phi)};
+    auto direction = pbpt::tensor::evaluate(m_rotation % local);
+    return {direction, density(index, sin_theta)};
+  }
+
+  // Density per solid angle with which sample() returns the direction.
+  auto pdf(const Vector<Scalar, 3> &direction) const -> Scalar {
+    auto [local_x, local_y, local_z] = local(direction);
+    auto sin_theta = pbpt::math::sqrt(std::max(local_x * local_x + local_z * local_z, Scalar(0)));
+    return density(pixel(direction), sin_theta);
+  }
+
+ private:
+  struct Image {
+    Image(std::vector<Vector<Scalar, 3>> colors, std::size_t width, std::size_t height)
+        : colors(std::move(colors)), width(width), height(height) {
+      std::vector<Scalar> weights(width * height);
+      for (std::size_t row = 0; row < height; ++row) {
+        auto sin_theta = std::sin((Scalar(row) + Scalar(0.5)) / Scalar(height) * std::numbers::pi_v<Scalar>);
+        for (std::size_t column = 0; column < width; ++column) {
+          auto [red, green, blue] = this->colors[row * width + column];
+          // Rec. 709 luminance
+          auto luminance = Scalar(0.2126) * red + Scalar(0.7152) * green + Scalar(0.0722) * blue;
+          weights[row * width + column] = std::max(luminance, Scalar(0)) * sin_theta;
+        }
+      }
+      table = pbpt::random::AliasTable<Scalar>(weights);
+    }
+
+    std::vector<Vector<Scalar, 3>> colors;
+    std::size_t width;
+    std::size_t height;
+    pbpt::random::AliasTable<Scalar> table;
+  };
+
+  auto local(const Vector<Scalar, 3> &direction) const -> Vector<Scalar, 3> {
+    return pbpt::tensor::evaluate(pbpt::tensor::transposed(m_rotation) % direction);
+  }
+
+  auto pixel(const Vector<Scalar, 3> &direction) const -> std::size_t {
+    const auto &image = *m_image;
+    auto [local_x, local_y, local_z] = local(direction);
+    auto theta = std::acos(pbpt::math::clamp(local_y, Scalar(-1), Scalar(1)));
+    auto phi = std::atan2(local_z, local_x);
+    auto column = static_cast<std::size_t>(
+        (phi + std::numbers::pi_v<Scalar>) / (2 * std::numbers::pi_v<Scalar>) * Scalar(image.width)
+    );
+    auto row = static_cast<std::size_t>(theta / std::numbers::pi_v<Scalar> * Scalar(image.height));
+    return std::min(row, image.height - 1) * image.width + std::min(column, image.width - 1);
+  }
+
+  auto density(std::size_t index, Scalar sin_theta) const -> Scalar {
+    const auto &image = *m_image;
+    if (sin_theta <= 0) return 0;
+    auto num_pixels = Scalar(image.width * image.height);
+    return image.table.pdf(index) * num_pixels /
+           (2 * std::numbers::pi_v<Scalar> * std::numbers::pi_v<Scalar> * sin_theta);
+  }
+
+  std::shared_ptr<const Image> m_image;
+  Matrix<Scalar, 3, 3> m_rotation;
+};
+
+/****************************************************************
+ * Environment Next-Event Estimation
+ * At a vertex whose material has a BRDF to evaluate, and for backgrounds that sample the directions they shine
+ * from (see EnvironmentMap), connects to a direction sampled from the background:
+ *   Le := w_light * BRDF(x, wi, wo) (wi · n) * Lenv(wi) / p_env(wi)
+ * where a shadow ray towards infinity tests visibility, and w_light is the weight against sampling wi from the
+ * material, as for the emitters (see Heuristic). Returns nothing otherwise.
+ ****************************************************************/
+template <typename Scalar = double, template <typename, auto> typename Vector = pbpt::tensor::Vector>
+constexpr auto environment_event(
+    const auto &object, const auto &materials, const auto &lights, const auto &background, const auto &ray,
+    const auto &normal, const auto &material_reference, auto &generator
+) -> std::optional<Vector<Scalar, 3>> {
+  if constexpr (requires { background.sample(generator); }) {
+    if (!evaluable(materials, material_reference, normal)) return std::nullopt;
+    auto [in_direction, light_pdf] = background.sample(generator);
+    if (light_pdf <= 0) return Vector<Scalar, 3>{};
+    auto out_direction = -ray.direction();
+    auto reflectance =
+        material_reflectance<Scalar, Vector>(materials, material_reference, out_direction, normal, in_direction);
+    if (pbpt::tensor::max(reflectance) <= 0) return Vector<Scalar, 3>{};
+
+    auto receiver = pbpt::tensor::evaluate(ray.position() + pbpt::material::numbers::epsilon<Scalar> * normal);
+    auto shadow_ray = pbpt::optics::Ray<Scalar, Vector>(receiver, in_direction, 1);
+    auto occluded = closest_hit(
+        object, shadow_ray, [](const auto &, const auto &, const auto &) constexpr { return true; },
+        []() constexpr { return false; }
+    );
+    if (occluded) return Vector<Scalar, 3>{};
+
+    auto scattering_pdf =
+        material_pdf<Scalar>(materials, material_reference, out_direction, normal, in_direction).value_or(Scalar(0));
+    auto weight = lights.light_weight(light_pdf, scattering_pdf);
+    return reflectance * background.radiance(in_direction) * (weight * ray.weight() / light_pdf);
+  } else {
+    return std::nullopt;
+  }
+}
+
+// Weight of the background found by a ray sampled with material_pdf at a vertex that also sampled the background
+// (nothing when it did not, or when the background cannot be sampled).
+template <typename Scalar = double>
+constexpr auto background_weight(
+    const auto &lights, const auto &background, const auto &ray, const std::optional<Scalar> &material_pdf
+) -> Scalar {
+  if constexpr (requires { background.pdf(ray.direction()); }) {
+    if (!material_pdf) return 1;
+    return lights.material_weight(material_pdf.value(), background.pdf(ray.direction()));
+  } else {
+    return 1;
+  }
+}
+
+}  // namespace pbpt::renderer
@@ -0,0 +1,390 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <numbers>
+#include <optional>
+#include <tuple>
+#include <vector>
+
+#include "lights.hpp"
+#include "material.hpp"
+#include "math.hpp"
+#include "optics.hpp"
+#include "random.hpp"
+#include "scheduler.hpp"
+#include "tensor.hpp"
+#include "termination.hpp"
+#include "utility.hpp"
+
+namespace pbpt::renderer {
+
+/****************************************************************
+ * Directional Quadtree
+ * Incident radiance over the sphere of directions, mapped to the unit square by the equal-area mapping
+ *   (x, y) := ((cos θ + 1) / 2, φ / 2π)
+ * so that a density p over the square is p / 4π per solid angle. Every node holds the energy recorded in its four
+ * quadrants and the children subdividing them (0 for quadrants that are leaves, as the root is nobody's child).
+ * Recording adds to the nodes on the path with atomics, so any number of threads may record at once as long as
+ * nobody refines the tree meanwhile.
+ ****************************************************************/
+template <typename Scalar = double, template <typename, auto> typename Vector = pbpt::tensor::Vector>
+struct DirectionalQuadtree {
+  struct Node {
+    std::array<Scalar, 4> energies{};
+    std::array<std::uint32_t, 4> children{};
+  };
+
+  auto &nodes() & { return m_nodes; }
+  const auto &nodes() const & { return m_nodes; }
+  auto &&nodes() && { return std::move(m_nodes); }
+  const auto &&nodes() const && { return std::move(m_nodes); }
+
+  auto energy() const { return total(m_nodes.front()); }
+
+  auto record(const Vector<Scalar, 3> &direction, Scalar energy) {
+    auto [x, y] = square(direction);
+    for (std::uint32_t index = 0;;) {
+      auto quadrant = descend(x, y);
+      auto &node_energy = m_nodes[index].energies[quadrant];
+#ifdef _OPENMP
+#pragma omp atomic
+#endif
+      node_energy += energy;
+      index = m_nodes[index].children[quadrant];
+      if (!index) break;
+    }
+  }
+
+  // Density per solid angle, uniform over the sphere while nothing has been recorded.
+  auto pdf(const Vector<Scalar, 3> &direction) const -> Scalar {
+    constexpr auto uniform_pdf = 1 / (4 * std::numbers::pi_v<Scalar>);
+    if (energy() <= 0) return uniform_pdf;
+    auto [x, y] = square(direction);
+    Scalar density = 1;
+    for (std::uint32_t index = 0;;) {
+      const auto &node = m_nodes[index];
+      auto quadrant = descend(x, y);
+      density *= 4 * node.energies[quadrant] / total(node);
+      index = node.children[quadrant];
+      if (!index || density <= 0) break;
+    }
+    return density * uniform_pdf;
+  }
+
+  auto sample(auto &generator) const -> Vector<Scalar, 3> {
+    if (energy() <= 0) return pbpt::random::uniform_on_unit_sphere<Scalar, Vector>(generator);
+    Scalar x = 0, y = 0, size = 1;
+    for (std::uint32_t index = 0;;) {
+      const auto &node = m_nodes[index];
+      auto energy = pbpt::random::uniform(generator, Scalar(0), total(node));
+      std::size_t quadrant = 0;
+      while (quadrant < 3 && energy >= node.energies[quadrant]) energy -= node.energies[quadrant++];
+      size /= 2;
+      x += (quadrant & 1) * size;
+      y += (quadrant >> 1) * size;
+      index = node.children[quadrant];
+      if (!index) break;
+    }
+    x += pbpt::random::uniform(generator, Scalar(0), size);
+    y += pbpt::random::uniform(generator, Scalar(0), size);
+    return direction(x, y);
+  }
+
+  // Empty tree subdividing every quadrant that holds more than the fraction of the energy, down to max_depth levels.
+  // Quadrants split further than they were assume their energy spreads evenly.
+  auto refined(Scalar fraction, std::size_t max_depth) const {
+    constexpr auto none = ~std::uint32_t{0};
+    DirectionalQuadtree tree;
+    auto threshold = fraction * energy();
+    auto subdivide = [&](auto self, std::array<Scalar, 4> energies, std::uint32_t source, std::uint32_t target,
+                         std::size_t depth) -> void {
+      if (depth >= max_depth) return;
+      for (std::size_t quadrant = 0; quadrant < 4; ++quadrant) {
+        if (energies[quadrant] <= threshold) continue;
+        auto child = static_cast<std::uint32_t>(tree.m_nodes.size());
+        tree.m_nodes.emplace_back();
+        tree.m_nodes[target].children[quadrant] = child;
+        auto source_child = source == none ? 0 : m_nodes[source].children[quadrant];
+        if (source_child) {
+          self(self, m_nodes[source_child].energies, source_child, child, depth + 1);
+        } else {
+          auto share = energies[quadrant] / 4;
+          self(self, {share, share, share, share}, none, child, depth + 1);
+        }
+      }
+    };
+    if (threshold > 0) subdivide(subdivide, m_nodes.front().energies, 0, 0, 1);
+    return tree;
+  }
+
+ private:
+  static auto total(const Node &node) {
+    return node.energies[0] + node.energies[1] + node.energies[2] + node.energies[3];
+  }
+
+  static auto square(const Vector<Scalar, 3> &direction) -> std::tuple<Scalar, Scalar> {
+    auto [direction_x, direction_y, direction_z] = direction;
+    auto x = pbpt::math::clamp((direction_z + 1) / 2, Scalar(0), Scalar(1));
+    auto y = (std::atan2(direction_y, direction_x) + std::numbers::pi_v<Scalar>) / (2 * std::numbers::pi_v<Scalar>);
+    return {x, pbpt::math::clamp(y, Scalar(0), Scalar(1))};
+  }
+
+  static auto direction(Scalar x, Scalar y) -> Vector<Scalar, 3> {
+    auto cos_theta = 2 * x - 1;
+    auto sin_theta = pbpt::math::sqrt(std::max(1 - cos_theta * cos_theta, Scalar(0)));
+    auto phi = 2 * std::numbers::pi_v<Scalar> * y - std::numbers::pi_v<Scalar>;
+    return {sin_theta * std::cos(phi), sin_theta * std::sin(phi), cos_theta};
+  }
+
+  // Quadrant of the point, which is then mapped to the unit square of that quadrant.
+  static auto descend(Scalar &x, Scalar &y) -> std::size_t {
+    auto upper_x = x >= Scalar(0.5), upper_y = y >= Scalar(0.5);
+    x = 2 * x - upper_x;
+    y = 2 * y - upper_y;
+    return upper_x + 2 * upper_y;
+  }
+
+  std::vector<Node> m_nodes = std::vector<Node>(1);
+};
+
+/****************************************************************
+ * Path Guide
+ * Incident radiance learned online while rendering (reference: Müller et al., Practical Path Guiding for
+ * Efficient Light-Transport Simulation). Space between lower and upper is split by a binary tree, halving along
+ * x, y and z in turn, and every leaf holds two directional quadtrees: one to sample from, learned in the previous
+ * iteration, and one recording the radiance estimates Li / p of the current iteration. Positions outside the bounds
+ * fall into the nearest leaf.
+ * Iteration k lasts 2^k passes; at its end the leaves with more than c sqrt(2^k) records are split, the recording
+ * quadtrees become the sampling ones and are refined into the next recording ones. Learning stops after the given
+ * number of iterations, and the last sampling quadtrees are kept from then on.
+ ****************************************************************/
+template <typename Scalar = double, template <typename, auto> typename Vector = pbpt::tensor::Vector>
+class PathGuide {
+ public:
+  PathGuide(const Vector<Scalar, 3> &lower, const Vector<Scalar, 3> &upper, std::size_t num_iterations)
+      : m_lower(lower), m_upper(upper), m_num_iterations(num_iterations) {}
+
+  auto &lower() & { return m_lower; }
+  const auto &lower() const & { return m_lower; }
+  auto &&lower() && { return std::move(m_lower); }
+  const auto &&lower() const && { return std::move(m_lower); }
+
+  auto &upper() & { return m_upper; }
+  const auto &upper() const & { return m_upper; }
+  auto &&upper() && { return std::move(m_upper); }
+  const auto &&upper() const && { return std::move(m_upper); }
+
+  auto &num_iterations() & { return m_num_iterations; }
+  const auto &num_iterations() const & { return m_num_iterations; }
+  auto &&num_iterations() && { return std::move(m_num_iterations); }
+  const auto &&num_iterations() const && { return std::move(m_num_iterations); }
+
+  // Whether there is anything to sample from yet, and whether radiance is still recorded.
+  auto guiding() const { return m_iteration > 0; }
+  auto learning() const { return m_iteration < m_num_iterations; }
+
+  auto pdf(const Vector<Scalar, 3> &position, const Vector<Scalar, 3> &direction) const {
+    return m_leaves[leaf(position)].sampling.pdf(direction);
+  }
+
+  auto sample(const Vector<Scalar, 3> &position, auto &generator) const {
+    return m_leaves[leaf(position)].sampling.sample(generator);
+  }
+
+  auto record(const Vector<Scalar, 3> &position, const Vector<Scalar, 3> &direction, Scalar radiance) {
+    if (!learning() || !std::isfinite(radiance) || radiance < 0) return;
+    auto &target = m_leaves[leaf(position)];
+    target.recording.record(direction, radiance);
+#ifdef _OPENMP
+#pragma omp atomic
+#endif
+    ++target.num_records;
+  }
+
+  // To be called after every pass, while no thread records.
+  auto end_pass() {
+    if (!learning() || ++m_num_passes < (std::size_t{1} << m_iteration)) return;
+    m_num_passes = 0;
+    refine();
+    ++m_iteration;
+  }
+
+ private:
+  // reference: Müller et al. split the leaves beyond c = 12000 records and quadrants beyond 1% of the energy
+  static constexpr auto spatial_threshold = Scalar(12000);
+  static constexpr auto directional_threshold = Scalar(0.01);
+  static constexpr std::size_t max_depth = 20;
+
+  struct Node {
+    // children are both 0 at leaves, whose quadtrees are m_leaves[leaf]
+    std::array<std::uint32_t, 2> children{};
+    std::uint32_t leaf = 0;
+  };
+
+  struct Leaf {
+    DirectionalQuadtree<Scalar, Vector> sampling;
+    DirectionalQuadtree<Scalar, Vector> recording;
+    std::size_t num_records = 0;
+  };
+
+  auto leaf(const Vector<Scalar, 3> &position) const {
+    auto [position_x, position_y, position_z] = position;
+    auto [lower_x, lower_y, lower_z] = m_lower;
+    auto [upper_x, upper_y, upper_z] = m_upper;
+    auto coordinate = [](Scalar value, Scalar lower, Scalar upper) {
+      return pbpt::math::clamp((value - lower) / (upper - lower), Scalar(0), Scalar(1));
+    };
+    std::array<Scalar, 3> coordinates = {
+        coordinate(position_x, lower_x, upper_x),
+        coordinate(position_y, lower_y, upper_y),
+        coordinate(position_z, lower_z, upper_z),
+    };
+    std::uint32_t index = 0;
+    for (std::size_t axis = 0; m_nodes[index].children[0]; axis = (axis + 1) % 3) {
+      auto &coordinate_value = coordinates[axis];
+      auto upper = coordinate_value >= Scalar(0.5);
+      coordinate_value = 2 * coordinate_value - upper;
+      index = m_nodes[index].children[upper];
+    }
+    return m_nodes[index].leaf;
+  }
+
+  auto refine() {
+    auto threshold = spatial_threshold * pbpt::math::sqrt(Scalar(std::size_t{1} << m_iteration));
+    // the children appended to the nodes are visited in turn, so they split until they are under the threshold
+    for (std::size_t index = 0; index < m_nodes.size(); ++index) {
+      if (m_nodes[index].children[0]) continue;
+      auto leaf = m_nodes[index].leaf;
+      if (m_leaves[leaf].num_records <= threshold) continue;
+      m_leaves[leaf].num_records /= 2;
+      m_leaves.push_back(m_leaves[leaf]);
+      auto first = static_cast<std::uint32_t>(m_nodes.size());
+      m_nodes.push_back(Node{{}, leaf});
+      m_nodes.push_back(Node{{}, static_cast<std::uint32_t>(m_leaves.size() - 1)});
+      m_nodes[index].children = {first, first + 1};
+    }
+    for (auto &leaf : m_leaves) {
+      leaf.sampling = std::move(leaf.recording);
+      leaf.recording = leaf.sampling.refined(directional_threshold, max_depth);
+      leaf.num_records = 0;
+    }
+  }
+
+  Vector<Scalar, 3> m_lower;
+  Vector<Scalar, 3> m_upper;
+  std::size_t m_num_iterations;
+  std::size_t m_iteration = 0;
+  std::size_t m_num_passes = 0;
+  std::vector<Node> m_nodes = std::vector<Node>(1);
+  std::vector<Leaf> m_leaves = std::vector<Leaf>(1);
+};
+
+/****************************************************************
+ * Guided Path Tracing
+ * The path tracer, but at vertices with a BRDF the direction is drawn from the mixture
+ *   p(wi) := α p_guide(x, wi) + (1 - α) p_material(x, wo, wi)
+ * once the guide has learned anything, weighing the BRDF by 1 / p(wi) and the emitters found by it against
+ * next event estimation with p as well. The radiance estimate of every such direction is recorded into the guide.
+ * The guide must outlive the passes and not be shared by concurrent calls.
+ ****************************************************************/
+template <
+    typename Scalar = double, template <typename, auto> typename Vector = pbpt::tensor::Vector,
+    typename Generator = pbpt::random::LinearCongruentialGenerator<>>
+constexpr auto guided_path_tracer(
+    const auto &object, const auto &materials, const auto &lights, const auto &camera, auto background,
+    auto image_width, auto image_height, auto start_index, auto stop_index, const auto &termination_policy,
+    auto &guide, auto random_seed, const auto &pixel_selector, auto &image_writer
+) {
+  using Ray = pbpt::optics::Ray<Scalar, Vector>;
+  // α, the share of the directions drawn from the guide
+  constexpr auto guide_fraction = Scalar(0.5);
+  constexpr auto epsilon = pbpt::material::numbers::epsilon<Scalar>;
+
+  auto integrator = [&](const auto &ray, auto &generator) constexpr {
+    auto tracer = [function = [&](auto self, const auto &ray, auto depth, const auto &throughput,
+                                  const std::optional<Scalar> &scattering_pdf) constexpr -> Vector<Scalar, 3> {
+      const auto &origin = ray.position();
+      return closest_hit(
+          object, ray,
+          [&](const auto &ray, const auto &normal, const auto &material_reference) constexpr -> Vector<Scalar, 3> {
+            auto [radiance, traced_ray] = materials(material_reference, ray, normal, generator);
+            if (!traced_ray) {
+              auto weight = lights.emission_weight(material_reference, origin, ray.position(), normal, scattering_pdf);
+              return radiance * weight;
+            }
+            const auto &position = ray.position();
+            auto out_direction = -ray.direction();
+            auto diffuse = evaluable(materials, material_reference, normal);
+            auto guided = diffuse && guide.guiding();
+            auto mixture_pdf = [&](const auto &in_direction) constexpr {
+              auto sampled_pdf =
+                  material_pdf<Scalar>(materials, material_reference, out_direction, normal, in_direction);
+              return guide_fraction * guide.pdf(position, in_direction) +
+                     (1 - guide_fraction) * sampled_pdf.value_or(Scalar(0));
+            };
+            // redraws the direction of the material from the mixture
+            auto scatter = [&](auto &radiance, auto &traced_ray) constexpr {
+              if (!guided) return;
+              auto in_direction = pbpt::random::uniform(generator, Scalar(0), Scalar(1)) < guide_fraction
+                                      ? guide.sample(position, generator)
+                                      : traced_ray.value().direction();
+              auto pdf = mixture_pdf(in_direction);
+              auto reflectance = material_reflectance<Scalar, Vector>(
+                  materials, material_reference, out_direction, normal, in_direction
+              );
+              radiance = pdf > 0 ? reflectance * ray.weight() : Vector<Scalar, 3>{};
+              auto in_position = pbpt::tensor::evaluate(position + epsilon * normal);
+              traced_ray = Ray(in_position, in_direction, pdf > 0 ? 1 / pdf : 0);
+            };
+            scatter(radiance, traced_ray);
+
+            auto direct_radiance = guided ? next_event<Scalar, Vector>(
+                                                object, materials, lights, ray, normal, material_reference, generator,
+                                                mixture_pdf
+                                            )
+                                          : next_event<Scalar, Vector>(
+                                                object, materials, lights, ray, normal, material_reference, generator
+                                            );
+            auto traced_pdf = [&](const auto &traced_ray) constexpr -> std::optional<Scalar> {
+              if (!direct_radiance) return std::nullopt;
+              if (guided) return mixture_pdf(traced_ray.direction());
+              return material_pdf<Scalar>(materials, material_reference, out_direction, normal, traced_ray.direction());
+            };
+            auto continuation_rate = termination_policy(depth, throughput * radiance * traced_ray.value().weight());
+            auto num_paths = static_cast<std::size_t>(continuation_rate);
+            if (pbpt::random::uniform(generator, Scalar(0), Scalar(1)) < continuation_rate - num_paths) ++num_paths;
+            Vector<Scalar, 3> estimate{};
+            for (std::size_t path_index = 0; path_index < num_paths; ++path_index) {
+              if (path_index) {
+                std::tie(radiance, traced_ray) = materials(material_reference, ray, normal, generator);
+                scatter(radiance, traced_ray);
+              }
+              auto traced_throughput = throughput * radiance / continuation_rate;
+              auto traced_radiance = self(
+                  self, traced_ray.value(), depth + 1, traced_throughput, traced_pdf(traced_ray.value())
+              );
+              if (diffuse) {
+                guide.record(position, traced_ray.value().direction(), pbpt::tensor::sum(traced_radiance) / 3);
+              }
+              estimate = estimate + radiance * traced_radiance;
+            }
+            if (num_paths) estimate = estimate / continuation_rate;
+            return direct_radiance ? direct_radiance.value() + estimate : estimate;
+          },
+          [&]() constexpr -> Vector<Scalar, 3> { return background(ray); }
+      );
+    }](auto &&...args) constexpr { return function(function, std::forward<decltype(args)>(args)...); };
+
+    return tracer(ray, std::size_t{0}, Vector<Scalar, 3>{1, 1, 1}, std::optional<Scalar>{});
+  };
+
+  render<Scalar, Vector, Generator>(
+      camera, image_width, image_height, start_index, stop_index, random_seed, pixel_selector, image_writer, integrator
+  );
+  guide.end_pass();
+}
+
+}  // namespace pbpt::renderer
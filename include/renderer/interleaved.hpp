@@ -0,0 +1,238 @@
+#pragma once
+
+#include <algorithm>
+#include <optional>
+#include <tuple>
+#include <type_traits>
+#include <vector>
+
+#include "lights.hpp"
+#include "material.hpp"
+#include "math.hpp"
+#include "optics.hpp"
+#include "random.hpp"
+#include "scheduler.hpp"
+#include "sorting.hpp"
+#include "tensor.hpp"
+#include "termination.hpp"
+#include "traversal.hpp"
+#include "utility.hpp"
+
+namespace pbpt::renderer {
+
+/****************************************************************
+ * Interleaved Path Tracer
+ * The estimator of path_tracer, rewritten as state machines so that each thread advances a window of paths
+ * vertex by vertex instead of finishing one path before starting the next:
+ *   1. every path in the window finds its next hit and prefetches the material it will sample there,
+ *   2. every path in the window samples that material, which has been loading meanwhile.
+ * When the object compiles into a resumable traversal (see ResumableTraversal), the hits of step 1 are found
+ * round-robin: each path intersects a few leaves and yields while the leaves of its next turn load.
+ * Before the first step, the ray sorter may reorder the window for coherence (see RaySorter).
+ * Split paths wait on a stack until the window has room; the paths of a pixel share its generator
+ * and the pixel is written once the last of them terminates.
+ ****************************************************************/
+template <
+    typename Scalar = double, template <typename, auto> typename Vector = pbpt::tensor::Vector,
+    typename Generator = pbpt::random::LinearCongruentialGenerator<>>
+constexpr auto interleaved_path_tracer(
+    const auto &object, const auto &materials, const auto &lights, const auto &camera, auto background,
+    auto image_width, auto image_height, auto start_index, auto stop_index, const auto &termination_policy,
+    std::size_t num_interleaved_paths, const auto &ray_sorter, auto random_seed, const auto &pixel_selector,
+    auto &image_writer
+) {
+  using Ray = std::decay_t<decltype(camera.ray(Scalar(0), Scalar(0), std::declval<Generator &>()))>;
+  using MaterialReference =
+      std::decay_t<decltype(object.intersect(std::declval<const Ray &>()).top().min().surface().material_reference())>;
+  using Hit = std::tuple<Ray, Vector<Scalar, 3>, MaterialReference>;
+  using Object = std::decay_t<decltype(object)>;
+
+  constexpr auto resumable = !std::is_void_v<typename UnionTree<Object>::Leaf>;
+  struct Unresumable {
+    struct State {};
+  };
+  using Traversal = std::conditional_t<resumable, ResumableTraversal<Object, Ray>, Unresumable>;
+
+  struct Pixel {
+    decltype(start_index) pixel_index;
+    Generator generator;
+    Vector<Scalar, 3> estimate;
+    std::size_t num_paths;
+  };
+
+  struct Path {
+    Ray ray;
+    Vector<Scalar, 3> throughput;
+    std::size_t depth;
+    std::size_t pixel;
+    // density of ray at its origin if that vertex has also sampled the emitters
+    std::optional<Scalar> scattering_pdf;
+    std::optional<Hit> hit;
+    typename Traversal::State traversal;
+  };
+
+  auto traversal = [&]() {
+    if constexpr (resumable) {
+      return Traversal(object);
+    } else {
+      return Traversal{};
+    }
+  }();
+
+  // enough pixels per chunk for the window to stay full while the pixels at its tail drain
+  constexpr auto chunk_size = decltype(start_index)(256);
+  auto num_chunks = (stop_index - start_index + chunk_size - 1) / chunk_size;
+
+#ifdef _OPENMP
+#pragma omp parallel for
+#endif
+  for (decltype(num_chunks) chunk_index = 0; chunk_index < num_chunks; ++chunk_index) {
+    auto chunk_start_index = start_index + chunk_index * chunk_size;
+    auto chunk_stop_index = std::min(chunk_start_index + chunk_size, stop_index);
+    auto next_pixel_index = chunk_start_index;
+
+    // pixel records are recycled, so at most one per path in flight is ever alive
+    std::vector<Pixel> pixels;
+    std::vector<std::size_t> free_pixels;
+    std::vector<Path> window;
+    std::vector<Path> waiting;
+    // indices of the paths in the window whose traversal is unfinished
+    std::vector<std::size_t> running;
+    window.reserve(num_interleaved_paths);
+    // each chunk learns its own cost model
+    auto sorter = ray_sorter;
+
+    auto finish = [&](const Path &path, const auto &radiance) {
+      auto &pixel = pixels[path.pixel];
+      pixel.estimate = pixel.estimate + radiance;
+      if (--pixel.num_paths) return;
+      image_writer(pixel.pixel_index, pixel.estimate);
+      free_pixels.push_back(path.pixel);
+    };
+
+    auto start = [&]() -> std::optional<Path> {
+      while (next_pixel_index < chunk_stop_index && !pixel_selector(next_pixel_index)) ++next_pixel_index;
+      if (next_pixel_index == chunk_stop_index) return std::nullopt;
+      auto pixel_index = next_pixel_index++;
+      std::size_t pixel;
+      if (free_pixels.empty()) {
+        pixel = pixels.size();
+        pixels.push_back({pixel_index, Generator(random_seed + pixel_index), {}, 1});
+      } else {
+        pixel = free_pixels.back();
+        free_pixels.pop_back();
+        pixels[pixel] = {pixel_index, Generator(random_seed + pixel_index), {}, 1};
+      }
+      auto ray = camera_ray<Scalar>(camera, pixel_index, image_width, image_height, pixels[pixel].generator);
+      return Path{std::move(ray), {1, 1, 1}, 0, pixel, std::nullopt, std::nullopt, {}};
+    };
+
+    while (true) {
+      while (window.size() < num_interleaved_paths) {
+        if (!waiting.empty()) {
+          window.push_back(std::move(waiting.back()));
+          waiting.pop_back();
+        } else if (auto path = start()) {
+          window.push_back(std::move(path.value()));
+        } else {
+          break;
+        }
+      }
+      if (window.empty()) break;
+
+      sorter(
+          window, [](const auto &path) -> const auto & { return path.ray; },
+          [&](auto &window) {
+            auto hit = [&](const auto &ray, const auto &normal, const auto &material_reference) -> std::optional<Hit> {
+              materials.prefetch(material_reference);
+              return Hit{ray, normal, material_reference};
+            };
+            auto miss = []() -> std::optional<Hit> { return std::nullopt; };
+            if constexpr (resumable) {
+              // leaves a path intersects before yielding to the next one
+              constexpr std::size_t num_leaves_per_step = 8;
+              running.clear();
+              for (std::size_t path_index = 0; path_index < window.size(); ++path_index) {
+                traversal.start(window[path_index].traversal, num_leaves_per_step);
+                running.push_back(path_index);
+              }
+              while (!running.empty()) {
+                for (auto running_index = running.size(); running_index--;) {
+                  auto &path = window[running[running_index]];
+                  if (!traversal.step(path.traversal, path.ray, num_leaves_per_step)) continue;
+                  path.hit = closest_hit_among(traversal.occupations(path.traversal), path.ray, hit, miss);
+                  running[running_index] = running.back();
+                  running.pop_back();
+                }
+              }
+            } else {
+              for (auto &path : window) path.hit = closest_hit(object, path.ray, hit, miss);
+            }
+          }
+      );
+
+      for (auto path_index = window.size(); path_index--;) {
+        auto &path = window[path_index];
+        auto &generator = pixels[path.pixel].generator;
+        auto terminated = [&]() {
+          if (!path.hit) {
+            finish(path, path.throughput * background(path.ray));
+            return true;
+          }
+          const auto &[ray, normal, material_reference] = path.hit.value();
+          auto [radiance, traced_ray] = materials(material_reference, ray, normal, generator);
+          if (!traced_ray) {
+            auto weight = lights.emission_weight(
+                material_reference, path.ray.position(), ray.position(), normal, path.scattering_pdf
+            );
+            finish(path, path.throughput * radiance * weight);
+            return true;
+          }
+          auto direct_radiance =
+              next_event<Scalar, Vector>(object, materials, lights, ray, normal, material_reference, generator);
+          auto traced_pdf = [&](const auto &traced_ray) -> std::optional<Scalar> {
+            if (!direct_radiance) return std::nullopt;
+            auto out_direction = -ray.direction();
+            return material_pdf<Scalar>(materials, material_reference, out_direction, normal, traced_ray.direction());
+          };
+          if (direct_radiance) {
+            auto &pixel = pixels[path.pixel];
+            pixel.estimate = pixel.estimate + path.throughput * direct_radiance.value();
+          }
+          /****************************************************************
+           * Russian Roulette & Splitting
+           * Lo := E(n ~ q)[Σ_k radiance_k * Li_k] / q
+           ****************************************************************/
+          auto continuation_rate =
+              termination_policy(path.depth, path.throughput * radiance * traced_ray.value().weight());
+          auto num_paths = static_cast<std::size_t>(continuation_rate);
+          if (pbpt::random::uniform(generator, Scalar(0), Scalar(1)) < continuation_rate - num_paths) ++num_paths;
+          if (!num_paths) {
+            finish(path, Vector<Scalar, 3>{});
+            return true;
+          }
+          pixels[path.pixel].num_paths += num_paths - 1;
+          for (std::size_t split_index = 1; split_index < num_paths; ++split_index) {
+            auto [split_radiance, split_ray] = materials(material_reference, ray, normal, generator);
+            auto split_throughput = path.throughput * split_radiance / continuation_rate;
+            auto split_pdf = traced_pdf(split_ray.value());
+            waiting.push_back(
+                {std::move(split_ray.value()), split_throughput, path.depth + 1, path.pixel, split_pdf, {}, {}}
+            );
+          }
+          path.throughput = path.throughput * radiance / continuation_rate;
+          path.scattering_pdf = traced_pdf(traced_ray.value());
+          path.ray = std::move(traced_ray.value());
+          ++path.depth;
+          return false;
+        }();
+        if (terminated) {
+          std::swap(path, window.back());
+          window.pop_back();
+        }
+      }
+    }
+  }
+}
+
+}  // namespace pbpt::renderer
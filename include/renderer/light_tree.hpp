@@ -0,0 +1,247 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <numbers>
+#include <optional>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#include "math.hpp"
+#include "tensor.hpp"
+
+namespace pbpt::renderer {
+
+/****************************************************************
+ * Light Bounds
+ * A conservative summary of one or more emitters:
+ * the box containing them, the cone containing their normals (axis, cos θo) and their total power.
+ * Emitters are Lambertian, so each normal emits over the hemisphere around it (θe := π / 2).
+ * The importance for a receiver at p bounds the irradiance they may deliver there:
+ *   importance(p) := power * cos(max(θw - θo - θb, 0)) / d^2, or 0 once that angle reaches θe,
+ * where θw is the angle between the axis and p seen from the box center, θb the half angle the box subtends
+ * from p, and d the distance to the center, clamped to the box radius inside the box.
+ ****************************************************************/
+template <typename Scalar = double, template <typename, auto> typename Vector = pbpt::tensor::Vector>
+struct LightBounds {
+  constexpr LightBounds() = default;
+  constexpr LightBounds(
+      const Vector<Scalar, 3> &lower, const Vector<Scalar, 3> &upper, const Vector<Scalar, 3> &axis,
+      Scalar cos_theta_o, Scalar power
+  )
+      : m_lower(lower), m_upper(upper), m_axis(axis), m_cos_theta_o(cos_theta_o), m_power(power) {}
+
+  constexpr auto &lower() & { return m_lower; }
+  constexpr const auto &lower() const & { return m_lower; }
+  constexpr auto &&lower() && { return std::move(m_lower); }
+  constexpr const auto &&lower() const && { return std::move(m_lower); }
+
+  constexpr auto &upper() & { return m_upper; }
+  constexpr const auto &upper() const & { return m_upper; }
+  constexpr auto &&upper() && { return std::move(m_upper); }
+  constexpr const auto &&upper() const && { return std::move(m_upper); }
+
+  constexpr auto &axis() & { return m_axis; }
+  constexpr const auto &axis() const & { return m_axis; }
+  constexpr auto &&axis() && { return std::move(m_axis); }
+  constexpr const auto &&axis() const && { return std::move(m_axis); }
+
+  constexpr auto &cos_theta_o() & { return m_cos_theta_o; }
+  constexpr const auto &cos_theta_o() const & { return m_cos_theta_o; }
+  constexpr auto &&cos_theta_o() && { return std::move(m_cos_theta_o); }
+  constexpr const auto &&cos_theta_o() const && { return std::move(m_cos_theta_o); }
+
+  constexpr auto &power() & { return m_power; }
+  constexpr const auto &power() const & { return m_power; }
+  constexpr auto &&power() && { return std::move(m_power); }
+  constexpr const auto &&power() const && { return std::move(m_power); }
+
+  constexpr auto center() const { return pbpt::tensor::evaluate((m_lower + m_upper) / 2); }
+
+  auto importance(const Vector<Scalar, 3> &position) const -> Scalar {
+    if (m_power <= 0) return 0;
+    auto displacement = position - center();
+    auto squared_distance = pbpt::tensor::dot(displacement, displacement);
+    auto squared_radius = pbpt::tensor::dot(m_upper - center(), m_upper - center());
+    auto distance = pbpt::math::sqrt(squared_distance);
+    auto cos_theta_w = distance > 0 ? pbpt::tensor::dot(m_axis, displacement) / distance : Scalar(1);
+    auto theta_w = std::acos(std::clamp(cos_theta_w, Scalar(-1), Scalar(1)));
+    auto theta_b = squared_distance > squared_radius ? std::asin(pbpt::math::sqrt(squared_radius / squared_distance))
+                                                     : std::numbers::pi_v<Scalar>;
+    auto theta = std::max(theta_w - std::acos(m_cos_theta_o) - theta_b, Scalar(0));
+    if (theta >= std::numbers::pi_v<Scalar> / 2) return 0;
+    return m_power * std::cos(theta) / std::max(squared_distance, squared_radius);
+  }
+
+  // The smallest bounds containing both.
+  friend auto merge(const LightBounds &bounds_1, const LightBounds &bounds_2) {
+    LightBounds bounds;
+    for (std::size_t axis = 0; axis < 3; ++axis) {
+      bounds.m_lower[axis] = std::min(bounds_1.m_lower[axis], bounds_2.m_lower[axis]);
+      bounds.m_upper[axis] = std::max(bounds_1.m_upper[axis], bounds_2.m_upper[axis]);
+    }
+    std::tie(bounds.m_axis, bounds.m_cos_theta_o) = merge_cones(bounds_1, bounds_2);
+    bounds.m_power = bounds_1.m_power + bounds_2.m_power;
+    return bounds;
+  }
+
+ private:
+  // The smallest cone containing both cones of normals, widened from the wider one towards the other.
+  static auto merge_cones(const LightBounds &bounds_1, const LightBounds &bounds_2)
+      -> std::tuple<Vector<Scalar, 3>, Scalar> {
+    const auto &[wide, narrow] = bounds_1.m_cos_theta_o <= bounds_2.m_cos_theta_o ? std::tie(bounds_1, bounds_2)
+                                                                                  : std::tie(bounds_2, bounds_1);
+    constexpr auto pi = std::numbers::pi_v<Scalar>;
+    auto theta_a = std::acos(wide.m_cos_theta_o);
+    auto theta_b = std::acos(narrow.m_cos_theta_o);
+    auto theta_d = std::acos(std::clamp(pbpt::tensor::dot(wide.m_axis, narrow.m_axis), Scalar(-1), Scalar(1)));
+    if (std::min(theta_d + theta_b, pi) <= theta_a) return {wide.m_axis, wide.m_cos_theta_o};
+    auto theta_o = (theta_a + theta_d + theta_b) / 2;
+    auto rotation_axis = pbpt::tensor::cross(wide.m_axis, narrow.m_axis);
+    auto sin_theta_d = pbpt::tensor::norm(rotation_axis);
+    if (theta_o >= pi || sin_theta_d <= 0) return {wide.m_axis, Scalar(-1)};
+    // rotates the wide axis by θo - θa about the axis perpendicular to both (Rodrigues' formula)
+    auto theta_r = theta_o - theta_a;
+    auto tangent = pbpt::tensor::cross(rotation_axis / sin_theta_d, wide.m_axis);
+    auto axis = pbpt::tensor::evaluate(wide.m_axis * std::cos(theta_r) + tangent * std::sin(theta_r));
+    return {axis, std::cos(theta_o)};
+  }
+
+  Vector<Scalar, 3> m_lower;
+  Vector<Scalar, 3> m_upper;
+  Vector<Scalar, 3> m_axis = {0, 0, 1};
+  Scalar m_cos_theta_o = -1;
+  Scalar m_power = 0;
+};
+
+/****************************************************************
+ * Light Tree
+ * A binary hierarchy over the bounds of the emitters, descended once per shading point:
+ * at each node a child is chosen with probability proportional to its importance at the receiver,
+ *   p(emitter) := Π_nodes importance(chosen child) / (importance(child 1) + importance(child 2))
+ * Emitters are split at the median centroid along the widest axis, so the depth, and with it the cost of
+ * sampling and of evaluating p(emitter), is logarithmic in their number.
+ * Each emitter remembers its path from the root as one bit per level, which pdf() follows back down.
+ ****************************************************************/
+template <typename Scalar = double, template <typename, auto> typename Vector = pbpt::tensor::Vector>
+struct LightTree {
+  using Bounds = LightBounds<Scalar, Vector>;
+
+  LightTree() = default;
+  LightTree(const std::vector<Bounds> &emitter_bounds) : m_trails(emitter_bounds.size()) {
+    if (emitter_bounds.empty()) return;
+    std::vector<std::size_t> indices(emitter_bounds.size());
+    for (std::size_t index = 0; index < indices.size(); ++index) indices[index] = index;
+    m_nodes.reserve(2 * indices.size() - 1);
+    build(emitter_bounds, std::begin(indices), std::end(indices), 0, 0);
+  }
+
+  auto size() const { return m_trails.size(); }
+  auto empty() const { return m_trails.empty(); }
+
+  // Index of an emitter for u in [0, 1) with its probability, or nothing if none can light the position.
+  auto sample(const Vector<Scalar, 3> &position, Scalar u) const -> std::optional<std::tuple<std::size_t, Scalar>> {
+    if (m_nodes.empty()) return std::nullopt;
+    if (m_nodes.front().leaf && m_nodes.front().bounds.importance(position) <= 0) return std::nullopt;
+    std::size_t node_index = 0;
+    Scalar probability = 1;
+    while (!m_nodes[node_index].leaf) {
+      auto [first_probability, second_probability] = branch_probabilities(node_index, position);
+      if (first_probability + second_probability <= 0) return std::nullopt;
+      if (u < first_probability) {
+        u = std::min(u / first_probability, Scalar(1) - std::numeric_limits<Scalar>::epsilon());
+        probability *= first_probability;
+        node_index = node_index + 1;
+      } else {
+        u = std::min((u - first_probability) / second_probability, Scalar(1) - std::numeric_limits<Scalar>::epsilon());
+        probability *= second_probability;
+        node_index = m_nodes[node_index].index;
+      }
+    }
+    return std::make_tuple(m_nodes[node_index].index, probability);
+  }
+
+  // Probability that sample() returns the emitter for the position.
+  auto pdf(std::size_t emitter_index, const Vector<Scalar, 3> &position) const -> Scalar {
+    if (m_nodes.empty()) return 0;
+    if (m_nodes.front().leaf && m_nodes.front().bounds.importance(position) <= 0) return 0;
+    auto trail = m_trails[emitter_index];
+    std::size_t node_index = 0;
+    Scalar probability = 1;
+    while (!m_nodes[node_index].leaf) {
+      auto [first_probability, second_probability] = branch_probabilities(node_index, position);
+      if (trail & 1) {
+        probability *= second_probability;
+        node_index = m_nodes[node_index].index;
+      } else {
+        probability *= first_probability;
+        node_index = node_index + 1;
+      }
+      if (probability <= 0) return 0;
+      trail >>= 1;
+    }
+    return probability;
+  }
+
+ private:
+  // Nodes are laid out depth first: the first child of an interior node follows it, index is the second child.
+  // The index of a leaf is the emitter.
+  struct Node {
+    Bounds bounds;
+    std::size_t index;
+    bool leaf;
+  };
+
+  auto branch_probabilities(std::size_t node_index, const Vector<Scalar, 3> &position) const
+      -> std::tuple<Scalar, Scalar> {
+    auto first_importance = m_nodes[node_index + 1].bounds.importance(position);
+    auto second_importance = m_nodes[m_nodes[node_index].index].bounds.importance(position);
+    auto total_importance = first_importance + second_importance;
+    if (total_importance <= 0) return {0, 0};
+    return {first_importance / total_importance, second_importance / total_importance};
+  }
+
+  auto build(const std::vector<Bounds> &emitter_bounds, auto first, auto last, std::uint64_t trail, int depth)
+      -> Bounds {
+    auto node_index = m_nodes.size();
+    if (last - first == 1) {
+      m_trails[*first] = trail;
+      m_nodes.push_back({emitter_bounds[*first], *first, true});
+      return m_nodes[node_index].bounds;
+    }
+    m_nodes.push_back({{}, 0, false});
+
+    Vector<Scalar, 3> lower, upper;
+    for (std::size_t axis = 0; axis < 3; ++axis) {
+      lower[axis] = std::numeric_limits<Scalar>::max();
+      upper[axis] = std::numeric_limits<Scalar>::lowest();
+    }
+    for (auto iterator = first; iterator != last; ++iterator) {
+      auto centroid = emitter_bounds[*iterator].center();
+      for (std::size_t axis = 0; axis < 3; ++axis) {
+        lower[axis] = std::min(lower[axis], centroid[axis]);
+        upper[axis] = std::max(upper[axis], centroid[axis]);
+      }
+    }
+    auto extent = pbpt::tensor::evaluate(upper - lower);
+    auto split_axis = std::size_t(std::max_element(std::begin(extent), std::end(extent)) - std::begin(extent));
+    auto middle = first + (last - first) / 2;
+    std::nth_element(first, middle, last, [&](auto index_1, auto index_2) {
+      return emitter_bounds[index_1].center()[split_axis] < emitter_bounds[index_2].center()[split_axis];
+    });
+
+    auto first_bounds = build(emitter_bounds, first, middle, trail, depth + 1);
+    m_nodes[node_index].index = m_nodes.size();
+    auto second_bounds = build(emitter_bounds, middle, last, trail | std::uint64_t(1) << depth, depth + 1);
+    m_nodes[node_index].bounds = merge(first_bounds, second_bounds);
+    return m_nodes[node_index].bounds;
+  }
+
+  std::vector<Node> m_nodes;
+  std::vector<std::uint64_t> m_trails;
+};
+
+}  // namespace pbpt::renderer
@@ -0,0 +1,476 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <functional>
+#include <numbers>
+#include <optional>
+#include <tuple>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "geometry.hpp"
+#include "light_tree.hpp"
+#include "material.hpp"
+#include "math.hpp"
+#include "optics.hpp"
+#include "random.hpp"
+#include "tensor.hpp"
+#include "utility.hpp"
+
+namespace pbpt::renderer {
+
+/****************************************************************
+ * Emitter
+ * An emissive primitive of the scene placed in world space: world := rotation % local + translation.
+ * sample(u, v) returns a point of its surface with the outward normal, pdf(position) the density per unit area.
+ * Rigid transforms preserve areas, so the density is the primitive's own.
+ * bounds() summarizes where it is, where it faces and how much it emits, for the light tree.
+ ****************************************************************/
+template <
+    typename Scalar = double, template <typename, auto> typename Vector = pbpt::tensor::Vector,
+    typename MaterialReference = pbpt::material::MaterialId>
+struct Emitter {
+  using Sampler = std::function<std::tuple<Vector<Scalar, 3>, Vector<Scalar, 3>>(Scalar, Scalar)>;
+  using Density = std::function<Scalar(const Vector<Scalar, 3> &)>;
+  using Bounds = LightBounds<Scalar, Vector>;
+
+  Emitter(
+      const Sampler &sampler, const Density &density, const MaterialReference &material_reference,
+      const Bounds &bounds
+  )
+      : m_sampler(sampler), m_density(density), m_material_reference(material_reference), m_bounds(bounds) {}
+
+  auto &material_reference() & { return m_material_reference; }
+  const auto &material_reference() const & { return m_material_reference; }
+  auto &&material_reference() && { return std::move(m_material_reference); }
+  const auto &&material_reference() const && { return std::move(m_material_reference); }
+
+  auto &bounds() & { return m_bounds; }
+  const auto &bounds() const & { return m_bounds; }
+  auto &&bounds() && { return std::move(m_bounds); }
+  const auto &&bounds() const && { return std::move(m_bounds); }
+
+  auto sample(Scalar u, Scalar v) const { return m_sampler(u, v); }
+
+  auto pdf(const Vector<Scalar, 3> &position) const { return m_density(position); }
+
+ private:
+  Sampler m_sampler;
+  Density m_density;
+  MaterialReference m_material_reference;
+  Bounds m_bounds;
+};
+
+/****************************************************************
+ * Multiple Importance Sampling
+ * Light reaching a diffuse vertex from a registered emitter is estimated twice, by sampling the emitter
+ * and by sampling the material, and the two estimates are weighted so that the weights sum to one:
+ *   none:    w_light := 1,                       w_material := 0
+ *   balance: w_light := p_light / (p_light + p_material)
+ *   power:   w_light := p_light^2 / (p_light^2 + p_material^2)
+ * where both densities are per solid angle at the vertex.
+ ****************************************************************/
+enum class Heuristic { none, balance, power };
+
+/****************************************************************
+ * Lights
+ * The emitters of a scene, chosen by a light tree for each shading point (see LightTree) or by power alone
+ * where there is none, and the heuristic combining them with material sampling. build() must follow the last add().
+ * An emitter is identified by its material reference, which is unique per primitive
+ * (the address of an embedded material, or the slot of a table entry) unless a table id is deliberately reused.
+ ****************************************************************/
+template <
+    typename Scalar = double, template <typename, auto> typename Vector = pbpt::tensor::Vector,
+    typename MaterialReference = pbpt::material::MaterialId>
+struct Lights {
+  using EmitterType = Emitter<Scalar, Vector, MaterialReference>;
+
+  Lights() = default;
+  Lights(Heuristic heuristic) : m_heuristic(heuristic) {}
+
+  auto &emitters() & { return m_emitters; }
+  const auto &emitters() const & { return m_emitters; }
+  auto &&emitters() && { return std::move(m_emitters); }
+  const auto &&emitters() const && { return std::move(m_emitters); }
+
+  auto &heuristic() & { return m_heuristic; }
+  const auto &heuristic() const & { return m_heuristic; }
+  auto &&heuristic() && { return std::move(m_heuristic); }
+  const auto &&heuristic() const && { return std::move(m_heuristic); }
+
+  auto size() const { return m_emitters.size(); }
+  auto empty() const { return m_emitters.empty(); }
+
+  auto add(EmitterType emitter) {
+    m_indices.emplace(key(emitter.material_reference()), m_emitters.size());
+    m_emitters.push_back(std::move(emitter));
+  }
+
+  auto build() {
+    std::vector<LightBounds<Scalar, Vector>> emitter_bounds;
+    emitter_bounds.reserve(m_emitters.size());
+    for (const auto &emitter : m_emitters) emitter_bounds.push_back(emitter.bounds());
+    m_tree = LightTree<Scalar, Vector>(emitter_bounds);
+    m_cumulative_powers.clear();
+    Scalar total_power = 0;
+    for (const auto &bounds : emitter_bounds) m_cumulative_powers.push_back(total_power += bounds.power());
+  }
+
+  // Index of the emitter made of the material, if any.
+  auto find(const MaterialReference &material_reference) const -> std::optional<std::size_t> {
+    if (auto iterator = m_indices.find(key(material_reference)); iterator != std::end(m_indices)) {
+      return iterator->second;
+    }
+    return std::nullopt;
+  }
+
+  // Emitter for u in [0, 1) lighting the receiver, with the probability of choosing it.
+  auto sample(Scalar u, const Vector<Scalar, 3> &receiver) const
+      -> std::optional<std::tuple<const EmitterType &, Scalar>> {
+    auto sample = m_tree.sample(receiver, u);
+    if (!sample) return std::nullopt;
+    auto [index, probability] = sample.value();
+    return std::tuple<const EmitterType &, Scalar>(m_emitters[index], probability);
+  }
+
+  // Probability that sample() chooses the emitter for the receiver.
+  auto pdf(std::size_t index, const Vector<Scalar, 3> &receiver) const { return m_tree.pdf(index, receiver); }
+
+  // Emitter for u in [0, 1) chosen in proportion to its power wherever it is seen from,
+  // with the probability of choosing it.
+  auto sample(Scalar u) const -> std::optional<std::tuple<const EmitterType &, Scalar>> {
+    if (empty() || m_cumulative_powers.back() <= 0) return std::nullopt;
+    auto target = u * m_cumulative_powers.back();
+    auto iterator = std::upper_bound(std::begin(m_cumulative_powers), std::end(m_cumulative_powers), target);
+    auto index = std::min(std::size_t(iterator - std::begin(m_cumulative_powers)), size() - 1);
+    return std::tuple<const EmitterType &, Scalar>(m_emitters[index], pdf(index));
+  }
+
+  // Probability that sample(u) chooses the emitter.
+  auto pdf(std::size_t index) const -> Scalar {
+    if (m_cumulative_powers.back() <= 0) return 0;
+    auto lower = index ? m_cumulative_powers[index - 1] : Scalar(0);
+    return (m_cumulative_powers[index] - lower) / m_cumulative_powers.back();
+  }
+
+  // Density per solid angle at origin of sampling the position on the emitter with the given normal.
+  auto pdf(std::size_t index, const auto &origin, const auto &position, const auto &normal) const -> Scalar {
+    auto displacement = position - origin;
+    auto squared_distance = pbpt::tensor::dot(displacement, displacement);
+    auto cos_light = -pbpt::tensor::dot(displacement, normal) / pbpt::math::sqrt(squared_distance);
+    if (cos_light <= 0) return 0;
+    return pdf(index, origin) * m_emitters[index].pdf(position) * squared_distance / cos_light;
+  }
+
+  // Weight of the estimate sampled from the emitters.
+  auto light_weight(Scalar light_pdf, Scalar material_pdf) const -> Scalar {
+    return m_heuristic == Heuristic::none ? Scalar(1) : weight(light_pdf, material_pdf);
+  }
+
+  // Weight of the estimate sampled from the material.
+  auto material_weight(Scalar material_pdf, Scalar light_pdf) const -> Scalar {
+    return m_heuristic == Heuristic::none ? Scalar(0) : weight(material_pdf, light_pdf);
+  }
+
+  // Weight of the emission found by a ray from origin, sampled with material_pdf at a vertex that also sampled
+  // the emitters (nothing when it did not, as the emitters were then reachable by this ray only).
+  auto emission_weight(
+      const MaterialReference &material_reference, const auto &origin, const auto &position, const auto &normal,
+      const std::optional<Scalar> &material_pdf
+  ) const -> Scalar {
+    if (!material_pdf) return 1;
+    auto index = find(material_reference);
+    if (!index) return 1;
+    return material_weight(material_pdf.value(), pdf(index.value(), origin, position, normal));
+  }
+
+ private:
+  auto weight(Scalar sampled_pdf, Scalar other_pdf) const -> Scalar {
+    if (m_heuristic == Heuristic::power) {
+      sampled_pdf *= sampled_pdf;
+      other_pdf *= other_pdf;
+    }
+    return sampled_pdf + other_pdf > 0 ? sampled_pdf / (sampled_pdf + other_pdf) : Scalar(0);
+  }
+
+  static auto key(const pbpt::material::MaterialId &material_reference) {
+    return std::uintptr_t(material_reference.value());
+  }
+  static auto key(const auto &material_reference) {
+    return reinterpret_cast<std::uintptr_t>(&material_reference.get());
+  }
+
+  std::vector<EmitterType> m_emitters;
+  std::unordered_map<std::uintptr_t, std::size_t> m_indices;
+  LightTree<Scalar, Vector> m_tree;
+  std::vector<Scalar> m_cumulative_powers;
+  Heuristic m_heuristic = Heuristic::power;
+};
+
+// ================================================================
+// registration
+
+template <typename>
+struct is_union : std::false_type {};
+
+template <typename Geometry1, typename Geometry2>
+struct is_union<pbpt::geometry::csg::Union<Geometry1, Geometry2>> : std::true_type {};
+
+template <typename>
+struct is_enclosure : std::false_type {};
+
+template <typename... Geometries>
+struct is_enclosure<pbpt::geometry::csg::Enclosure<Geometries...>> : std::true_type {
+  using tuple_type = std::tuple<Geometries...>;
+};
+
+// Registers the emissive primitives of the geometry whose whole surface is exposed:
+// those reached through unions, enclosures and transforms, and able to sample themselves.
+// Emitters under a difference or an intersection are clipped, so they are left to be hit by chance.
+template <
+    typename Scalar = double, template <typename, auto> typename Vector = pbpt::tensor::Vector,
+    template <typename, auto, auto> typename Matrix = pbpt::tensor::Matrix>
+auto register_emitters(
+    const auto &geometry, const auto &materials, auto &lights, const Matrix<Scalar, 3, 3> &rotation,
+    const Vector<Scalar, 3> &translation
+) -> void {
+  using Geometry = std::decay_t<decltype(geometry)>;
+  auto recurse = [&](const auto &geometry, const auto &rotation, const auto &translation) {
+    register_emitters<Scalar, Vector, Matrix>(geometry, materials, lights, rotation, translation);
+  };
+  if constexpr (is_union<Geometry>::value) {
+    recurse(geometry.first, rotation, translation);
+    recurse(geometry.second, rotation, translation);
+  } else if constexpr (is_enclosure<Geometry>::value) {
+    const auto &geometries = static_cast<const typename is_enclosure<Geometry>::tuple_type &>(geometry);
+    std::apply([&](const auto &...geometries) { (recurse(geometries, rotation, translation), ...); }, geometries);
+  } else if constexpr (requires { geometry.translation(); }) {
+    recurse(geometry.geometry(), rotation, pbpt::tensor::evaluate(translation + rotation % geometry.translation()));
+  } else if constexpr (requires { geometry.rotation(); }) {
+    // the product column by column, as matrix products are only evaluated against vectors
+    auto [column_x, column_y, column_z] = pbpt::tensor::transposed(geometry.rotation());
+    auto columns = Matrix<Scalar, 3, 3>{rotation % column_x, rotation % column_y, rotation % column_z};
+    recurse(geometry.geometry(), pbpt::tensor::transposed(columns), translation);
+  } else if constexpr (requires { geometry.sample(Scalar(0), Scalar(0)); }) {
+    auto material_reference = pbpt::material::make_material_reference(geometry.material());
+    auto emission = materials.visit(material_reference, [](const auto &material) -> std::optional<Vector<Scalar, 3>> {
+      if constexpr (pbpt::material::is_emissive_v<std::decay_t<decltype(material)>>) {
+        return material.emission();
+      } else {
+        return std::nullopt;
+      }
+    });
+    if (!emission) return;
+    auto sampler = [&geometry, rotation, translation](Scalar u, Scalar v) {
+      auto [position, normal] = geometry.sample(u, v);
+      return std::make_tuple(
+          pbpt::tensor::evaluate(rotation % position + translation), pbpt::tensor::evaluate(rotation % normal)
+      );
+    };
+    auto density = [&geometry, rotation, translation](const Vector<Scalar, 3> &position) {
+      return geometry.pdf(pbpt::tensor::transposed(rotation) % (position - translation));
+    };
+    // the box around the transformed corners of the local box
+    auto [local_lower, local_upper] = geometry.bounds();
+    auto lower = Vector<Scalar, 3>{}, upper = Vector<Scalar, 3>{};
+    for (std::size_t corner_index = 0; corner_index < 8; ++corner_index) {
+      Vector<Scalar, 3> corner;
+      for (std::size_t axis = 0; axis < 3; ++axis) {
+        corner[axis] = corner_index >> axis & 1 ? local_upper[axis] : local_lower[axis];
+      }
+      auto position = pbpt::tensor::evaluate(rotation % corner + translation);
+      for (std::size_t axis = 0; axis < 3; ++axis) {
+        lower[axis] = corner_index ? std::min(lower[axis], position[axis]) : position[axis];
+        upper[axis] = corner_index ? std::max(upper[axis], position[axis]) : position[axis];
+      }
+    }
+    auto [local_axis, cos_theta_o] = geometry.normal_cone();
+    // a Lambertian emitter of radiance L and area A emits π L A
+    auto power = std::numbers::pi_v<Scalar> * geometry.area() * pbpt::tensor::sum(emission.value()) / 3;
+    auto bounds = LightBounds<Scalar, Vector>(lower, upper, rotation % local_axis, cos_theta_o, power);
+    lights.add({sampler, density, material_reference, bounds});
+  }
+}
+
+template <
+    typename Scalar = double, template <typename, auto> typename Vector = pbpt::tensor::Vector,
+    template <typename, auto, auto> typename Matrix = pbpt::tensor::Matrix>
+auto make_lights(const auto &object, const auto &materials, Heuristic heuristic = Heuristic::power) {
+  using Ray = pbpt::optics::Ray<Scalar, Vector>;
+  using MaterialReference =
+      std::decay_t<decltype(object.intersect(std::declval<const Ray &>()).top().min().surface().material_reference())>;
+  Lights<Scalar, Vector, MaterialReference> lights(heuristic);
+  Matrix<Scalar, 3, 3> identity{
+      Vector<Scalar, 3>{1, 0, 0},
+      Vector<Scalar, 3>{0, 1, 0},
+      Vector<Scalar, 3>{0, 0, 1},
+  };
+  register_emitters<Scalar, Vector, Matrix>(object, materials, lights, identity, Vector<Scalar, 3>{});
+  lights.build();
+  return lights;
+}
+
+// Density per solid angle with which the material samples in_direction, if it can tell.
+template <typename Scalar = double>
+constexpr auto material_pdf(
+    const auto &materials, const auto &material_reference, const auto &out_direction, const auto &normal,
+    const auto &in_direction
+) -> std::optional<Scalar> {
+  return materials.visit(material_reference, [&](const auto &material) constexpr -> std::optional<Scalar> {
+    if constexpr (requires { material.pdf(out_direction, normal, in_direction); }) {
+      return material.pdf(out_direction, normal, in_direction);
+    } else {
+      return std::nullopt;
+    }
+  });
+}
+
+// BRDF times the cosine of in_direction, or nothing scattered for materials without a BRDF to evaluate.
+template <typename Scalar = double, template <typename, auto> typename Vector = pbpt::tensor::Vector>
+constexpr auto material_reflectance(
+    const auto &materials, const auto &material_reference, const auto &out_direction, const auto &normal,
+    const auto &in_direction
+) -> Vector<Scalar, 3> {
+  return materials.visit(material_reference, [&](const auto &material) constexpr -> Vector<Scalar, 3> {
+    if constexpr (requires { material.evaluate(out_direction, normal, in_direction); }) {
+      return material.evaluate(out_direction, normal, in_direction);
+    } else {
+      return {};
+    }
+  });
+}
+
+// Whether the material at the vertex has a BRDF to evaluate towards sampled light.
+constexpr auto evaluable(const auto &materials, const auto &material_reference, const auto &normal) {
+  return materials.visit(material_reference, [&](const auto &material) constexpr {
+    return requires { material.evaluate(normal, normal, normal); };
+  });
+}
+
+// Radiance scattered along -ray.direction() from the point of the emitter, ignoring occlusion:
+//   BRDF(x, wi, wo) (wi · n) * Le(y, -wi) * (-wi · ny) / |y - x|^2
+// where the emissive material gives Le(y, -wi) through operator().
+template <typename Scalar = double, template <typename, auto> typename Vector = pbpt::tensor::Vector>
+constexpr auto light_contribution(
+    const auto &materials, const auto &ray, const auto &normal, const auto &material_reference,
+    const auto &emitter, const auto &light_position, const auto &light_normal, auto &generator
+) -> Vector<Scalar, 3> {
+  auto displacement = light_position - ray.position();
+  auto squared_distance = pbpt::tensor::dot(displacement, displacement);
+  auto in_direction = pbpt::tensor::evaluate(displacement / pbpt::math::sqrt(squared_distance));
+  auto cos_light = -pbpt::tensor::dot(in_direction, light_normal);
+  if (cos_light <= 0) return {};
+
+  auto out_direction = -ray.direction();
+  auto reflectance =
+      material_reflectance<Scalar, Vector>(materials, material_reference, out_direction, normal, in_direction);
+  if (pbpt::tensor::max(reflectance) <= 0) return {};
+
+  using Ray = std::decay_t<decltype(ray)>;
+  auto light_ray = Ray(light_position, in_direction, 1);
+  auto [emittance, traced_ray] = materials(emitter.material_reference(), light_ray, light_normal, generator);
+  return reflectance * emittance * (cos_light / squared_distance);
+}
+
+// Whether the shadow ray from origin reaches the position on a surface unoccluded.
+template <typename Scalar = double, template <typename, auto> typename Vector = pbpt::tensor::Vector>
+constexpr auto visible(const auto &object, const Vector<Scalar, 3> &origin, const Vector<Scalar, 3> &position) {
+  constexpr auto epsilon = pbpt::material::numbers::epsilon<Scalar>;
+  auto displacement = position - origin;
+  auto distance = pbpt::tensor::norm(displacement);
+  auto shadow_ray = pbpt::optics::Ray<Scalar, Vector>(origin, pbpt::tensor::evaluate(displacement / distance), 1);
+  return closest_hit(
+      object, shadow_ray,
+      [&](const auto &hit_ray, const auto &, const auto &) constexpr {
+        auto hit_distance = pbpt::tensor::norm(hit_ray.position() - origin);
+        return hit_distance >= distance - 2 * epsilon * (1 + distance);
+      },
+      []() constexpr { return true; }
+  );
+}
+
+// Density per solid angle with which sample_emission() leaves an emitter of the normal along out_direction.
+template <typename Scalar = double>
+constexpr auto emission_pdf(const auto &normal, const auto &out_direction) -> Scalar {
+  auto cos_theta = pbpt::tensor::dot(out_direction, normal);
+  return cos_theta > 0 ? 3 * pbpt::math::square(cos_theta) / (2 * std::numbers::pi_v<Scalar>) : Scalar(0);
+}
+
+// Direction leaving an emitter of the normal. The emissive material radiates Le (ω · n) along ω,
+// so the direction is drawn with density 3 (ω · n)^2 / 2π, which makes its flux over density constant.
+template <typename Scalar = double, template <typename, auto> typename Vector = pbpt::tensor::Vector>
+constexpr auto sample_emission(const Vector<Scalar, 3> &normal, auto &generator) -> Vector<Scalar, 3> {
+  auto cos_theta = std::cbrt(pbpt::random::uniform(generator, Scalar(0), Scalar(1)));
+  auto sin_theta = pbpt::math::sqrt(1 - cos_theta * cos_theta);
+  auto [circle_x, circle_y] = pbpt::random::uniform_on_unit_circle<Scalar, Vector>(generator);
+  auto axis = std::abs(pbpt::tensor::get<0>(normal)) < Scalar(0.9) ? Vector<Scalar, 3>{1, 0, 0}
+                                                                   : Vector<Scalar, 3>{0, 1, 0};
+  auto tangent = pbpt::tensor::normalized(pbpt::tensor::cross(normal, axis));
+  auto bitangent = pbpt::tensor::cross(normal, tangent);
+  return pbpt::tensor::evaluate(
+      sin_theta * circle_x * pbpt::tensor::lazy(tangent) + sin_theta * circle_y * pbpt::tensor::lazy(bitangent) +
+      cos_theta * pbpt::tensor::lazy(normal)
+  );
+}
+
+/****************************************************************
+ * Next-Event Estimation
+ * At a vertex whose material has a BRDF to evaluate, connects to a point sampled on a chosen emitter:
+ *   Ld := w_light * light_contribution(y) / (p(emitter) * p(y))
+ * where a shadow ray tests visibility and w_light is the weight against sampling wi from the material
+ * (see Heuristic).
+ * Returns nothing for specular or emissive vertices, which must keep collecting light by hitting it.
+ * scattering_pdf(in_direction) gives the density per solid angle with which the vertex itself samples wi,
+ * when it does not sample the material alone.
+ ****************************************************************/
+template <typename Scalar = double, template <typename, auto> typename Vector = pbpt::tensor::Vector>
+constexpr auto next_event(
+    const auto &object, const auto &materials, const auto &lights, const auto &ray, const auto &normal,
+    const auto &material_reference, auto &generator, const auto &scattering_pdf
+) -> std::optional<Vector<Scalar, 3>> {
+  if (lights.empty() || !evaluable(materials, material_reference, normal)) return std::nullopt;
+
+  // the origin of the rays leaving the vertex, where the emission weights query the light tree too
+  auto receiver = pbpt::tensor::evaluate(ray.position() + pbpt::material::numbers::epsilon<Scalar> * normal);
+  auto emitter_sample = lights.sample(pbpt::random::uniform(generator, Scalar(0), Scalar(1)), receiver);
+  if (!emitter_sample) return Vector<Scalar, 3>{};
+  auto [emitter, emitter_probability] = emitter_sample.value();
+  auto [light_position, light_normal] = emitter.sample(
+      pbpt::random::uniform(generator, Scalar(0), Scalar(1)), pbpt::random::uniform(generator, Scalar(0), Scalar(1))
+  );
+  auto contribution = light_contribution<Scalar, Vector>(
+      materials, ray, normal, material_reference, emitter, light_position, light_normal, generator
+  );
+  if (pbpt::tensor::max(contribution) <= 0) return Vector<Scalar, 3>{};
+  if (!visible<Scalar, Vector>(object, receiver, light_position)) return Vector<Scalar, 3>{};
+
+  auto displacement = light_position - ray.position();
+  auto squared_distance = pbpt::tensor::dot(displacement, displacement);
+  auto in_direction = pbpt::tensor::evaluate(displacement / pbpt::math::sqrt(squared_distance));
+  auto cos_light = -pbpt::tensor::dot(in_direction, light_normal);
+  auto probability = emitter_probability * emitter.pdf(light_position);
+  auto light_pdf = probability * squared_distance / cos_light;
+  auto weight = lights.light_weight(light_pdf, scattering_pdf(in_direction));
+  return contribution * (weight * ray.weight() / probability);
+}
+
+template <typename Scalar = double, template <typename, auto> typename Vector = pbpt::tensor::Vector>
+constexpr auto next_event(
+    const auto &object, const auto &materials, const auto &lights, const auto &ray, const auto &normal,
+    const auto &material_reference, auto &generator
+) -> std::optional<Vector<Scalar, 3>> {
+  auto scattering_pdf = [&](const auto &in_direction) constexpr {
+    auto out_direction = -ray.direction();
+    return material_pdf<Scalar>(materials, material_reference, out_direction, normal, in_direction)
+        .value_or(Scalar(0));
+  };
+  return next_event<Scalar, Vector>(
+      object, materials, lights, ray, normal, material_reference, generator, scattering_pdf
+  );
+}
+
+}  // namespace pbpt::renderer
@@ -0,0 +1,147 @@
+#pragma once
+
+#include <algorithm>
+#include <numeric>
+#include <tuple>
+#include <vector>
+
+#include "random.hpp"
+#include "scheduler.hpp"
+#include "tensor.hpp"
+
+namespace pbpt::renderer {
+
+/****************************************************************
+ * Primary Sample Space Metropolis Light Transport (PSSMLT)
+ * (reference: Kelemen et al., A Simple and Robust Mutation Strategy for the Metropolis Light Transport Algorithm)
+ * A path is whatever the integrator draws from a PrimarySampleGenerator, after two samples (u, v) choosing the
+ * point on the screen, and its importance is the mean of its radiance over the channels: I(u) := Σ_c L_c(u) / 3.
+ * Markov chains wander through the primary samples with density proportional to I:
+ *   1. a bootstrap of independent paths estimates b := E[I(u)] and picks where every chain starts, proportionally
+ *      to I;
+ *   2. every chain proposes mutations u' of its state u (PrimarySampleGenerator::mutate), accepted with probability
+ *        a := min(1, I(u') / I(u)),
+ *      and splats both with their expected weights, L(u') a / I(u') and L(u) (1 - a) / I(u);
+ *   3. a pixel receives its splats times b W H / M for M mutations in all.
+ * The chains are independent and run in parallel, one mutation per selected pixel in all, and points on the screen
+ * that fall outside [start_index, stop_index) or on pixels the selector drops have no importance.
+ ****************************************************************/
+template <
+    typename Scalar = double, template <typename, auto> typename Vector = pbpt::tensor::Vector,
+    typename Generator = pbpt::random::LinearCongruentialGenerator<>>
+constexpr auto metropolis_light_transport(
+    const auto &camera, auto image_width, auto image_height, auto start_index, auto stop_index,
+    std::size_t num_bootstrap, std::size_t num_chains, Scalar sigma, Scalar large_step_probability, auto random_seed,
+    const auto &pixel_selector, auto &image_writer, const auto &integrator
+) {
+  using PixelIndex = decltype(start_index);
+  using Sampler = pbpt::random::PrimarySampleGenerator<Scalar, Generator>;
+
+  auto num_pixels = stop_index - start_index;
+  std::size_t num_mutations = 0;
+  for (auto pixel_index = start_index; pixel_index < stop_index; ++pixel_index) {
+    if (pixel_selector(pixel_index)) ++num_mutations;
+  }
+  if (!num_mutations || !num_bootstrap || !num_chains) return;
+
+  auto trace = [&](Sampler &sampler) -> std::tuple<PixelIndex, Vector<Scalar, 3>> {
+    auto coord_u = pbpt::random::uniform(sampler, Scalar(0), Scalar(1));
+    auto coord_v = pbpt::random::uniform(sampler, Scalar(0), Scalar(1));
+    // pixels are centered on their index as in camera_ray()
+    auto pixel_index_u = std::min(static_cast<PixelIndex>(coord_u * image_width), PixelIndex(image_width - 1));
+    auto pixel_index_v = std::min(static_cast<PixelIndex>(coord_v * image_height), PixelIndex(image_height - 1));
+    auto pixel_index = pixel_index_v * image_width + pixel_index_u;
+    if (pixel_index < start_index || pixel_index >= stop_index || !pixel_selector(pixel_index)) {
+      return {pixel_index, {}};
+    }
+    auto ray = camera.ray(coord_u - Scalar(0.5) / image_width, coord_v - Scalar(0.5) / image_height, sampler);
+    return {pixel_index, integrator(ray, sampler)};
+  };
+  auto importance = [](const Vector<Scalar, 3> &radiance) { return pbpt::tensor::sum(radiance) / 3; };
+
+  // bootstrap and chain streams start far from the pixel streams seeded with the same number
+  auto bootstrap_seed = Generator(random_seed)();
+  auto chain_seed = Generator(bootstrap_seed)();
+
+  // 1. bootstrap
+  std::vector<Scalar> cumulative_importances(num_bootstrap);
+#ifdef _OPENMP
+#pragma omp parallel for
+#endif
+  for (std::size_t bootstrap_index = 0; bootstrap_index < num_bootstrap; ++bootstrap_index) {
+    Sampler sampler(bootstrap_seed + bootstrap_index, sigma, large_step_probability);
+    cumulative_importances[bootstrap_index] = std::max(importance(std::get<1>(trace(sampler))), Scalar(0));
+  }
+  std::partial_sum(
+      std::begin(cumulative_importances), std::end(cumulative_importances), std::begin(cumulative_importances)
+  );
+  auto total_importance = cumulative_importances.back();
+
+  // 2. chains
+  std::vector<Scalar> splats(3 * num_pixels);
+  auto splat = [&](PixelIndex pixel_index, const Vector<Scalar, 3> &radiance) {
+    for (std::size_t channel = 0; channel < 3; ++channel) {
+#ifdef _OPENMP
+#pragma omp atomic
+#endif
+      splats[3 * (pixel_index - start_index) + channel] += radiance[channel];
+    }
+  };
+
+  if (total_importance > 0) {
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic)
+#endif
+    for (std::size_t chain_index = 0; chain_index < num_chains; ++chain_index) {
+      auto first_mutation = num_mutations * chain_index / num_chains;
+      auto last_mutation = num_mutations * (chain_index + 1) / num_chains;
+      if (first_mutation == last_mutation) continue;
+
+      Generator generator(chain_seed + chain_index);
+      auto chosen_importance = pbpt::random::uniform(generator, Scalar(0), total_importance);
+      auto bootstrap_index = std::min<std::size_t>(
+          std::upper_bound(std::begin(cumulative_importances), std::end(cumulative_importances), chosen_importance) -
+              std::begin(cumulative_importances),
+          num_bootstrap - 1
+      );
+      // replays the chosen bootstrap path
+      Sampler sampler(bootstrap_seed + bootstrap_index, sigma, large_step_probability);
+      auto [current_pixel, current_radiance] = trace(sampler);
+      auto current_importance = importance(current_radiance);
+
+      for (auto mutation = first_mutation; mutation < last_mutation; ++mutation) {
+        sampler.mutate();
+        auto [proposed_pixel, proposed_radiance] = trace(sampler);
+        auto proposed_importance = importance(proposed_radiance);
+        auto acceptance = current_importance > 0 ? std::min(Scalar(1), proposed_importance / current_importance)
+                                                 : Scalar(1);
+        if (acceptance > 0 && proposed_importance > 0) {
+          splat(proposed_pixel, proposed_radiance * (acceptance / proposed_importance));
+        }
+        if (acceptance < 1 && current_importance > 0) {
+          splat(current_pixel, current_radiance * ((1 - acceptance) / current_importance));
+        }
+        if (pbpt::random::uniform(generator, Scalar(0), Scalar(1)) < acceptance) {
+          sampler.accept();
+          current_pixel = proposed_pixel;
+          current_radiance = proposed_radiance;
+          current_importance = proposed_importance;
+        } else {
+          sampler.reject();
+        }
+      }
+    }
+  }
+
+  // 3. normalization
+  auto scale = total_importance / Scalar(num_bootstrap) * Scalar(image_width * image_height) / Scalar(num_mutations);
+  for (auto pixel_index = start_index; pixel_index < stop_index; ++pixel_index) {
+    if (!pixel_selector(pixel_index)) continue;
+    auto local_index = pixel_index - start_index;
+    auto radiance =
+        Vector<Scalar, 3>{splats[3 * local_index], splats[3 * local_index + 1], splats[3 * local_index + 2]};
+    image_writer(pixel_index, radiance * scale);
+  }
+}
+
+}  // namespace pbpt::renderer
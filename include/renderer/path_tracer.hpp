@@ -1,59 +1,113 @@
 #pragma once
 
+#include <cmath>
 #include <iostream>
+#include <optional>
+#include <tuple>
 
+#include "environment.hpp"
+#include "lights.hpp"
 #include "material.hpp"
 #include "math.hpp"
 #include "optics.hpp"
 #include "random.hpp"
+#include "scheduler.hpp"
 #include "tensor.hpp"
+#include "termination.hpp"
+#include "utility.hpp"
 
 namespace pbpt::renderer {
 
+// Radiance along a ray as integrator(ray, generator), estimated by a path with next event estimation, Russian
+// roulette and splitting. At the first vertex with a BRDF the path also splits into num_splits times as many paths
+// as the termination policy asks for, which spreads the cost of the camera ray and the primary hit over several
+// indirect samples. Backgrounds that sample the directions they shine from are sampled at every vertex with a BRDF
+// as well, weighted against the paths that find them (see environment_event). Everything but the background is
+// referenced, so it must outlive the integrator.
+template <typename Scalar = double, template <typename, auto> typename Vector = pbpt::tensor::Vector>
+constexpr auto path_integrator(
+    const auto &object, const auto &materials, const auto &lights, auto background, const auto &termination_policy,
+    std::size_t num_splits = 1
+) {
+  return [&object, &materials, &lights, background, &termination_policy,
+          num_splits](const auto &ray, auto &generator) constexpr {
+    // scattering_pdf is the density of ray at its origin if that vertex has also sampled the emitters,
+    // split whether the path has met a vertex with a BRDF
+    auto tracer = [function = [&](auto self, const auto &ray, auto depth, const auto &throughput,
+                                  const std::optional<Scalar> &scattering_pdf,
+                                  bool split) constexpr -> Vector<Scalar, 3> {
+      const auto &origin = ray.position();
+      return closest_hit(
+          object, ray,
+          [&](const auto &ray, const auto &normal, const auto &material_reference) constexpr -> Vector<Scalar, 3> {
+            auto [radiance, traced_ray] = materials(material_reference, ray, normal, generator);
+            if (!traced_ray) {
+              auto weight = lights.emission_weight(material_reference, origin, ray.position(), normal, scattering_pdf);
+              return radiance * weight;
+            }
+            auto direct_radiance = next_event<Scalar, Vector>(
+                object, materials, lights, ray, normal, material_reference, generator
+            );
+            auto environment_radiance = environment_event<Scalar, Vector>(
+                object, materials, lights, background, ray, normal, material_reference, generator
+            );
+            if (environment_radiance) {
+              direct_radiance = direct_radiance.value_or(Vector<Scalar, 3>{}) + environment_radiance.value();
+            }
+            auto traced_pdf = [&](const auto &traced_ray) constexpr -> std::optional<Scalar> {
+              if (!direct_radiance) return std::nullopt;
+              auto out_direction = -ray.direction();
+              return material_pdf<Scalar>(materials, material_reference, out_direction, normal, traced_ray.direction());
+            };
+            /****************************************************************
+             * Russian Roulette & Splitting
+             * Lo := E(n ~ q)[Σ_k radiance_k * Li_k] / q
+             ****************************************************************/
+            auto splitting = !split && num_splits > 1 && evaluable(materials, material_reference, normal);
+            auto continuation_rate = termination_policy(depth, throughput * radiance * traced_ray.value().weight());
+            if (splitting) continuation_rate *= Scalar(num_splits);
+            // past the depth cap, or once the throughput is no longer finite, the path ends whatever the policy says
+            if (depth + 1 >= max_path_depth || !std::isfinite(pbpt::tensor::sum(throughput * radiance))) {
+              continuation_rate = 0;
+            }
+            auto num_paths = static_cast<std::size_t>(continuation_rate);
+            if (pbpt::random::uniform(generator, Scalar(0), Scalar(1)) < continuation_rate - num_paths) ++num_paths;
+            Vector<Scalar, 3> estimate{};
+            for (std::size_t path_index = 0; path_index < num_paths; ++path_index) {
+              if (path_index) std::tie(radiance, traced_ray) = materials(material_reference, ray, normal, generator);
+              auto traced_throughput = throughput * radiance / continuation_rate;
+              auto traced_radiance = self(
+                  self, traced_ray.value(), depth + 1, traced_throughput, traced_pdf(traced_ray.value()),
+                  split || splitting
+              );
+              estimate = estimate + radiance * traced_radiance;
+            }
+            if (num_paths) estimate = estimate / continuation_rate;
+            return direct_radiance ? direct_radiance.value() + estimate : estimate;
+          },
+          [&]() constexpr -> Vector<Scalar, 3> {
+            return background(ray) * background_weight<Scalar>(lights, background, ray, scattering_pdf);
+          }
+      );
+    }](auto &&...args) constexpr { return function(function, std::forward<decltype(args)>(args)...); };
+
+    return tracer(ray, std::size_t{0}, Vector<Scalar, 3>{1, 1, 1}, std::optional<Scalar>{}, false);
+  };
+}
+
 template <
     typename Scalar = double, template <typename, auto> typename Vector = pbpt::tensor::Vector,
     typename Generator = pbpt::random::LinearCongruentialGenerator<>>
 constexpr auto path_tracer(
-    const auto &object, const auto &camera, auto background, auto image_width, auto image_height, auto start_index,
-    auto stop_index, auto bernoulli_p, auto random_seed, auto &image_writer
+    const auto &object, const auto &materials, const auto &lights, const auto &camera, auto background,
+    auto image_width, auto image_height, auto start_index, auto stop_index, const auto &termination_policy,
+    std::size_t num_splits, auto random_seed, const auto &pixel_selector, auto &image_writer
 ) {
-#ifdef _OPENMP
-#pragma omp parallel for
-#endif
-  for (auto pixel_index = start_index; pixel_index < stop_index; ++pixel_index) {
-    Generator generator(random_seed + pixel_index);
-
-    auto pixel_index_u = pixel_index % image_width;
-    auto pixel_index_v = pixel_index / image_width;
-
-    auto pixel_coord_u = (pixel_index_u + pbpt::random::uniform(generator, -0.5, 0.5)) / image_width;
-    auto pixel_coord_v = (pixel_index_v + pbpt::random::uniform(generator, -0.5, 0.5)) / image_height;
-
-    auto ray = camera.ray(pixel_coord_u, pixel_coord_v, generator);
-
-    auto tracer = [function = [&](auto self, const auto &ray) constexpr -> Vector<Scalar, 3> {
-      if (pbpt::random::uniform(generator, 0.0, 1.0) > bernoulli_p) return {};
-
-      auto occupations = object.intersect(ray);
-
-      while (!occupations.empty() && occupations.top().max().distance() <= 0) occupations.pop();
-
-      if (occupations.empty()) return background(ray);
-
-      const auto &intersection =
-          occupations.top().min().distance() > 0 ? occupations.top().min() : occupations.top().max();
-
-      return [&, ray = ray.advanced(intersection.distance()),
-              &normal_evaluator = intersection.surface().normal_evaluator(),
-              &material_reference = intersection.surface().material_reference()]() constexpr {
-        auto normal = normal_evaluator(ray.position());
-        auto [radiance, traced_ray] = material_reference(ray, normal, generator);
-        return traced_ray ? radiance * self(self, traced_ray.value()) / bernoulli_p : radiance;
-      }();
-    }](auto &&...args) constexpr { return function(function, std::forward<decltype(args)>(args)...); };
-
-    image_writer(pixel_index, tracer(ray));
-  }
+  auto integrator =
+      path_integrator<Scalar, Vector>(object, materials, lights, background, termination_policy, num_splits);
+  render<Scalar, Vector, Generator>(
+      camera, image_width, image_height, start_index, stop_index, random_seed, pixel_selector, image_writer, integrator
+  );
 }
 
 }  // namespace pbpt::renderer
@@ -0,0 +1,323 @@
+#pragma once
+
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <numbers>
+#include <optional>
+#include <tuple>
+#include <type_traits>
+#include <vector>
+
+#include "lights.hpp"
+#include "material.hpp"
+#include "math.hpp"
+#include "optics.hpp"
+#include "random.hpp"
+#include "scheduler.hpp"
+#include "tensor.hpp"
+#include "utility.hpp"
+
+namespace pbpt::renderer {
+
+/****************************************************************
+ * Photon Map
+ * Photons stored as a structure of arrays (position, direction back to where each came from, power)
+ * in a hashed grid of cells as wide as the lookup radius, so that a lookup visits the 27 cells around it.
+ * The photons are reordered by bucket, so the photons of a bucket are contiguous.
+ ****************************************************************/
+template <typename Scalar = double, template <typename, auto> typename Vector = pbpt::tensor::Vector>
+struct PhotonMap {
+  PhotonMap() = default;
+  PhotonMap(
+      const std::vector<Vector<Scalar, 3>> &positions, const std::vector<Vector<Scalar, 3>> &directions,
+      const std::vector<Vector<Scalar, 3>> &powers, Scalar radius
+  )
+      : m_radius(radius) {
+    build(positions, directions, powers);
+  }
+
+  auto &positions() & { return m_positions; }
+  const auto &positions() const & { return m_positions; }
+  auto &&positions() && { return std::move(m_positions); }
+  const auto &&positions() const && { return std::move(m_positions); }
+
+  auto &directions() & { return m_directions; }
+  const auto &directions() const & { return m_directions; }
+  auto &&directions() && { return std::move(m_directions); }
+  const auto &&directions() const && { return std::move(m_directions); }
+
+  auto &powers() & { return m_powers; }
+  const auto &powers() const & { return m_powers; }
+  auto &&powers() && { return std::move(m_powers); }
+  const auto &&powers() const && { return std::move(m_powers); }
+
+  auto &radius() & { return m_radius; }
+  const auto &radius() const & { return m_radius; }
+  auto &&radius() && { return std::move(m_radius); }
+  const auto &&radius() const && { return std::move(m_radius); }
+
+  auto size() const { return m_positions.size(); }
+  auto empty() const { return m_positions.empty(); }
+
+  // Calls visitor(index) for every photon within the radius of the position.
+  auto for_each(const Vector<Scalar, 3> &position, const auto &visitor) const {
+    if (empty()) return;
+    auto squared_radius = m_radius * m_radius;
+    auto [cell_x, cell_y, cell_z] = cell(position);
+    // neighboring cells may share a bucket, which must be visited once
+    std::array<std::size_t, 27> buckets;
+    std::size_t num_buckets = 0;
+    for (std::int64_t offset_x = -1; offset_x <= 1; ++offset_x) {
+      for (std::int64_t offset_y = -1; offset_y <= 1; ++offset_y) {
+        for (std::int64_t offset_z = -1; offset_z <= 1; ++offset_z) {
+          auto bucket = hash(cell_x + offset_x, cell_y + offset_y, cell_z + offset_z);
+          auto visited = false;
+          for (std::size_t index = 0; index < num_buckets; ++index) visited |= buckets[index] == bucket;
+          if (visited) continue;
+          buckets[num_buckets++] = bucket;
+          for (auto index = m_starts[bucket]; index < m_starts[bucket + 1]; ++index) {
+            auto displacement = m_positions[index] - position;
+            if (pbpt::tensor::dot(displacement, displacement) <= squared_radius) visitor(index);
+          }
+        }
+      }
+    }
+  }
+
+ private:
+  auto cell(const Vector<Scalar, 3> &position) const -> std::array<std::int64_t, 3> {
+    auto [position_x, position_y, position_z] = position;
+    return {
+        static_cast<std::int64_t>(std::floor(position_x / m_radius)),
+        static_cast<std::int64_t>(std::floor(position_y / m_radius)),
+        static_cast<std::int64_t>(std::floor(position_z / m_radius)),
+    };
+  }
+
+  auto hash(std::int64_t cell_x, std::int64_t cell_y, std::int64_t cell_z) const -> std::size_t {
+    // reference: Teschner et al., Optimized Spatial Hashing for Collision Detection of Deformable Objects
+    auto key =
+        std::uint64_t(cell_x) * 73856093u ^ std::uint64_t(cell_y) * 19349663u ^ std::uint64_t(cell_z) * 83492791u;
+    return key & (m_starts.size() - 2);
+  }
+
+  auto build(
+      const std::vector<Vector<Scalar, 3>> &positions, const std::vector<Vector<Scalar, 3>> &directions,
+      const std::vector<Vector<Scalar, 3>> &powers
+  ) {
+    // twice as many buckets as photons, rounded up to a power of two
+    std::size_t num_buckets = 1;
+    while (num_buckets < 2 * positions.size()) num_buckets *= 2;
+    m_starts.assign(num_buckets + 1, 0);
+
+    std::vector<std::size_t> buckets(positions.size());
+#ifdef _OPENMP
+#pragma omp parallel for
+#endif
+    for (std::size_t index = 0; index < positions.size(); ++index) {
+      auto [cell_x, cell_y, cell_z] = cell(positions[index]);
+      buckets[index] = hash(cell_x, cell_y, cell_z);
+    }
+
+    // counting sort by bucket
+    for (auto bucket : buckets) ++m_starts[bucket + 1];
+    for (std::size_t bucket = 0; bucket < num_buckets; ++bucket) m_starts[bucket + 1] += m_starts[bucket];
+    auto offsets = std::vector<std::size_t>(std::begin(m_starts), std::end(m_starts) - 1);
+    m_positions.resize(positions.size());
+    m_directions.resize(positions.size());
+    m_powers.resize(positions.size());
+    for (std::size_t index = 0; index < positions.size(); ++index) {
+      auto sorted_index = offsets[buckets[index]]++;
+      m_positions[sorted_index] = positions[index];
+      m_directions[sorted_index] = directions[index];
+      m_powers[sorted_index] = powers[index];
+    }
+  }
+
+  std::vector<Vector<Scalar, 3>> m_positions;
+  std::vector<Vector<Scalar, 3>> m_directions;
+  std::vector<Vector<Scalar, 3>> m_powers;
+  Scalar m_radius = 1;
+  // photons of bucket b are [m_starts[b], m_starts[b + 1])
+  std::vector<std::size_t> m_starts = {0, 0};
+};
+
+// Caustic photon map: photons leave the registered emitters as sample_emission() and are stored where they
+// first land on a surface with a BRDF after at least one specular bounce (light, specular+, diffuse).
+// Every photon is traced by its own generator, so the pass runs in parallel without locks.
+template <
+    typename Scalar = double, template <typename, auto> typename Vector = pbpt::tensor::Vector,
+    typename Generator = pbpt::random::LinearCongruentialGenerator<>>
+auto trace_photons(
+    const auto &object, const auto &materials, const auto &lights, std::size_t num_photons, Scalar radius,
+    auto random_seed
+) {
+  using Ray = pbpt::optics::Ray<Scalar, Vector>;
+  // specular chains longer than this are dropped
+  constexpr std::size_t max_bounces = 32;
+  constexpr auto epsilon = pbpt::material::numbers::epsilon<Scalar>;
+
+  std::vector<Vector<Scalar, 3>> positions(num_photons), directions(num_photons), powers(num_photons);
+  std::vector<char> stored(num_photons, false);
+  // photon streams start far from the pixel streams seeded with the same number
+  auto photon_seed = Generator(random_seed)();
+
+#ifdef _OPENMP
+#pragma omp parallel for
+#endif
+  for (std::size_t photon_index = 0; photon_index < num_photons; ++photon_index) {
+    Generator generator(photon_seed + photon_index);
+    auto uniform = [&]() { return pbpt::random::uniform(generator, Scalar(0), Scalar(1)); };
+    auto emitter_sample = lights.sample(uniform());
+    if (!emitter_sample) continue;
+    auto [emitter, emitter_probability] = emitter_sample.value();
+    auto [light_position, light_normal] = emitter.sample(uniform(), uniform());
+    auto out_direction = sample_emission<Scalar, Vector>(light_normal, generator);
+    auto probability =
+        emitter_probability * emitter.pdf(light_position) * emission_pdf<Scalar>(light_normal, out_direction);
+    if (probability <= 0) continue;
+    auto emission_ray = Ray(light_position, -out_direction, 1);
+    auto emittance = std::get<0>(materials(emitter.material_reference(), emission_ray, light_normal, generator));
+    Vector<Scalar, 3> power =
+        emittance * (pbpt::tensor::dot(out_direction, light_normal) / (probability * Scalar(num_photons)));
+
+    auto ray = Ray(pbpt::tensor::evaluate(light_position + epsilon * light_normal), out_direction, 1);
+    for (std::size_t bounce = 0; bounce < max_bounces; ++bounce) {
+      auto traced_ray = closest_hit(
+          object, ray,
+          [&](const auto &ray, const auto &normal, const auto &material_reference) -> std::optional<Ray> {
+            if (evaluable(materials, material_reference, normal)) {
+              if (bounce) {
+                positions[photon_index] = ray.position();
+                directions[photon_index] = -ray.direction();
+                powers[photon_index] = power;
+                stored[photon_index] = true;
+              }
+              return std::nullopt;
+            }
+            auto [reflectance, traced_ray] = materials(material_reference, ray, normal, generator);
+            if (!traced_ray) return std::nullopt;
+            power = power * reflectance * traced_ray.value().weight();
+            return Ray(traced_ray.value().position(), traced_ray.value().direction(), 1);
+          },
+          []() -> std::optional<Ray> { return std::nullopt; }
+      );
+      if (!traced_ray) break;
+      ray = std::move(traced_ray.value());
+    }
+  }
+
+  std::vector<Vector<Scalar, 3>> stored_positions, stored_directions, stored_powers;
+  for (std::size_t photon_index = 0; photon_index < num_photons; ++photon_index) {
+    if (!stored[photon_index]) continue;
+    stored_positions.push_back(positions[photon_index]);
+    stored_directions.push_back(directions[photon_index]);
+    stored_powers.push_back(powers[photon_index]);
+  }
+  return PhotonMap<Scalar, Vector>(stored_positions, stored_directions, stored_powers, radius);
+}
+
+// Radius of the given pass of progressive photon mapping, shrinking so that both the bias and the variance
+// of the running average vanish: r_{i+1}^2 := r_i^2 (i + α) / (i + 1), with α in (0, 1).
+// reference: Knaus and Zwicker, Progressive Photon Mapping: A Probabilistic Approach
+template <typename Scalar = double>
+constexpr auto progressive_radius(Scalar initial_radius, Scalar alpha, std::size_t pass_index) {
+  auto squared_radius = initial_radius * initial_radius;
+  for (std::size_t index = 1; index <= pass_index; ++index) squared_radius *= (index + alpha) / (index + 1);
+  return pbpt::math::sqrt(squared_radius);
+}
+
+/****************************************************************
+ * Path Tracing with Caustic Photons
+ * The path tracer, but with a fresh caustic photon map for every pass. At a vertex with a BRDF the
+ * caustics are gathered from the photons within the radius r:
+ *   Lc := Σ_p BRDF(x, wp, wo) Φ_p / (π r^2)
+ * and emission reached from such a vertex through specular vertices only is skipped when it comes from
+ * a registered emitter, as the photons have carried it. Everything else is path traced as before.
+ ****************************************************************/
+template <
+    typename Scalar = double, template <typename, auto> typename Vector = pbpt::tensor::Vector,
+    typename Generator = pbpt::random::LinearCongruentialGenerator<>>
+constexpr auto photon_mapping(
+    const auto &object, const auto &materials, const auto &lights, const auto &camera, auto background,
+    auto image_width, auto image_height, auto start_index, auto stop_index, const auto &termination_policy,
+    std::size_t num_photons, Scalar radius, auto random_seed, const auto &pixel_selector, auto &image_writer
+) {
+  auto photon_map =
+      trace_photons<Scalar, Vector, Generator>(object, materials, lights, num_photons, radius, random_seed);
+  auto area = std::numbers::pi_v<Scalar> * radius * radius;
+
+  auto caustics = [&](const auto &ray, const auto &normal, const auto &material_reference) -> Vector<Scalar, 3> {
+    Vector<Scalar, 3> radiance{};
+    auto out_direction = -ray.direction();
+    photon_map.for_each(ray.position(), [&](auto index) {
+      const auto &in_direction = photon_map.directions()[index];
+      auto cos_theta = pbpt::tensor::dot(in_direction, normal);
+      if (cos_theta <= 0) return;
+      // the photon power already holds the cosine, so the BRDF alone weighs it
+      auto reflectance =
+          material_reflectance<Scalar, Vector>(materials, material_reference, out_direction, normal, in_direction);
+      radiance = radiance + reflectance * photon_map.powers()[index] / cos_theta;
+    });
+    return radiance * (ray.weight() / area);
+  };
+
+  auto integrator = [&](const auto &ray, auto &generator) constexpr {
+    // after_diffuse is whether the path has met a vertex with a BRDF, caustic whether ray leaves a specular vertex
+    // met after one
+    auto tracer = [function = [&](auto self, const auto &ray, auto depth, const auto &throughput,
+                                  const std::optional<Scalar> &scattering_pdf, bool after_diffuse,
+                                  bool caustic) constexpr -> Vector<Scalar, 3> {
+      const auto &origin = ray.position();
+      return closest_hit(
+          object, ray,
+          [&](const auto &ray, const auto &normal, const auto &material_reference) constexpr -> Vector<Scalar, 3> {
+            auto [radiance, traced_ray] = materials(material_reference, ray, normal, generator);
+            if (!traced_ray) {
+              if (caustic && lights.find(material_reference)) return {};
+              auto weight = lights.emission_weight(material_reference, origin, ray.position(), normal, scattering_pdf);
+              return radiance * weight;
+            }
+            auto diffuse = evaluable(materials, material_reference, normal);
+            auto direct_radiance = next_event<Scalar, Vector>(
+                object, materials, lights, ray, normal, material_reference, generator
+            );
+            if (diffuse) {
+              auto caustic_radiance = caustics(ray, normal, material_reference);
+              direct_radiance = direct_radiance.value_or(Vector<Scalar, 3>{}) + caustic_radiance;
+            }
+            auto traced_pdf = [&](const auto &traced_ray) constexpr -> std::optional<Scalar> {
+              if (!diffuse || lights.empty()) return std::nullopt;
+              auto out_direction = -ray.direction();
+              return material_pdf<Scalar>(materials, material_reference, out_direction, normal, traced_ray.direction());
+            };
+            auto continuation_rate = termination_policy(depth, throughput * radiance * traced_ray.value().weight());
+            auto num_paths = static_cast<std::size_t>(continuation_rate);
+            if (pbpt::random::uniform(generator, Scalar(0), Scalar(1)) < continuation_rate - num_paths) ++num_paths;
+            Vector<Scalar, 3> estimate{};
+            for (std::size_t path_index = 0; path_index < num_paths; ++path_index) {
+              if (path_index) std::tie(radiance, traced_ray) = materials(material_reference, ray, normal, generator);
+              auto traced_throughput = throughput * radiance / continuation_rate;
+              auto traced_radiance = self(
+                  self, traced_ray.value(), depth + 1, traced_throughput, traced_pdf(traced_ray.value()),
+                  diffuse || after_diffuse, !diffuse && after_diffuse
+              );
+              estimate = estimate + radiance * traced_radiance;
+            }
+            if (num_paths) estimate = estimate / continuation_rate;
+            return direct_radiance ? direct_radiance.value() + estimate : estimate;
+          },
+          [&]() constexpr -> Vector<Scalar, 3> { return background(ray); }
+      );
+    }](auto &&...args) constexpr { return function(function, std::forward<decltype(args)>(args)...); };
+
+    return tracer(ray, std::size_t{0}, Vector<Scalar, 3>{1, 1, 1}, std::optional<Scalar>{}, false, false);
+  };
+
+  render<Scalar, Vector, Generator>(
+      camera, image_width, image_height, start_index, stop_index, random_seed, pixel_selector, image_writer, integrator
+  );
+}
+
+}  // namespace pbpt::renderer
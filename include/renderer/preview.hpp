@@ -0,0 +1,179 @@
+#pragma once
+
+#include <algorithm>
+#include <type_traits>
+
+#include "lights.hpp"
+#include "material.hpp"
+#include "math.hpp"
+#include "optics.hpp"
+#include "random.hpp"
+#include "scheduler.hpp"
+#include "tensor.hpp"
+#include "utility.hpp"
+
+namespace pbpt::renderer {
+
+/****************************************************************
+ * Preview Integrators
+ * Cheap estimators for framing and look development, scheduled like the path tracer.
+ * Each traces at most two segments per sample instead of a full random walk.
+ ****************************************************************/
+
+// Fraction of the cosine-weighted hemisphere above the first hit that is unoccluded within `occlusion_distance`.
+template <
+    typename Scalar = double, template <typename, auto> typename Vector = pbpt::tensor::Vector,
+    typename Generator = pbpt::random::LinearCongruentialGenerator<>>
+constexpr auto ambient_occlusion(
+    const auto &object, const auto &camera, auto occlusion_distance, auto image_width, auto image_height,
+    auto start_index, auto stop_index, auto random_seed, const auto &pixel_selector, auto &image_writer
+) {
+  auto integrator = [&](const auto &ray, auto &generator) constexpr -> Vector<Scalar, 3> {
+    return closest_hit(
+        object, ray,
+        [&](const auto &ray, const auto &normal, const auto &material_reference) constexpr -> Vector<Scalar, 3> {
+          auto facing_normal = pbpt::tensor::dot(ray.direction(), normal) < 0 ? normal : -normal;
+          // a point on the unit sphere tangent to the surface gives a cosine-distributed direction
+          auto in_direction = pbpt::tensor::normalized(
+              facing_normal + pbpt::random::uniform_on_unit_sphere<Scalar, Vector>(generator)
+          );
+          auto in_position = ray.position() + pbpt::material::numbers::epsilon<Scalar> * facing_normal;
+          auto occlusion_ray = std::decay_t<decltype(ray)>(std::move(in_position), std::move(in_direction), 1);
+          auto visibility = closest_hit(
+              object, occlusion_ray,
+              [&](const auto &hit_ray, const auto &, const auto &) constexpr {
+                auto distance = pbpt::tensor::norm(hit_ray.position() - occlusion_ray.position());
+                return distance > occlusion_distance ? Scalar(1) : Scalar(0);
+              },
+              []() constexpr { return Scalar(1); }
+          );
+          return {visibility, visibility, visibility};
+        },
+        []() constexpr -> Vector<Scalar, 3> { return {1, 1, 1}; }
+    );
+  };
+
+  render<Scalar, Vector, Generator>(
+      camera, image_width, image_height, start_index, stop_index, random_seed, pixel_selector, image_writer, integrator
+  );
+}
+
+// Directional albedo of the first hit: one material sample seen through a ray of unit weight.
+template <
+    typename Scalar = double, template <typename, auto> typename Vector = pbpt::tensor::Vector,
+    typename Generator = pbpt::random::LinearCongruentialGenerator<>>
+constexpr auto albedo_preview(
+    const auto &object, const auto &materials, const auto &camera, auto image_width, auto image_height,
+    auto start_index, auto stop_index, auto random_seed, const auto &pixel_selector, auto &image_writer
+) {
+  auto integrator = [&](const auto &ray, auto &generator) constexpr -> Vector<Scalar, 3> {
+    return closest_hit(
+        object, ray,
+        [&](const auto &ray, const auto &normal, const auto &material_reference) constexpr -> Vector<Scalar, 3> {
+          auto unit_ray = std::decay_t<decltype(ray)>(ray.position(), ray.direction(), 1);
+          return std::get<0>(materials(material_reference, unit_ray, normal, generator));
+        },
+        []() constexpr -> Vector<Scalar, 3> { return {}; }
+    );
+  };
+
+  render<Scalar, Vector, Generator>(
+      camera, image_width, image_height, start_index, stop_index, random_seed, pixel_selector, image_writer, integrator
+  );
+}
+
+// World-space normal of the first hit, mapped from [-1, 1] to [0, 1].
+template <
+    typename Scalar = double, template <typename, auto> typename Vector = pbpt::tensor::Vector,
+    typename Generator = pbpt::random::LinearCongruentialGenerator<>>
+constexpr auto normal_preview(
+    const auto &object, const auto &camera, auto image_width, auto image_height, auto start_index, auto stop_index,
+    auto random_seed, const auto &pixel_selector, auto &image_writer
+) {
+  auto integrator = [&](const auto &ray, auto &generator) constexpr -> Vector<Scalar, 3> {
+    return closest_hit(
+        object, ray,
+        [&](const auto &ray, const auto &normal, const auto &material_reference) constexpr -> Vector<Scalar, 3> {
+          return normal * Scalar(0.5) + Scalar(0.5);
+        },
+        []() constexpr -> Vector<Scalar, 3> { return {}; }
+    );
+  };
+
+  render<Scalar, Vector, Generator>(
+      camera, image_width, image_height, start_index, stop_index, random_seed, pixel_selector, image_writer, integrator
+  );
+}
+
+// Distance to the first hit, from white at the camera to black at `max_distance` and beyond.
+template <
+    typename Scalar = double, template <typename, auto> typename Vector = pbpt::tensor::Vector,
+    typename Generator = pbpt::random::LinearCongruentialGenerator<>>
+constexpr auto depth_preview(
+    const auto &object, const auto &camera, auto max_distance, auto image_width, auto image_height,
+    auto start_index, auto stop_index, auto random_seed, const auto &pixel_selector, auto &image_writer
+) {
+  auto integrator = [&](const auto &camera_ray, auto &generator) constexpr -> Vector<Scalar, 3> {
+    return closest_hit(
+        object, camera_ray,
+        [&](const auto &ray, const auto &normal, const auto &material_reference) constexpr -> Vector<Scalar, 3> {
+          auto distance = pbpt::tensor::norm(ray.position() - camera_ray.position());
+          auto depth = 1 - std::min(Scalar(distance / max_distance), Scalar(1));
+          return {depth, depth, depth};
+        },
+        []() constexpr -> Vector<Scalar, 3> { return {}; }
+    );
+  };
+
+  render<Scalar, Vector, Generator>(
+      camera, image_width, image_height, start_index, stop_index, random_seed, pixel_selector, image_writer, integrator
+  );
+}
+
+// Emission and background reached after at most one scattering event.
+// Registered emitters are sampled explicitly from diffuse first hits and weighted against material sampling.
+template <
+    typename Scalar = double, template <typename, auto> typename Vector = pbpt::tensor::Vector,
+    typename Generator = pbpt::random::LinearCongruentialGenerator<>>
+constexpr auto direct_lighting(
+    const auto &object, const auto &materials, const auto &lights, const auto &camera, auto background,
+    auto image_width, auto image_height, auto start_index, auto stop_index, auto random_seed,
+    const auto &pixel_selector, auto &image_writer
+) {
+  auto integrator = [&](const auto &ray, auto &generator) constexpr -> Vector<Scalar, 3> {
+    return closest_hit(
+        object, ray,
+        [&](const auto &ray, const auto &normal, const auto &material_reference) constexpr -> Vector<Scalar, 3> {
+          auto [radiance, traced_ray] = materials(material_reference, ray, normal, generator);
+          if (!traced_ray) return radiance;
+          auto direct_radiance =
+              next_event<Scalar, Vector>(object, materials, lights, ray, normal, material_reference, generator);
+          const auto &light_ray = traced_ray.value();
+          auto scattering_pdf =
+              direct_radiance
+                  ? material_pdf<Scalar>(materials, material_reference, -ray.direction(), normal, light_ray.direction())
+                  : std::nullopt;
+          auto indirect_radiance = closest_hit(
+              object, light_ray,
+              [&](const auto &ray, const auto &normal, const auto &material_reference) constexpr -> Vector<Scalar, 3> {
+                // only emitters terminate the path, anything else would need another bounce
+                auto [radiance, traced_ray] = materials(material_reference, ray, normal, generator);
+                if (traced_ray) return {};
+                return radiance * lights.emission_weight(
+                                      material_reference, light_ray.position(), ray.position(), normal, scattering_pdf
+                                  );
+              },
+              [&]() constexpr -> Vector<Scalar, 3> { return background(light_ray); }
+          );
+          return direct_radiance.value_or(Vector<Scalar, 3>{}) + radiance * indirect_radiance;
+        },
+        [&]() constexpr -> Vector<Scalar, 3> { return background(ray); }
+    );
+  };
+
+  render<Scalar, Vector, Generator>(
+      camera, image_width, image_height, start_index, stop_index, random_seed, pixel_selector, image_writer, integrator
+  );
+}
+
+}  // namespace pbpt::renderer
@@ -0,0 +1,229 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <optional>
+#include <tuple>
+#include <vector>
+
+#include "lights.hpp"
+#include "material.hpp"
+#include "math.hpp"
+#include "optics.hpp"
+#include "random.hpp"
+#include "scheduler.hpp"
+#include "tensor.hpp"
+#include "termination.hpp"
+#include "utility.hpp"
+
+namespace pbpt::renderer {
+
+/****************************************************************
+ * Radiance Cache
+ * Radiance leaving surfaces with a BRDF, averaged over cubic cells of space and the six axis-aligned directions
+ * closest to the normal, in an open-addressing hash table keyed by both. Threads claim empty entries by a
+ * compare-and-swap on the key and add to the sums with atomics, so any number of them may read and record at once.
+ * When the probed entries are all taken, records are dropped.
+ ****************************************************************/
+template <typename Scalar = double, template <typename, auto> typename Vector = pbpt::tensor::Vector>
+class RadianceCache {
+ public:
+  // The number of entries is rounded up to a power of two.
+  RadianceCache(Scalar cell_size, std::size_t num_entries) : m_cell_size(cell_size) {
+    std::size_t capacity = 1;
+    while (capacity < num_entries) capacity *= 2;
+    m_entries.resize(capacity);
+  }
+
+  auto &cell_size() & { return m_cell_size; }
+  const auto &cell_size() const & { return m_cell_size; }
+  auto &&cell_size() && { return std::move(m_cell_size); }
+  const auto &&cell_size() const && { return std::move(m_cell_size); }
+
+  // Mean radiance recorded in the cell, once there are enough records to trust it.
+  auto find(const Vector<Scalar, 3> &position, const Vector<Scalar, 3> &normal) const
+      -> std::optional<Vector<Scalar, 3>> {
+    auto index = slot(key(position, normal), false);
+    if (!index) return std::nullopt;
+    const auto &entry = m_entries[index.value()];
+    Scalar count, red, green, blue;
+#ifdef _OPENMP
+#pragma omp atomic read
+#endif
+    count = entry.count;
+    if (count < min_records) return std::nullopt;
+#ifdef _OPENMP
+#pragma omp atomic read
+#endif
+    red = entry.sums[0];
+#ifdef _OPENMP
+#pragma omp atomic read
+#endif
+    green = entry.sums[1];
+#ifdef _OPENMP
+#pragma omp atomic read
+#endif
+    blue = entry.sums[2];
+    return Vector<Scalar, 3>{red, green, blue} / count;
+  }
+
+  auto record(const Vector<Scalar, 3> &position, const Vector<Scalar, 3> &normal, const Vector<Scalar, 3> &radiance) {
+    auto index = slot(key(position, normal), true);
+    if (!index) return;
+    auto &entry = m_entries[index.value()];
+    for (std::size_t channel = 0; channel < 3; ++channel) {
+#ifdef _OPENMP
+#pragma omp atomic
+#endif
+      entry.sums[channel] += radiance[channel];
+    }
+#ifdef _OPENMP
+#pragma omp atomic
+#endif
+    entry.count += 1;
+  }
+
+  auto clear() { std::fill(std::begin(m_entries), std::end(m_entries), Entry{}); }
+
+ private:
+  static constexpr Scalar min_records = 8;
+  static constexpr std::size_t max_probes = 8;
+  // cells are counted in 19 bits per axis, wrapping around beyond
+  static constexpr std::int64_t cell_bits = 19;
+
+  struct Entry {
+    // 0 for empty entries
+    std::uint64_t key = 0;
+    std::array<Scalar, 3> sums{};
+    Scalar count = 0;
+  };
+
+  auto key(const Vector<Scalar, 3> &position, const Vector<Scalar, 3> &normal) const -> std::uint64_t {
+    auto [position_x, position_y, position_z] = position;
+    auto [normal_x, normal_y, normal_z] = normal;
+    auto cell = [&](Scalar coordinate) {
+      auto index = static_cast<std::int64_t>(std::floor(coordinate / m_cell_size));
+      return static_cast<std::uint64_t>(index & ((std::int64_t{1} << cell_bits) - 1));
+    };
+    // the axis closest to the normal, and its sign
+    auto abs_x = std::abs(normal_x), abs_y = std::abs(normal_y), abs_z = std::abs(normal_z);
+    auto axis = abs_x >= abs_y && abs_x >= abs_z ? 0 : abs_y >= abs_z ? 1 : 2;
+    auto negative = (axis == 0 ? normal_x : axis == 1 ? normal_y : normal_z) < 0;
+    auto direction = static_cast<std::uint64_t>(2 * axis + negative);
+    return std::uint64_t{1} << 63 | direction << (3 * cell_bits) | cell(position_x) << (2 * cell_bits) |
+           cell(position_y) << cell_bits | cell(position_z);
+  }
+
+  // Entry holding the key, or claiming an empty one for it when asked to.
+  auto slot(std::uint64_t key, bool claim) const -> std::optional<std::size_t> {
+    // finalizer of SplitMix64
+    auto hash = key;
+    hash = (hash ^ (hash >> 30)) * 0xbf58476d1ce4e5b9;
+    hash = (hash ^ (hash >> 27)) * 0x94d049bb133111eb;
+    hash ^= hash >> 31;
+    auto mask = m_entries.size() - 1;
+    for (std::size_t probe = 0; probe < max_probes; ++probe) {
+      auto index = (hash + probe) & mask;
+      // only the keys are modified through atomic_ref, which needs them mutable
+      std::atomic_ref<std::uint64_t> entry_key(const_cast<std::uint64_t &>(m_entries[index].key));
+      auto found = entry_key.load(std::memory_order_acquire);
+      if (found == key) return index;
+      if (found) continue;
+      if (!claim) return std::nullopt;
+      if (entry_key.compare_exchange_strong(found, key, std::memory_order_acq_rel) || found == key) return index;
+    }
+    return std::nullopt;
+  }
+
+  Scalar m_cell_size;
+  std::vector<Entry> m_entries;
+};
+
+/****************************************************************
+ * Path Tracing with a Radiance Cache
+ * The path tracer, but every vertex with a BRDF records the radiance it estimates into the cache,
+ *   Lo(x, wo) ≈ (Ld + Σ_k radiance_k * Li_k) / weight
+ * and a path ends at such a vertex with what the cache holds there, once it is max_depth bounces deep or its
+ * spread exceeds spread_factor cells, if the cache holds enough records. The spread of a path is
+ *   a(x_n) := Σ_{i=2..n} sqrt(|x_{i-1} - x_i|^2 / (p(x_{i-1} -> x_i) |cos θ_i|))
+ * accumulated over the directions sampled from a BRDF (reference: Müller et al., Real-time Neural Radiance
+ * Caching for Path Tracing). Cached radiance is an average over the cell, so the estimate is biased.
+ ****************************************************************/
+template <
+    typename Scalar = double, template <typename, auto> typename Vector = pbpt::tensor::Vector,
+    typename Generator = pbpt::random::LinearCongruentialGenerator<>>
+constexpr auto cached_path_tracer(
+    const auto &object, const auto &materials, const auto &lights, const auto &camera, auto background,
+    auto image_width, auto image_height, auto start_index, auto stop_index, const auto &termination_policy,
+    auto &cache, std::size_t max_depth, Scalar spread_factor, auto random_seed, const auto &pixel_selector,
+    auto &image_writer
+) {
+  auto max_spread = spread_factor * cache.cell_size();
+
+  auto integrator = [&](const auto &ray, auto &generator) constexpr {
+    // sampled is whether ray was sampled from a BRDF, which widens the spread of the path
+    auto tracer = [function = [&](auto self, const auto &ray, auto depth, const auto &throughput,
+                                  const std::optional<Scalar> &scattering_pdf, Scalar spread,
+                                  bool sampled) constexpr -> Vector<Scalar, 3> {
+      const auto &origin = ray.position();
+      return closest_hit(
+          object, ray,
+          [&](const auto &ray, const auto &normal, const auto &material_reference) constexpr -> Vector<Scalar, 3> {
+            auto [radiance, traced_ray] = materials(material_reference, ray, normal, generator);
+            if (!traced_ray) {
+              auto weight = lights.emission_weight(material_reference, origin, ray.position(), normal, scattering_pdf);
+              return radiance * weight;
+            }
+            auto diffuse = evaluable(materials, material_reference, normal);
+            if (sampled) {
+              auto displacement = ray.position() - origin;
+              auto cos_theta = std::abs(pbpt::tensor::dot(ray.direction(), normal));
+              spread += pbpt::math::sqrt(pbpt::tensor::dot(displacement, displacement) * ray.weight() / cos_theta);
+            }
+            if (diffuse && depth && (depth >= max_depth || (spread_factor > 0 && spread > max_spread))) {
+              auto cached_radiance = cache.find(ray.position(), normal);
+              if (cached_radiance) return cached_radiance.value() * ray.weight();
+            }
+
+            auto direct_radiance = next_event<Scalar, Vector>(
+                object, materials, lights, ray, normal, material_reference, generator
+            );
+            auto traced_pdf = [&](const auto &traced_ray) constexpr -> std::optional<Scalar> {
+              if (!direct_radiance) return std::nullopt;
+              auto out_direction = -ray.direction();
+              return material_pdf<Scalar>(materials, material_reference, out_direction, normal, traced_ray.direction());
+            };
+            auto continuation_rate = termination_policy(depth, throughput * radiance * traced_ray.value().weight());
+            auto num_paths = static_cast<std::size_t>(continuation_rate);
+            if (pbpt::random::uniform(generator, Scalar(0), Scalar(1)) < continuation_rate - num_paths) ++num_paths;
+            Vector<Scalar, 3> estimate{};
+            for (std::size_t path_index = 0; path_index < num_paths; ++path_index) {
+              if (path_index) std::tie(radiance, traced_ray) = materials(material_reference, ray, normal, generator);
+              auto traced_throughput = throughput * radiance / continuation_rate;
+              auto traced_radiance = self(
+                  self, traced_ray.value(), depth + 1, traced_throughput, traced_pdf(traced_ray.value()), spread,
+                  diffuse
+              );
+              estimate = estimate + radiance * traced_radiance;
+            }
+            if (num_paths) estimate = estimate / continuation_rate;
+            auto outgoing_radiance = direct_radiance ? direct_radiance.value() + estimate : estimate;
+            if (diffuse && ray.weight() > 0) cache.record(ray.position(), normal, outgoing_radiance / ray.weight());
+            return outgoing_radiance;
+          },
+          [&]() constexpr -> Vector<Scalar, 3> { return background(ray); }
+      );
+    }](auto &&...args) constexpr { return function(function, std::forward<decltype(args)>(args)...); };
+
+    return tracer(ray, std::size_t{0}, Vector<Scalar, 3>{1, 1, 1}, std::optional<Scalar>{}, Scalar(0), false);
+  };
+
+  render<Scalar, Vector, Generator>(
+      camera, image_width, image_height, start_index, stop_index, random_seed, pixel_selector, image_writer, integrator
+  );
+}
+
+}  // namespace pbpt::renderer
@@ -0,0 +1,237 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <optional>
+#include <tuple>
+#include <type_traits>
+#include <vector>
+
+#include "lights.hpp"
+#include "material.hpp"
+#include "math.hpp"
+#include "optics.hpp"
+#include "random.hpp"
+#include "scheduler.hpp"
+#include "tensor.hpp"
+#include "utility.hpp"
+
+namespace pbpt::renderer {
+
+/****************************************************************
+ * Reservoir-Based Spatiotemporal Importance Resampling (ReSTIR), spatial reuse only
+ * Direct lighting from the registered emitters at the first hit, in three passes over the pixels:
+ *   1. every pixel finds its first hit and streams M candidate points y_k on the emitters, drawn from the
+ *      light tree with density p(y) per unit area, through a reservoir keeping one with probability
+ *      proportional to w_k := p̂(y_k) / p(y_k), where the target p̂ is the unshadowed contribution
+ *      (see light_contribution) averaged over the channels,
+ *        W := Σ w_k / (M p̂(y)), so that light_contribution(y) W estimates the unshadowed direct lighting;
+ *   2. every pixel resamples its reservoir together with those of a few random neighbors within the radius
+ *      lying on a similar surface, each weighted by p̂(y_q) W_q M_q at the pixel, and divides by the total M
+ *      of the reservoirs whose targets could have produced the survivor, which keeps the combination unbiased;
+ *   3. only the survivor is shadow-traced:
+ *        Ld := light_contribution(y) V(y) W
+ * Light from the background and from unregistered emitters is gathered along one ray sampled from the material,
+ * as is all light at specular vertices.
+ ****************************************************************/
+template <
+    typename Scalar = double, template <typename, auto> typename Vector = pbpt::tensor::Vector,
+    typename Generator = pbpt::random::LinearCongruentialGenerator<>>
+constexpr auto restir_direct_lighting(
+    const auto &object, const auto &materials, const auto &lights, const auto &camera, auto background,
+    auto image_width, auto image_height, auto start_index, auto stop_index, std::size_t num_candidates,
+    std::size_t num_neighbors, auto reuse_radius, auto random_seed, const auto &pixel_selector, auto &image_writer
+) {
+  using Ray = std::decay_t<decltype(camera.ray(Scalar(0), Scalar(0), std::declval<Generator &>()))>;
+  using MaterialReference =
+      std::decay_t<decltype(object.intersect(std::declval<const Ray &>()).top().min().surface().material_reference())>;
+  using Emitter = std::decay_t<decltype(lights.emitters().front())>;
+
+  struct Vertex {
+    Ray ray;
+    Vector<Scalar, 3> normal;
+    MaterialReference material_reference;
+    Scalar depth;
+  };
+
+  struct LightSample {
+    const Emitter *emitter;
+    Vector<Scalar, 3> position;
+    Vector<Scalar, 3> normal;
+  };
+
+  struct Reservoir {
+    std::optional<LightSample> sample;
+    Scalar weight_sum = 0;
+    Scalar num_candidates = 0;
+    Scalar contribution_weight = 0;
+  };
+
+  struct Pixel {
+    bool selected = false;
+    Vector<Scalar, 3> radiance;
+    std::optional<Vertex> vertex;
+    Reservoir reservoir;
+    // seeds the generator of the later passes
+    decltype(std::declval<Generator &>()()) seed;
+  };
+
+  auto contribution = [&](const Vertex &vertex, const LightSample &sample, auto &generator) {
+    return light_contribution<Scalar, Vector>(
+        materials, vertex.ray, vertex.normal, vertex.material_reference, *sample.emitter, sample.position,
+        sample.normal, generator
+    );
+  };
+  auto target = [&](const Vertex &vertex, const LightSample &sample, auto &generator) {
+    return pbpt::tensor::sum(contribution(vertex, sample, generator)) / 3;
+  };
+  auto receiver = [](const Vertex &vertex) {
+    return pbpt::tensor::evaluate(vertex.ray.position() + pbpt::material::numbers::epsilon<Scalar> * vertex.normal);
+  };
+  // streams a weighted sample through the reservoir
+  auto update = [](Reservoir &reservoir, const LightSample &sample, Scalar weight, auto &generator) {
+    reservoir.weight_sum += weight;
+    if (weight > 0 && pbpt::random::uniform(generator, Scalar(0), Scalar(1)) * reservoir.weight_sum < weight) {
+      reservoir.sample = sample;
+    }
+  };
+
+  // neighbors whose normals are within about 25 degrees and whose depths are within 10 percent
+  constexpr auto similar_cosine = Scalar(0.9);
+  constexpr auto similar_depth = Scalar(0.1);
+
+  auto num_pixels = stop_index - start_index;
+  std::vector<Pixel> pixels(num_pixels);
+
+  // 1. first hits and candidates
+#ifdef _OPENMP
+#pragma omp parallel for
+#endif
+  for (decltype(num_pixels) local_index = 0; local_index < num_pixels; ++local_index) {
+    auto pixel_index = start_index + local_index;
+    if (!pixel_selector(pixel_index)) continue;
+    auto &pixel = pixels[local_index];
+    pixel.selected = true;
+
+    Generator generator(random_seed + pixel_index);
+    auto primary_ray = camera_ray<Scalar>(camera, pixel_index, image_width, image_height, generator);
+
+    pixel.radiance = closest_hit(
+        object, primary_ray,
+        [&](const auto &ray, const auto &normal, const auto &material_reference) -> Vector<Scalar, 3> {
+          auto [radiance, traced_ray] = materials(material_reference, ray, normal, generator);
+          if (!traced_ray) return radiance;
+          auto sampled_lights = !lights.empty() && evaluable(materials, material_reference, normal);
+          if (sampled_lights) {
+            auto depth = pbpt::tensor::norm(ray.position() - primary_ray.position());
+            pixel.vertex = Vertex{ray, normal, material_reference, depth};
+          }
+          const auto &light_ray = traced_ray.value();
+          auto indirect_radiance = closest_hit(
+              object, light_ray,
+              [&](const auto &ray, const auto &normal, const auto &material_reference) -> Vector<Scalar, 3> {
+                // registered emitters are left to the reservoirs
+                auto [radiance, traced_ray] = materials(material_reference, ray, normal, generator);
+                if (traced_ray || (sampled_lights && lights.find(material_reference))) return {};
+                return radiance;
+              },
+              [&]() -> Vector<Scalar, 3> { return background(light_ray); }
+          );
+          return radiance * indirect_radiance;
+        },
+        [&]() -> Vector<Scalar, 3> { return background(primary_ray); }
+    );
+
+    if (pixel.vertex) {
+      const auto &vertex = pixel.vertex.value();
+      auto &reservoir = pixel.reservoir;
+      for (std::size_t candidate_index = 0; candidate_index < num_candidates; ++candidate_index) {
+        ++reservoir.num_candidates;
+        auto emitter_sample = lights.sample(pbpt::random::uniform(generator, Scalar(0), Scalar(1)), receiver(vertex));
+        if (!emitter_sample) continue;
+        auto [emitter, emitter_probability] = emitter_sample.value();
+        auto [light_position, light_normal] = emitter.sample(
+            pbpt::random::uniform(generator, Scalar(0), Scalar(1)),
+            pbpt::random::uniform(generator, Scalar(0), Scalar(1))
+        );
+        auto sample = LightSample{&emitter, light_position, light_normal};
+        auto probability = emitter_probability * emitter.pdf(light_position);
+        update(reservoir, sample, target(vertex, sample, generator) / probability, generator);
+      }
+      if (reservoir.sample) {
+        auto sample_target = target(vertex, reservoir.sample.value(), generator);
+        reservoir.contribution_weight = reservoir.weight_sum / (reservoir.num_candidates * sample_target);
+      }
+    }
+    pixel.seed = generator();
+  }
+
+  // 2. spatial reuse and 3. shading
+#ifdef _OPENMP
+#pragma omp parallel for
+#endif
+  for (decltype(num_pixels) local_index = 0; local_index < num_pixels; ++local_index) {
+    const auto &pixel = pixels[local_index];
+    if (!pixel.selected) continue;
+    auto pixel_index = start_index + local_index;
+    auto radiance = pixel.radiance;
+
+    if (pixel.vertex) {
+      Generator generator(pixel.seed);
+      const auto &vertex = pixel.vertex.value();
+
+      std::vector<const Pixel *> sources = {&pixel};
+      auto pixel_u = pixel_index % image_width;
+      auto pixel_v = pixel_index / image_width;
+      for (std::size_t neighbor_index = 0; neighbor_index < num_neighbors; ++neighbor_index) {
+        auto offset_u = pbpt::random::uniform(generator, Scalar(-reuse_radius), Scalar(reuse_radius));
+        auto offset_v = pbpt::random::uniform(generator, Scalar(-reuse_radius), Scalar(reuse_radius));
+        auto neighbor_u = static_cast<decltype(pixel_index)>(std::round(pixel_u + offset_u));
+        auto neighbor_v = static_cast<decltype(pixel_index)>(std::round(pixel_v + offset_v));
+        if (neighbor_u < 0 || neighbor_u >= image_width || neighbor_v < 0 || neighbor_v >= image_height) continue;
+        auto neighbor_index_global = neighbor_v * image_width + neighbor_u;
+        if (neighbor_index_global < start_index || neighbor_index_global >= stop_index) continue;
+        if (neighbor_index_global == pixel_index) continue;
+        const auto &neighbor = pixels[neighbor_index_global - start_index];
+        if (!neighbor.vertex) continue;
+        // neighbors on other surfaces rarely want the same light, so they are skipped
+        const auto &neighbor_vertex = neighbor.vertex.value();
+        if (pbpt::tensor::dot(neighbor_vertex.normal, vertex.normal) < similar_cosine) continue;
+        if (std::abs(neighbor_vertex.depth - vertex.depth) > similar_depth * vertex.depth) continue;
+        sources.push_back(&neighbor);
+      }
+
+      Reservoir reservoir;
+      for (const auto *source : sources) {
+        const auto &source_reservoir = source->reservoir;
+        reservoir.num_candidates += source_reservoir.num_candidates;
+        if (!source_reservoir.sample) continue;
+        const auto &sample = source_reservoir.sample.value();
+        auto weight =
+            target(vertex, sample, generator) * source_reservoir.contribution_weight * source_reservoir.num_candidates;
+        update(reservoir, sample, weight, generator);
+      }
+
+      if (reservoir.sample) {
+        const auto &sample = reservoir.sample.value();
+        // the candidates of the sources whose targets are nonzero at the survivor
+        Scalar num_candidates = 0;
+        for (const auto *source : sources) {
+          if (target(source->vertex.value(), sample, generator) > 0) {
+            num_candidates += source->reservoir.num_candidates;
+          }
+        }
+        auto sample_contribution = contribution(vertex, sample, generator);
+        auto sample_target = pbpt::tensor::sum(sample_contribution) / 3;
+        if (visible<Scalar, Vector>(object, receiver(vertex), sample.position)) {
+          auto contribution_weight = reservoir.weight_sum / (num_candidates * sample_target);
+          radiance = radiance + sample_contribution * (vertex.ray.weight() * contribution_weight);
+        }
+      }
+    }
+
+    image_writer(pixel_index, radiance);
+  }
+}
+
+}  // namespace pbpt::renderer
@@ -0,0 +1,47 @@
+#pragma once
+
+#include "random.hpp"
+#include "tensor.hpp"
+
+namespace pbpt::renderer {
+
+// Camera ray through a uniformly jittered point of the pixel.
+template <typename Scalar = double>
+constexpr auto camera_ray(const auto &camera, auto pixel_index, auto image_width, auto image_height, auto &generator) {
+  auto pixel_index_u = pixel_index % image_width;
+  auto pixel_index_v = pixel_index / image_width;
+
+  auto pixel_coord_u = (pixel_index_u + pbpt::random::uniform(generator, Scalar(-0.5), Scalar(0.5))) / image_width;
+  auto pixel_coord_v = (pixel_index_v + pbpt::random::uniform(generator, Scalar(-0.5), Scalar(0.5))) / image_height;
+
+  return camera.ray(pixel_coord_u, pixel_coord_v, generator);
+}
+
+/****************************************************************
+ * Scheduler
+ * Shared by every integrator: walks the pixels in [start_index, stop_index) that the selector keeps,
+ * jitters a camera ray inside each and writes what the integrator estimates along it.
+ * An integrator is called as integrator(ray, generator) and returns the radiance along the ray.
+ ****************************************************************/
+template <
+    typename Scalar = double, template <typename, auto> typename Vector = pbpt::tensor::Vector,
+    typename Generator = pbpt::random::LinearCongruentialGenerator<>>
+constexpr auto render(
+    const auto &camera, auto image_width, auto image_height, auto start_index, auto stop_index, auto random_seed,
+    const auto &pixel_selector, auto &image_writer, const auto &integrator
+) {
+#ifdef _OPENMP
+#pragma omp parallel for
+#endif
+  for (auto pixel_index = start_index; pixel_index < stop_index; ++pixel_index) {
+    if (!pixel_selector(pixel_index)) continue;
+
+    Generator generator(random_seed + pixel_index);
+
+    auto ray = camera_ray<Scalar>(camera, pixel_index, image_width, image_height, generator);
+
+    image_writer(pixel_index, integrator(ray, generator));
+  }
+}
+
+}  // namespace pbpt::renderer
@@ -0,0 +1,107 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include "tensor.hpp"
+
+namespace pbpt::renderer {
+
+/****************************************************************
+ * Ray Sorting
+ * Reorders a batch of rays so that rays leaving the same region in the same octant are intersected back to back.
+ * key := octant (3 bits) | Morton code of the origin cell (3 x 10 bits)
+ * Sorting pays for itself only when the batch is large and the geometry does not fit in cache,
+ * so the sorter times both orders and keeps the cheaper one per ray:
+ *   cost(unsorted) := E[intersection time] / ray
+ *   cost(sorted)   := E[sorting time + intersection time] / ray
+ * One batch in `exploration_period` is run the other way to keep both estimates current.
+ ****************************************************************/
+template <typename Scalar = double>
+struct RaySorter {
+  using Clock = std::chrono::steady_clock;
+
+  static constexpr auto cell_bits = 10;
+  static constexpr auto exploration_period = 16;
+  static constexpr auto smoothing = 0.125;
+
+  constexpr RaySorter() = default;
+  constexpr RaySorter(bool enabled, Scalar cell_size) : m_enabled(enabled), m_cell_size(cell_size) {}
+
+  constexpr auto &enabled() & { return m_enabled; }
+  constexpr const auto &enabled() const & { return m_enabled; }
+  constexpr auto &&enabled() && { return std::move(m_enabled); }
+  constexpr const auto &&enabled() const && { return std::move(m_enabled); }
+
+  constexpr auto &cell_size() & { return m_cell_size; }
+  constexpr const auto &cell_size() const & { return m_cell_size; }
+  constexpr auto &&cell_size() && { return std::move(m_cell_size); }
+  constexpr const auto &&cell_size() const && { return std::move(m_cell_size); }
+
+  constexpr auto key(const auto &ray) const {
+    auto [direction_x, direction_y, direction_z] = ray.direction();
+    auto octant = std::uint64_t(direction_x < 0) | std::uint64_t(direction_y < 0) << 1 |
+                  std::uint64_t(direction_z < 0) << 2;
+    auto cell = [&](auto coord) constexpr {
+      constexpr auto offset = Scalar(1 << (cell_bits - 1));
+      auto index = std::clamp(std::floor(coord / m_cell_size) + offset, Scalar(0), 2 * offset - 1);
+      return static_cast<std::uint64_t>(index);
+    };
+    // interleaves the bits of the three cell indices
+    auto spread = [](std::uint64_t bits) constexpr {
+      bits = (bits | bits << 16) & 0x030000ff;
+      bits = (bits | bits << 8) & 0x0300f00f;
+      bits = (bits | bits << 4) & 0x030c30c3;
+      bits = (bits | bits << 2) & 0x09249249;
+      return bits;
+    };
+    auto [position_x, position_y, position_z] = ray.position();
+    auto morton = spread(cell(position_x)) | spread(cell(position_y)) << 1 | spread(cell(position_z)) << 2;
+    return octant << (3 * cell_bits) | morton;
+  }
+
+  // Whether the next batch should be sorted.
+  constexpr auto sorting() const {
+    if (!m_enabled) return false;
+    auto preferred = !m_unsorted_cost || (m_sorted_cost && m_sorted_cost < m_unsorted_cost);
+    return m_num_batches % exploration_period ? preferred : !preferred;
+  }
+
+  // Sorts the batch by the keys of the rays that ray_of(element) returns.
+  constexpr auto sort(auto &batch, const auto &ray_of) const {
+    std::vector<std::pair<std::uint64_t, std::size_t>> keys(batch.size());
+    for (std::size_t index = 0; index < batch.size(); ++index) keys[index] = {key(ray_of(batch[index])), index};
+    std::sort(std::begin(keys), std::end(keys));
+    std::decay_t<decltype(batch)> sorted_batch;
+    sorted_batch.reserve(batch.size());
+    for (auto [ray_key, index] : keys) sorted_batch.push_back(std::move(batch[index]));
+    batch = std::move(sorted_batch);
+  }
+
+  // Sorts the batch if the cost model says so, then intersects it and updates the model.
+  constexpr auto operator()(auto &batch, const auto &ray_of, const auto &intersector) {
+    if (!m_enabled || batch.empty()) return intersector(batch);
+    auto sorted = sorting();
+    auto start_time = Clock::now();
+    if (sorted) sort(batch, ray_of);
+    intersector(batch);
+    auto cost = std::chrono::duration<double>(Clock::now() - start_time).count() / batch.size();
+    auto &average_cost = sorted ? m_sorted_cost : m_unsorted_cost;
+    average_cost = average_cost ? average_cost + smoothing * (cost - average_cost) : cost;
+    ++m_num_batches;
+  }
+
+ private:
+  bool m_enabled = false;
+  Scalar m_cell_size = 1;
+  // cost model
+  double m_unsorted_cost = 0;
+  double m_sorted_cost = 0;
+  std::size_t m_num_batches = 0;
+};
+
+}  // namespace pbpt::renderer
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <cstddef>
+
+#include "math.hpp"
+#include "tensor.hpp"
+
+namespace pbpt::renderer {
+
+/****************************************************************
+ * Termination Policy
+ * A policy maps (depth, throughput) to the expected number of paths continued from a vertex:
+ *   q < 1 : Russian roulette (the path survives with probability q)
+ *   q = 1 : the path always continues
+ *   q > 1 : splitting (floor(q) or ceil(q) paths are traced)
+ * Every continued path is weighted by 1 / q, which keeps the estimator unbiased.
+ * Whatever the policy, the path integrator ends paths at max_path_depth bounces, so that a policy that never
+ * terminates (say, RussianRoulette with p = 1) cannot recurse through the stack.
+ ****************************************************************/
+
+inline constexpr std::size_t max_path_depth = 256;
+
+// Continues every path with the same probability regardless of its throughput.
+template <typename Scalar = double>
+struct RussianRoulette {
+  constexpr RussianRoulette() = default;
+  constexpr RussianRoulette(Scalar bernoulli_p) : m_bernoulli_p(bernoulli_p) {}
+
+  constexpr auto &bernoulli_p() & { return m_bernoulli_p; }
+  constexpr const auto &bernoulli_p() const & { return m_bernoulli_p; }
+  constexpr auto &&bernoulli_p() && { return std::move(m_bernoulli_p); }
+  constexpr const auto &&bernoulli_p() const && { return std::move(m_bernoulli_p); }
+
+  constexpr auto operator()(auto, const auto &) const -> Scalar { return m_bernoulli_p; }
+
+ private:
+  Scalar m_bernoulli_p = 1.0;
+};
+
+// Continues a path in proportion to its throughput once it has bounced `min_depth` times.
+// Paths whose throughput exceeds one are split into at most `max_splits` paths.
+template <typename Scalar = double>
+struct AdaptiveRoulette {
+  constexpr AdaptiveRoulette() = default;
+  constexpr AdaptiveRoulette(std::size_t min_depth, Scalar max_probability, std::size_t max_splits)
+      : m_min_depth(min_depth), m_max_probability(max_probability), m_max_splits(max_splits) {}
+
+  constexpr auto &min_depth() & { return m_min_depth; }
+  constexpr const auto &min_depth() const & { return m_min_depth; }
+  constexpr auto &&min_depth() && { return std::move(m_min_depth); }
+  constexpr const auto &&min_depth() const && { return std::move(m_min_depth); }
+
+  constexpr auto &max_probability() & { return m_max_probability; }
+  constexpr const auto &max_probability() const & { return m_max_probability; }
+  constexpr auto &&max_probability() && { return std::move(m_max_probability); }
+  constexpr const auto &&max_probability() const && { return std::move(m_max_probability); }
+
+  constexpr auto &max_splits() & { return m_max_splits; }
+  constexpr const auto &max_splits() const & { return m_max_splits; }
+  constexpr auto &&max_splits() && { return std::move(m_max_splits); }
+  constexpr const auto &&max_splits() const && { return std::move(m_max_splits); }
+
+  constexpr auto operator()(auto depth, const auto &throughput) const -> Scalar {
+    auto weight = static_cast<Scalar>(pbpt::tensor::max(throughput));
+    if (weight > 1 && m_max_splits > 1) return std::min(weight, static_cast<Scalar>(m_max_splits));
+    if (depth < m_min_depth) return 1;
+    return pbpt::math::clamp(weight, static_cast<Scalar>(0), m_max_probability);
+  }
+
+ private:
+  std::size_t m_min_depth = 0;
+  Scalar m_max_probability = 1.0;
+  std::size_t m_max_splits = 1;
+};
+
+}  // namespace pbpt::renderer
@@ -0,0 +1,132 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "common.hpp"
+#include "geometry.hpp"
+#include "lights.hpp"
+
+namespace pbpt::renderer {
+
+/****************************************************************
+ * Resumable Traversal
+ * object.intersect(ray) walks the whole union tree in one recursive call, so nothing can run while an operand loads.
+ * The traversal compiles the tree once into a postfix program over an explicit stack of occupations:
+ *   leaf g := push g.intersect(ray)
+ *   unite  := pop the two operands, push csg::unite of them
+ * and each ray keeps its own program counter and stack. step() runs a few leaves, prefetches the leaves of the next
+ * step and returns, so a caller can round-robin over many rays. Of the two subtrees of a union, the one needing the
+ * deeper stack is emitted first (Sethi-Ullman order), which keeps a right-leaning chain at two entries; the operands
+ * still meet in their own order, so the occupations are exactly those of object.intersect(ray).
+ * Only trees whose leaves share one type compile into a program (see UnionTree).
+ ****************************************************************/
+
+// The leaves of a union tree: Leaf is the type they share (void if they differ), and stack_size the depth of the
+// stack the postfix program needs.
+template <typename Geometry>
+struct UnionTree {
+  using Leaf = Geometry;
+  static constexpr std::size_t stack_size = 1;
+};
+
+template <typename Geometry1, typename Geometry2>
+struct UnionTree<pbpt::geometry::csg::Union<Geometry1, Geometry2>> {
+  using Leaf = std::conditional_t<
+      std::is_same_v<typename UnionTree<Geometry1>::Leaf, typename UnionTree<Geometry2>::Leaf>,
+      typename UnionTree<Geometry1>::Leaf, void>;
+  static constexpr std::size_t stack_size =
+      UnionTree<Geometry1>::stack_size == UnionTree<Geometry2>::stack_size
+          ? UnionTree<Geometry1>::stack_size + 1
+          : std::max(UnionTree<Geometry1>::stack_size, UnionTree<Geometry2>::stack_size);
+};
+
+template <typename Object, typename Ray>
+class ResumableTraversal {
+ public:
+  using Leaf = typename UnionTree<Object>::Leaf;
+  using Occupations = std::decay_t<decltype(std::declval<const Leaf &>().intersect(std::declval<const Ray &>()))>;
+
+  // Where one ray stands in the program.
+  struct State {
+    std::size_t counter = 0;
+    std::vector<Occupations> stack;
+  };
+
+  explicit ResumableTraversal(const Object &object) { compile(object); }
+
+  // Rewinds the program and prefetches the leaves of the first step.
+  auto start(State &state, std::size_t num_leaves) const {
+    state.counter = 0;
+    state.stack.clear();
+    state.stack.reserve(UnionTree<Object>::stack_size);
+    prefetch(state, num_leaves);
+  }
+
+  // Runs the program over the next num_leaves leaves; true once the occupations are complete.
+  auto step(State &state, const Ray &ray, std::size_t num_leaves) const -> bool {
+    for (std::size_t leaf_index = 0; state.counter < m_instructions.size(); ++state.counter) {
+      const auto &[leaf, first_on_top] = m_instructions[state.counter];
+      if (leaf) {
+        if (leaf_index++ == num_leaves) break;
+        state.stack.push_back(leaf->intersect(ray));
+      } else {
+        auto top = std::move(state.stack.back());
+        state.stack.pop_back();
+        auto &below = state.stack.back();
+        below = first_on_top ? pbpt::geometry::csg::unite(std::move(top), std::move(below))
+                             : pbpt::geometry::csg::unite(std::move(below), std::move(top));
+      }
+    }
+    if (state.counter == m_instructions.size()) return true;
+    prefetch(state, num_leaves);
+    return false;
+  }
+
+  // The occupations of the object along the ray, once step() has returned true.
+  auto occupations(State &state) const -> Occupations { return std::move(state.stack.back()); }
+
+ private:
+  struct Instruction {
+    // nullptr for unite
+    const Leaf *leaf;
+    // whether the first operand of unite is on top of the second
+    bool first_on_top;
+  };
+
+  auto compile(const auto &geometry) -> void {
+    using Geometry = std::decay_t<decltype(geometry)>;
+    if constexpr (is_union<Geometry>::value) {
+      using First = std::decay_t<decltype(geometry.first)>;
+      using Second = std::decay_t<decltype(geometry.second)>;
+      auto first_on_top = UnionTree<First>::stack_size < UnionTree<Second>::stack_size;
+      if (first_on_top) {
+        compile(geometry.second);
+        compile(geometry.first);
+      } else {
+        compile(geometry.first);
+        compile(geometry.second);
+      }
+      m_instructions.push_back({nullptr, first_on_top});
+    } else {
+      m_instructions.push_back({&geometry, false});
+    }
+  }
+
+  // Loads the leaves the next num_leaves leaf instructions will read.
+  auto prefetch(const State &state, std::size_t num_leaves) const {
+    for (auto counter = state.counter; counter < m_instructions.size() && num_leaves; ++counter) {
+      if (const auto *leaf = m_instructions[counter].leaf) {
+        pbpt::prefetch(*leaf);
+        --num_leaves;
+      }
+    }
+  }
+
+  std::vector<Instruction> m_instructions;
+};
+
+}  // namespace pbpt::renderer
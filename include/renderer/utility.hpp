@@ -0,0 +1,24 @@
+#pragma once
+
+namespace pbpt::renderer {
+
+// Finds the closest surface in front of the ray among the occupations an object has found along it.
+// On a hit, calls hit(ray, normal, material_reference) with the ray advanced to the surface; otherwise calls miss().
+constexpr auto closest_hit_among(auto occupations, const auto &ray, const auto &hit, const auto &miss) {
+  while (!occupations.empty() && occupations.top().max().distance() <= 0) occupations.pop();
+
+  if (occupations.empty()) return miss();
+
+  const auto &intersection = occupations.top().min().distance() > 0 ? occupations.top().min() : occupations.top().max();
+
+  auto advanced_ray = ray.advanced(intersection.distance());
+  auto normal = intersection.surface().normal_evaluator()(advanced_ray.position());
+  return hit(advanced_ray, normal, intersection.surface().material_reference());
+}
+
+// Finds the closest surface of the object in front of the ray; see closest_hit_among.
+constexpr auto closest_hit(const auto &object, const auto &ray, const auto &hit, const auto &miss) {
+  return closest_hit_among(object.intersect(ray), ray, hit, miss);
+}
+
+}  // namespace pbpt::renderer
@@ -1,2 +1,5 @@
+#include "tensor/batch.hpp"
+#include "tensor/expression.hpp"
 #include "tensor/matrix.hpp"
+#include "tensor/simd.hpp"
 #include "tensor/tensor.hpp"
@@ -0,0 +1,322 @@
+#pragma once
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <functional>
+#include <type_traits>
+#include <utility>
+
+#include "math.hpp"
+#include "tensor.hpp"
+
+namespace pbpt::tensor {
+
+// ================================================================
+// lanes
+
+// Fixed-width, aligned group of scalars operated on as one value.
+// Every arithmetic operator is a plain loop over the lanes, which the compiler turns into SIMD instructions.
+template <typename T, auto N>
+struct Lanes {
+  static constexpr auto lanes = N;
+  static constexpr std::size_t alignment = std::bit_floor(std::min<std::size_t>(N * sizeof(T), 64));
+
+  alignas(alignment) T elements[N];
+
+  constexpr auto &operator[](std::size_t lane) { return elements[lane]; }
+  constexpr const auto &operator[](std::size_t lane) const { return elements[lane]; }
+
+  constexpr auto begin() { return elements; }
+  constexpr auto begin() const { return elements; }
+
+  constexpr auto end() { return elements + N; }
+  constexpr auto end() const { return elements + N; }
+
+  static constexpr auto size() { return static_cast<std::size_t>(N); }
+};
+
+template <auto N>
+using Mask = Lanes<bool, N>;
+
+template <typename T>
+struct is_lanes : std::false_type {};
+
+template <typename T, auto N>
+struct is_lanes<Lanes<T, N>> : std::true_type {};
+
+template <typename T>
+inline constexpr auto is_lanes_v = is_lanes<T>::value;
+
+template <typename T>
+concept LanesShaped = is_lanes_v<T>;
+
+template <typename T>
+concept LaneScalar = std::is_arithmetic_v<T>;
+
+template <auto N>
+constexpr auto map_lanes(auto function, const auto &...operands) {
+  auto lane_of = [](const auto &operand, auto lane) constexpr {
+    if constexpr (LanesShaped<std::decay_t<decltype(operand)>>) {
+      return operand[lane];
+    } else {
+      return operand;
+    }
+  };
+  Lanes<std::decay_t<decltype(function(lane_of(operands, 0)...))>, N> result{};
+  for (std::size_t lane = 0; lane < N; ++lane) result[lane] = function(lane_of(operands, lane)...);
+  return result;
+}
+
+// ================================================================
+// lanewise operators
+
+// Lanes of one type with each other, or with a scalar that is broadcast to every lane in the lane type.
+template <typename T1, typename T2>
+concept LanesOperands = (LanesShaped<T1> && LanesShaped<T2> && std::is_same_v<T1, T2>) ||
+                        (LanesShaped<T1> && LaneScalar<T2>) || (LaneScalar<T1> && LanesShaped<T2>);
+
+// Applies a binary function lane by lane, with both operands in the lane type.
+template <typename Operand1, typename Operand2>
+constexpr auto lanewise(auto function, const Operand1 &operand_1, const Operand2 &operand_2) {
+  using Lanes = std::conditional_t<LanesShaped<Operand1>, Operand1, Operand2>;
+  using T = std::decay_t<decltype(std::declval<const Lanes &>()[0])>;
+  return map_lanes<Lanes::lanes>(
+      [&](auto x, auto y) constexpr { return function(static_cast<T>(x), static_cast<T>(y)); }, operand_1, operand_2
+  );
+}
+
+template <typename Operand1, typename Operand2>
+constexpr auto operator+(const Operand1 &operand_1, const Operand2 &operand_2)
+  requires LanesOperands<Operand1, Operand2>
+{
+  return lanewise(std::plus<>(), operand_1, operand_2);
+}
+
+template <typename Operand1, typename Operand2>
+constexpr auto operator-(const Operand1 &operand_1, const Operand2 &operand_2)
+  requires LanesOperands<Operand1, Operand2>
+{
+  return lanewise(std::minus<>(), operand_1, operand_2);
+}
+
+template <typename Operand1, typename Operand2>
+constexpr auto operator*(const Operand1 &operand_1, const Operand2 &operand_2)
+  requires LanesOperands<Operand1, Operand2>
+{
+  return lanewise(std::multiplies<>(), operand_1, operand_2);
+}
+
+template <typename Operand1, typename Operand2>
+constexpr auto operator/(const Operand1 &operand_1, const Operand2 &operand_2)
+  requires LanesOperands<Operand1, Operand2>
+{
+  return lanewise(std::divides<>(), operand_1, operand_2);
+}
+
+template <typename Operand1, typename Operand2>
+constexpr auto operator<(const Operand1 &operand_1, const Operand2 &operand_2)
+  requires LanesOperands<Operand1, Operand2>
+{
+  return lanewise(std::less<>(), operand_1, operand_2);
+}
+
+template <typename Operand1, typename Operand2>
+constexpr auto operator<=(const Operand1 &operand_1, const Operand2 &operand_2)
+  requires LanesOperands<Operand1, Operand2>
+{
+  return lanewise(std::less_equal<>(), operand_1, operand_2);
+}
+
+template <typename Operand1, typename Operand2>
+constexpr auto operator>(const Operand1 &operand_1, const Operand2 &operand_2)
+  requires LanesOperands<Operand1, Operand2>
+{
+  return lanewise(std::greater<>(), operand_1, operand_2);
+}
+
+template <typename Operand1, typename Operand2>
+constexpr auto operator>=(const Operand1 &operand_1, const Operand2 &operand_2)
+  requires LanesOperands<Operand1, Operand2>
+{
+  return lanewise(std::greater_equal<>(), operand_1, operand_2);
+}
+
+template <typename Operand1, typename Operand2>
+constexpr auto operator==(const Operand1 &operand_1, const Operand2 &operand_2)
+  requires LanesOperands<Operand1, Operand2>
+{
+  return lanewise(std::equal_to<>(), operand_1, operand_2);
+}
+
+template <typename Operand1, typename Operand2>
+constexpr auto operator!=(const Operand1 &operand_1, const Operand2 &operand_2)
+  requires LanesOperands<Operand1, Operand2>
+{
+  return lanewise(std::not_equal_to<>(), operand_1, operand_2);
+}
+
+// bitwise operators keep the lane type, so that masks combine into masks rather than into lanes of int
+template <typename Operand1, typename Operand2>
+constexpr auto operator&(const Operand1 &operand_1, const Operand2 &operand_2)
+  requires LanesOperands<Operand1, Operand2>
+{
+  return lanewise([](auto x, auto y) constexpr { return static_cast<decltype(x)>(x & y); }, operand_1, operand_2);
+}
+
+template <typename Operand1, typename Operand2>
+constexpr auto operator|(const Operand1 &operand_1, const Operand2 &operand_2)
+  requires LanesOperands<Operand1, Operand2>
+{
+  return lanewise([](auto x, auto y) constexpr { return static_cast<decltype(x)>(x | y); }, operand_1, operand_2);
+}
+
+template <typename T, auto N>
+constexpr auto operator-(const Lanes<T, N> &lanes) {
+  return map_lanes<N>([](auto x) constexpr { return -x; }, lanes);
+}
+
+template <auto N>
+constexpr auto operator!(const Mask<N> &mask) {
+  return map_lanes<N>([](auto x) constexpr { return !x; }, mask);
+}
+
+template <auto N>
+constexpr auto any(const Mask<N> &mask) {
+  return std::any_of(std::begin(mask), std::end(mask), [](auto x) constexpr { return x; });
+}
+
+template <auto N>
+constexpr auto all(const Mask<N> &mask) {
+  return std::all_of(std::begin(mask), std::end(mask), [](auto x) constexpr { return x; });
+}
+
+template <auto N>
+constexpr auto none(const Mask<N> &mask) {
+  return !any(mask);
+}
+
+// ================================================================
+// batch
+
+// A batch of N tensors of shape Ns... in structure-of-arrays layout: every tensor element is a group of N lanes.
+// All tensor operations (dot, cross, normalized, elemwise, matrix %) apply to the whole batch at once.
+template <typename T, auto N, auto... Ns>
+using TensorBatch = Tensor<Lanes<T, N>, Ns...>;
+
+template <typename T, auto N, auto M>
+using VectorBatch = TensorBatch<T, N, M>;
+
+template <typename T, auto N, auto M1, auto M2>
+using MatrixBatch = TensorBatch<T, N, M1, M2>;
+
+template <typename T>
+struct is_batch : std::false_type {};
+
+template <template <typename, auto> typename Array, typename T, auto N, auto... Ns>
+struct is_batch<GenericTensor<Array, Lanes<T, N>, Ns...>> : std::true_type {};
+
+template <typename T>
+inline constexpr auto is_batch_v = is_batch<T>::value;
+
+template <typename T>
+concept BatchShaped = TensorShaped<T> && is_batch_v<T>;
+
+template <typename T>
+struct unbatched {
+  using type = T;
+};
+
+template <typename T, auto N>
+struct unbatched<Lanes<T, N>> {
+  using type = T;
+};
+
+template <template <typename, auto> typename Array, typename T, auto N, auto... Ns>
+struct unbatched<GenericTensor<Array, Lanes<T, N>, Ns...>> {
+  using type = GenericTensor<Array, T, Ns...>;
+};
+
+template <typename T>
+using unbatched_t = typename unbatched<T>::type;
+
+// ================================================================
+// lane access
+
+template <typename Batch>
+constexpr auto get_lane(const Batch &batch, std::size_t lane) -> unbatched_t<Batch> {
+  if constexpr (LanesShaped<Batch>) {
+    return batch[lane];
+  } else {
+    return [&]<auto... Is>(std::index_sequence<Is...>) constexpr -> unbatched_t<Batch> {
+      return {get_lane(get<Is>(batch), lane)...};
+    }(std::make_index_sequence<dimension_v<Batch, 0>>{});
+  }
+}
+
+template <typename Batch>
+constexpr auto set_lane(Batch &batch, std::size_t lane, const unbatched_t<Batch> &value) {
+  if constexpr (LanesShaped<Batch>) {
+    batch[lane] = value;
+  } else {
+    [&]<auto... Is>(std::index_sequence<Is...>) constexpr {
+      (set_lane(get<Is>(batch), lane, get<Is>(value)), ...);
+    }(std::make_index_sequence<dimension_v<Batch, 0>>{});
+  }
+}
+
+// ================================================================
+// masked operations
+
+// Picks each lane from the first operand where the mask is set, and from the second one elsewhere.
+template <auto N, typename Batch>
+constexpr auto select(const Mask<N> &mask, const Batch &batch_1, const Batch &batch_2) -> Batch {
+  if constexpr (LanesShaped<Batch>) {
+    return map_lanes<N>([](auto m, auto x, auto y) constexpr { return m ? x : y; }, mask, batch_1, batch_2);
+  } else {
+    return [&]<auto... Is>(std::index_sequence<Is...>) constexpr -> Batch {
+      return {select(mask, get<Is>(batch_1), get<Is>(batch_2))...};
+    }(std::make_index_sequence<dimension_v<Batch, 0>>{});
+  }
+}
+
+// Overwrites only the lanes of the destination where the mask is set.
+template <auto N, typename Batch>
+constexpr auto masked_assign(const Mask<N> &mask, Batch &destination, const Batch &source) {
+  destination = select(mask, source, destination);
+}
+
+// ================================================================
+// norm
+
+template <BatchShaped Batch>
+constexpr auto norm(const Batch &batch) {
+  auto squared_norm = dot(batch, batch);
+  return map_lanes<decltype(squared_norm)::lanes>([](auto x) { return std::sqrt(x); }, squared_norm);
+}
+
+template <BatchShaped Batch>
+constexpr auto normalized(const Batch &batch) {
+  auto inverse_norm = 1 / norm(batch);
+  return batch * inverse_norm;
+}
+
+// ================================================================
+// elemwise
+
+// The function is applied to every lane of every element.
+template <typename Function, typename Tensor>
+constexpr auto elemwise(Function &&function, Tensor &&tensor)
+  requires BatchShaped<std::decay_t<Tensor>> || LanesShaped<std::decay_t<Tensor>>
+{
+  using Batch = std::decay_t<Tensor>;
+  if constexpr (LanesShaped<Batch>) {
+    return map_lanes<Batch::lanes>(function, tensor);
+  } else {
+    return [&]<auto... Is>(std::index_sequence<Is...>) constexpr -> Batch {
+      return {elemwise(function, get<Is>(tensor))...};
+    }(std::make_index_sequence<dimension_v<Batch, 0>>{});
+  }
+}
+
+}  // namespace pbpt::tensor
@@ -0,0 +1,184 @@
+#pragma once
+
+#include <functional>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+#include "math.hpp"
+#include "tensor.hpp"
+
+namespace pbpt::tensor {
+
+// ================================================================
+// lazy evaluation
+
+/****************************************************************
+ * Expression Templates
+ * lazy(tensor) opens an expression whose elementwise operators and reductions build a tree instead of tensors.
+ * The tree is evaluated element by element in a single pass when it is assigned to a tensor (or passed to evaluate).
+ * Lvalue tensors are held by reference and rvalue tensors by value, so temporaries never dangle;
+ * an expression must not outlive the lvalue tensors it refers to.
+ ****************************************************************/
+template <typename Function, typename... Operands>
+struct LazyElemwise;
+
+template <typename Function, typename... Operands>
+struct is_lazy<LazyElemwise<Function, Operands...>> : std::true_type {};
+
+template <typename T>
+struct lazy_tensor : std::conditional<TensorShaped<T>, T, void> {};
+
+template <typename Function, typename... Operands>
+struct lazy_tensor<LazyElemwise<Function, Operands...>> {
+  using type = std::tuple_element_t<
+      0, decltype(std::tuple_cat(
+             std::conditional_t<
+                 std::is_void_v<typename lazy_tensor<std::decay_t<Operands>>::type>, std::tuple<>,
+                 std::tuple<typename lazy_tensor<std::decay_t<Operands>>::type>>{}...
+         ))>;
+};
+
+template <typename T>
+using lazy_tensor_t = typename lazy_tensor<T>::type;
+
+template <auto I>
+constexpr decltype(auto) lazy_get(const auto &operand) {
+  if constexpr (LazyShaped<std::decay_t<decltype(operand)>>) {
+    return operand.template get<I>();
+  } else if constexpr (TensorShaped<std::decay_t<decltype(operand)>>) {
+    return pbpt::tensor::get<I>(operand);
+  } else {
+    return operand;
+  }
+}
+
+template <typename Function, typename... Operands>
+struct LazyElemwise : std::tuple<Function, Operands...> {
+  using std::tuple<Function, Operands...>::tuple;
+
+  template <auto I>
+  constexpr auto get() const {
+    return std::apply(
+        [](const auto &function, const auto &...operands) constexpr { return function(lazy_get<I>(operands)...); },
+        static_cast<const std::tuple<Function, Operands...> &>(*this)
+    );
+  }
+
+  template <TensorShaped Tensor>
+  constexpr operator Tensor() const {
+    return [this]<auto... Is>(std::index_sequence<Is...>) constexpr -> Tensor {
+      return {get<Is>()...};
+    }(std::make_index_sequence<dimension_v<Tensor, 0>>{});
+  }
+};
+
+template <typename T>
+concept LazyOperand = LazyShaped<std::decay_t<T>> || TensorShaped<std::decay_t<T>> || ScalarShaped<std::decay_t<T>>;
+
+// lvalue tensors are referred to, everything else is stored by value
+template <typename T>
+using lazy_storage_t = std::conditional_t<
+    std::is_lvalue_reference_v<T> && TensorShaped<std::decay_t<T>>, const std::decay_t<T> &, std::decay_t<T>>;
+
+template <typename Function, typename... Operands>
+constexpr auto make_lazy_elemwise(Function &&function, Operands &&...operands) {
+  return LazyElemwise<std::decay_t<Function>, lazy_storage_t<Operands &&>...>(
+      std::forward<Function>(function), std::forward<Operands>(operands)...
+  );
+}
+
+template <typename Tensor>
+constexpr auto lazy(Tensor &&tensor) {
+  if constexpr (LazyShaped<std::decay_t<Tensor>>) {
+    return std::decay_t<Tensor>(std::forward<Tensor>(tensor));
+  } else {
+    return make_lazy_elemwise(std::identity(), std::forward<Tensor>(tensor));
+  }
+}
+
+template <typename Expression>
+constexpr auto evaluate(Expression &&expression) {
+  if constexpr (LazyShaped<std::decay_t<Expression>>) {
+    return static_cast<lazy_tensor_t<std::decay_t<Expression>>>(expression);
+  } else {
+    return std::decay_t<Expression>(std::forward<Expression>(expression));
+  }
+}
+
+// ================================================================
+// arithmetic
+
+template <LazyOperand Operand1, LazyOperand Operand2>
+constexpr auto operator+(Operand1 &&operand_1, Operand2 &&operand_2)
+  requires LazyShaped<std::decay_t<Operand1>> || LazyShaped<std::decay_t<Operand2>>
+{
+  return make_lazy_elemwise(std::plus<>(), std::forward<Operand1>(operand_1), std::forward<Operand2>(operand_2));
+}
+
+template <LazyOperand Operand1, LazyOperand Operand2>
+constexpr auto operator-(Operand1 &&operand_1, Operand2 &&operand_2)
+  requires LazyShaped<std::decay_t<Operand1>> || LazyShaped<std::decay_t<Operand2>>
+{
+  return make_lazy_elemwise(std::minus<>(), std::forward<Operand1>(operand_1), std::forward<Operand2>(operand_2));
+}
+
+template <LazyOperand Operand1, LazyOperand Operand2>
+constexpr auto operator*(Operand1 &&operand_1, Operand2 &&operand_2)
+  requires LazyShaped<std::decay_t<Operand1>> || LazyShaped<std::decay_t<Operand2>>
+{
+  return make_lazy_elemwise(std::multiplies<>(), std::forward<Operand1>(operand_1), std::forward<Operand2>(operand_2));
+}
+
+template <LazyOperand Operand1, LazyOperand Operand2>
+constexpr auto operator/(Operand1 &&operand_1, Operand2 &&operand_2)
+  requires LazyShaped<std::decay_t<Operand1>> || LazyShaped<std::decay_t<Operand2>>
+{
+  return make_lazy_elemwise(std::divides<>(), std::forward<Operand1>(operand_1), std::forward<Operand2>(operand_2));
+}
+
+template <typename Function, typename Tensor>
+constexpr auto elemwise(Function &&function, Tensor &&tensor)
+  requires LazyShaped<std::decay_t<Tensor>>
+{
+  return make_lazy_elemwise(std::forward<Function>(function), std::forward<Tensor>(tensor));
+}
+
+// ================================================================
+// reduction
+
+template <LazyShaped Expression>
+constexpr auto sum(const Expression &expression) {
+  return [&]<auto... Is>(std::index_sequence<Is...>) constexpr {
+    return (expression.template get<Is>() + ...);
+  }(std::make_index_sequence<dimension_v<lazy_tensor_t<Expression>, 0>>{});
+}
+
+template <LazyShaped Expression>
+constexpr auto prod(const Expression &expression) {
+  return [&]<auto... Is>(std::index_sequence<Is...>) constexpr {
+    return (expression.template get<Is>() * ...);
+  }(std::make_index_sequence<dimension_v<lazy_tensor_t<Expression>, 0>>{});
+}
+
+template <LazyOperand Operand1, LazyOperand Operand2>
+constexpr auto dot(const Operand1 &operand_1, const Operand2 &operand_2)
+  requires LazyShaped<Operand1> || LazyShaped<Operand2>
+{
+  return sum(lazy(operand_1) * operand_2);
+}
+
+template <LazyShaped Expression>
+constexpr auto norm(const Expression &expression) {
+  return pbpt::math::sqrt(dot(expression, expression));
+}
+
+template <typename Expression>
+constexpr auto normalized(Expression &&expression)
+  requires LazyShaped<std::decay_t<Expression>>
+{
+  auto length = norm(expression);
+  return std::forward<Expression>(expression) / length;
+}
+
+}  // namespace pbpt::tensor
@@ -0,0 +1,228 @@
+#pragma once
+
+#include <algorithm>
+#include <bit>
+#include <concepts>
+#include <experimental/simd>
+#include <type_traits>
+
+#include "math.hpp"
+#include "tensor.hpp"
+
+namespace pbpt::tensor {
+
+// ================================================================
+// storage
+
+// Drop-in replacement for std::array whose arithmetic elements are padded to a multiple of 4 lanes.
+// The padding lanes are always zero so that they can take part in horizontal reductions.
+template <typename T, auto N>
+struct SimdArray {
+  static constexpr std::size_t width = std::is_arithmetic_v<T> ? (N + 3) / 4 * 4 : N;
+  static constexpr std::size_t alignment =
+      std::is_arithmetic_v<T> ? std::bit_floor(std::min<std::size_t>(width * sizeof(T), 64)) : alignof(T);
+
+  alignas(alignment) T elements[width]{};
+
+  constexpr auto &operator[](std::size_t index) { return elements[index]; }
+  constexpr const auto &operator[](std::size_t index) const { return elements[index]; }
+
+  constexpr auto data() { return elements; }
+  constexpr auto data() const { return elements; }
+
+  constexpr auto begin() { return elements; }
+  constexpr auto begin() const { return elements; }
+
+  constexpr auto end() { return elements + N; }
+  constexpr auto end() const { return elements + N; }
+
+  static constexpr auto size() { return static_cast<std::size_t>(N); }
+};
+
+template <typename T, auto... Ns>
+using SimdTensor = GenericTensor<SimdArray, T, Ns...>;
+
+template <typename T, auto N>
+using SimdVector = SimdTensor<T, N>;
+
+template <typename T, auto M, auto N>
+using SimdMatrix = SimdTensor<T, M, N>;
+
+template <typename T>
+struct is_simd_vector : std::false_type {};
+
+template <std::floating_point T, auto N>
+struct is_simd_vector<SimdVector<T, N>> : std::true_type {};
+
+template <typename T>
+inline constexpr auto is_simd_vector_v = is_simd_vector<T>::value;
+
+template <typename T>
+concept SimdVectorShaped = is_simd_vector_v<T>;
+
+template <typename T>
+concept Arithmetic = std::is_arithmetic_v<T>;
+
+// ================================================================
+// pack
+
+template <typename T, auto N>
+using SimdPack = std::experimental::fixed_size_simd<T, SimdArray<T, N>::width>;
+
+template <typename T, auto N>
+constexpr auto simd_mask() {
+  return SimdPack<T, N>([](auto lane) { return static_cast<T>(lane); }) < static_cast<T>(N);
+}
+
+template <typename T, auto N>
+constexpr auto simd_load(const SimdVector<T, N> &tensor) {
+  return SimdPack<T, N>(tensor.data(), std::experimental::element_aligned);
+}
+
+template <typename T, auto N>
+constexpr auto simd_load(Arithmetic auto scalar) {
+  return SimdPack<T, N>(static_cast<T>(scalar));
+}
+
+constexpr auto simd_lane(const SimdVectorShaped auto &tensor, auto index) { return tensor[index]; }
+
+constexpr auto simd_lane(Arithmetic auto scalar, auto) { return scalar; }
+
+// Applies a lane-wise function to tensors and scalars in a single pass over packed registers.
+template <std::floating_point T, auto N>
+constexpr auto simd_map(auto function, const auto &...operands) -> SimdVector<T, N> {
+  SimdVector<T, N> result{};
+  if (std::is_constant_evaluated()) {
+    for (std::size_t index = 0; index < N; ++index) {
+      result[index] = function(static_cast<T>(simd_lane(operands, index))...);
+    }
+  } else {
+    auto pack = function(simd_load<T, N>(operands)...);
+    std::experimental::where(!simd_mask<T, N>(), pack) = 0;
+    pack.copy_to(result.data(), std::experimental::element_aligned);
+  }
+  return result;
+}
+
+// ================================================================
+// arithmetic
+
+template <std::floating_point T, auto N>
+constexpr auto operator+(const SimdVector<T, N> &tensor_1, const SimdVector<T, N> &tensor_2) {
+  return simd_map<T, N>([](auto x, auto y) { return x + y; }, tensor_1, tensor_2);
+}
+
+template <std::floating_point T, auto N, Arithmetic Scalar>
+constexpr auto operator+(const SimdVector<T, N> &tensor, Scalar scalar) {
+  return simd_map<T, N>([](auto x, auto y) { return x + y; }, tensor, scalar);
+}
+
+template <std::floating_point T, auto N, Arithmetic Scalar>
+constexpr auto operator+(Scalar scalar, const SimdVector<T, N> &tensor) {
+  return simd_map<T, N>([](auto x, auto y) { return x + y; }, scalar, tensor);
+}
+
+template <std::floating_point T, auto N>
+constexpr auto operator-(const SimdVector<T, N> &tensor_1, const SimdVector<T, N> &tensor_2) {
+  return simd_map<T, N>([](auto x, auto y) { return x - y; }, tensor_1, tensor_2);
+}
+
+template <std::floating_point T, auto N, Arithmetic Scalar>
+constexpr auto operator-(const SimdVector<T, N> &tensor, Scalar scalar) {
+  return simd_map<T, N>([](auto x, auto y) { return x - y; }, tensor, scalar);
+}
+
+template <std::floating_point T, auto N, Arithmetic Scalar>
+constexpr auto operator-(Scalar scalar, const SimdVector<T, N> &tensor) {
+  return simd_map<T, N>([](auto x, auto y) { return x - y; }, scalar, tensor);
+}
+
+template <std::floating_point T, auto N>
+constexpr auto operator*(const SimdVector<T, N> &tensor_1, const SimdVector<T, N> &tensor_2) {
+  return simd_map<T, N>([](auto x, auto y) { return x * y; }, tensor_1, tensor_2);
+}
+
+template <std::floating_point T, auto N, Arithmetic Scalar>
+constexpr auto operator*(const SimdVector<T, N> &tensor, Scalar scalar) {
+  return simd_map<T, N>([](auto x, auto y) { return x * y; }, tensor, scalar);
+}
+
+template <std::floating_point T, auto N, Arithmetic Scalar>
+constexpr auto operator*(Scalar scalar, const SimdVector<T, N> &tensor) {
+  return simd_map<T, N>([](auto x, auto y) { return x * y; }, scalar, tensor);
+}
+
+template <std::floating_point T, auto N>
+constexpr auto operator/(const SimdVector<T, N> &tensor_1, const SimdVector<T, N> &tensor_2) {
+  return simd_map<T, N>([](auto x, auto y) { return x / y; }, tensor_1, tensor_2);
+}
+
+template <std::floating_point T, auto N, Arithmetic Scalar>
+constexpr auto operator/(const SimdVector<T, N> &tensor, Scalar scalar) {
+  return simd_map<T, N>([](auto x, auto y) { return x / y; }, tensor, scalar);
+}
+
+template <std::floating_point T, auto N, Arithmetic Scalar>
+constexpr auto operator/(Scalar scalar, const SimdVector<T, N> &tensor) {
+  return simd_map<T, N>([](auto x, auto y) { return x / y; }, scalar, tensor);
+}
+
+// ================================================================
+// dot
+
+template <std::floating_point T, auto N>
+constexpr auto dot(const SimdVector<T, N> &tensor_1, const SimdVector<T, N> &tensor_2) -> T {
+  if (std::is_constant_evaluated()) {
+    return std::transform_reduce(std::begin(tensor_1), std::end(tensor_1), std::begin(tensor_2), T(0));
+  } else {
+    return std::experimental::reduce(simd_load(tensor_1) * simd_load(tensor_2));
+  }
+}
+
+// ================================================================
+// cross
+
+template <std::floating_point T, auto N>
+constexpr auto cross(const SimdVector<T, N> &tensor_1, const SimdVector<T, N> &tensor_2) -> SimdVector<T, N>
+  requires(N == 3)
+{
+  if (std::is_constant_evaluated()) {
+    auto [x1, y1, z1] = tensor_1;
+    auto [x2, y2, z2] = tensor_2;
+    return {y1 * z2 - z1 * y2, z1 * x2 - x1 * z2, x1 * y2 - y1 * x2};
+  } else {
+    // rotate the lanes as (x, y, z) -> (y, z, x) and (x, y, z) -> (z, x, y), leaving the padding lane at zero
+    auto rotated = [](const auto &tensor, auto shift) {
+      return SimdPack<T, N>([&](auto lane) { return lane < N ? tensor[(lane + shift) % N] : T(0); });
+    };
+    auto pack = rotated(tensor_1, 1) * rotated(tensor_2, 2) - rotated(tensor_1, 2) * rotated(tensor_2, 1);
+    SimdVector<T, N> result{};
+    pack.copy_to(result.data(), std::experimental::element_aligned);
+    return result;
+  }
+}
+
+// ================================================================
+// norm
+
+template <std::floating_point T, auto N>
+constexpr auto normalized(const SimdVector<T, N> &tensor) {
+  return tensor * (T(1) / pbpt::math::sqrt(dot(tensor, tensor)));
+}
+
+// ================================================================
+// elemwise
+
+// The function is applied lane by lane over aligned, fixed-length storage so that the compiler can vectorize it.
+template <typename Function, typename Tensor>
+constexpr auto elemwise(Function &&function, Tensor &&tensor)
+  requires SimdVectorShaped<std::decay_t<Tensor>>
+{
+  std::decay_t<Tensor> result{};
+  for (std::size_t index = 0; index < dimension_v<std::decay_t<Tensor>, 0>; ++index) {
+    result[index] = function(tensor[index]);
+  }
+  return result;
+}
+
+}  // namespace pbpt::tensor
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <algorithm>
 #include <array>
 #include <numeric>
 #include <vector>
@@ -99,11 +100,23 @@ constexpr const element_t<GenericTensor<Array, T, Ns...>, 0> &&get(const Generic
   return std::move(tensor[I]);
 };
 
+// ================================================================
+// lazy
+
+template <typename T>
+struct is_lazy : std::false_type {};
+
+template <typename T>
+inline constexpr auto is_lazy_v = is_lazy<T>::value;
+
 // ================================================================
 // concept
 
 template <typename T>
-concept ScalarShaped = (rank_v<T> == 0);
+concept LazyShaped = is_lazy_v<T>;
+
+template <typename T>
+concept ScalarShaped = (rank_v<T> == 0) && !LazyShaped<T>;
 
 template <typename T>
 concept VectorShaped = (rank_v<T> == 1);
@@ -240,6 +253,16 @@ constexpr auto prod(const Tensor &tensor) {
   );
 }
 
+template <TensorShaped Tensor>
+constexpr auto max(const Tensor &tensor) {
+  return *std::max_element(std::begin(tensor), std::end(tensor));
+}
+
+template <TensorShaped Tensor>
+constexpr auto min(const Tensor &tensor) {
+  return *std::min_element(std::begin(tensor), std::end(tensor));
+}
+
 template <TensorShaped Tensor1, TensorShaped Tensor2>
 constexpr auto dot(const Tensor1 &tensor_1, const Tensor2 &tensor_2)
   requires Broadcastable<Tensor1, Tensor2>
@@ -275,6 +298,20 @@ constexpr auto transposed(const Tensor &tensor)
   }(std::make_index_sequence<dimension_v<Tensor, 1>>{});
 }
 
+// ================================================================
+// cast
+
+template <typename U, template <typename, auto> typename Array, typename T, auto... Ns>
+constexpr auto cast(const GenericTensor<Array, T, Ns...> &tensor) -> GenericTensor<Array, U, Ns...> {
+  return [&]<auto... Is>(std::index_sequence<Is...>) constexpr -> GenericTensor<Array, U, Ns...> {
+    if constexpr (sizeof...(Ns) > 1) {
+      return {cast<U>(get<Is>(tensor))...};
+    } else {
+      return {static_cast<U>(get<Is>(tensor))...};
+    }
+  }(std::make_index_sequence<dimension_v<GenericTensor<Array, T, Ns...>, 0>>{});
+}
+
 // ================================================================
 // norm
 
@@ -7,18 +7,23 @@
 #include <boost/progress.hpp>
 #include <boost/serialization/array.hpp>
 #include <boost/serialization/vector.hpp>
+#include <cstdint>
 #include <execution>
 #include <filesystem>
 #include <functional>
 #include <iostream>
+#include <map>
+#include <optional>
 #include <random>
 #include <ranges>
+#include <set>
 #include <string>
 #include <thread>
 
 #include "image.hpp"
 #include "math.hpp"
 #include "renderer.hpp"
+#include "scene/lamps.hpp"
 #include "scene/weekend.hpp"
 #include "tensor.hpp"
 
@@ -30,8 +35,42 @@ int main(int argc, char** argv) {
   options_description.add_options()("image_width,W", boost::program_options::value<int>()->default_value(1000), "Image width")(
       "image_height,H", boost::program_options::value<int>()->default_value(1000), "Image height")(
       "num_samples,N", boost::program_options::value<int>()->default_value(1000), "Number of samples per pixel for Monte-Carlo")(
-      "bernoulli_p,P", boost::program_options::value<float>()->default_value(0.99), "Continuation probability for Russian roulette")(
+      "bernoulli_p,P", boost::program_options::value<float>()->default_value(0.99), "Maximum continuation probability for Russian roulette")(
+      "roulette_depth,D", boost::program_options::value<int>()->default_value(3), "Number of bounces before Russian roulette starts")(
+      "max_splits,M", boost::program_options::value<int>()->default_value(1), "Maximum number of paths split from a high-throughput path")(
+      "diffuse_splits,K", boost::program_options::value<int>()->default_value(1), "Number of paths the path integrator splits into at the first vertex with a BRDF (path without interleaving, and mlt)")(
+      "adaptive_error,E", boost::program_options::value<float>()->default_value(0.0), "Target relative error for adaptive sampling (0 disables it)")(
+      "min_samples", boost::program_options::value<int>()->default_value(64), "Minimum number of samples per pixel for adaptive sampling")(
+      "max_samples", boost::program_options::value<int>()->default_value(65536), "Maximum number of samples per pixel for adaptive sampling")(
+      "snapshot_interval", boost::program_options::value<int>()->default_value(64), "Number of passes between snapshots written to outputs/ (0 writes only the final image)")(
       "random_seed,S", boost::program_options::value<int>()->default_value(0), "Random seed for Monte-Carlo sampling")(
+      "integrator,I", boost::program_options::value<std::string>()->default_value("path"), "Integrator: path, ao, albedo, normal, depth, direct, restir, bdpt, photon, guided, mlt or cached")(
+      "occlusion_distance", boost::program_options::value<float>()->default_value(1.0), "Distance beyond which nothing occludes in the ao integrator")(
+      "max_distance", boost::program_options::value<float>()->default_value(20.0), "Distance mapped to black by the depth integrator")(
+      "interleaved_paths", boost::program_options::value<int>()->default_value(0), "Number of paths each thread interleaves in the path integrator (0 traces one at a time)")(
+      "sort_rays", boost::program_options::value<bool>()->default_value(false), "Sort the interleaved paths by origin cell and direction octant when it pays off")(
+      "sort_cell_size", boost::program_options::value<float>()->default_value(1.0), "Edge length of the origin cells used to sort rays")(
+      "restir_candidates", boost::program_options::value<int>()->default_value(32), "Number of candidate light samples per pixel in the restir integrator")(
+      "restir_neighbors", boost::program_options::value<int>()->default_value(4), "Number of neighboring reservoirs each pixel reuses in the restir integrator")(
+      "restir_radius", boost::program_options::value<float>()->default_value(10.0), "Radius in pixels within which the restir integrator picks neighbors")(
+      "bdpt_depth", boost::program_options::value<int>()->default_value(8), "Maximum number of bounces of the paths joined by the bdpt integrator")(
+      "photons", boost::program_options::value<int>()->default_value(100000), "Number of photons emitted per pass by the photon integrator")(
+      "photon_radius", boost::program_options::value<float>()->default_value(0.1), "Radius within which the photon integrator gathers photons in the first pass")(
+      "photon_alpha", boost::program_options::value<float>()->default_value(0.7), "Fraction of the photons kept as the radius shrinks from pass to pass")(
+      "guiding_iterations", boost::program_options::value<int>()->default_value(6), "Number of iterations the guided integrator learns incident radiance for, the k-th lasting 2^k passes")(
+      "guiding_extent", boost::program_options::value<float>()->default_value(32.0), "Half width of the cube around the camera that the guided integrator subdivides")(
+      "mlt_bootstrap", boost::program_options::value<int>()->default_value(100000), "Number of paths per pass the mlt integrator estimates the image brightness from and starts its chains at")(
+      "mlt_chains", boost::program_options::value<int>()->default_value(1000), "Number of Markov chains per pass of the mlt integrator, which mutate one path per pixel in all")(
+      "mlt_sigma", boost::program_options::value<float>()->default_value(0.01), "Standard deviation of the small-step mutations of the mlt integrator")(
+      "mlt_large_step", boost::program_options::value<float>()->default_value(0.3), "Probability of a large-step mutation in the mlt integrator")(
+      "cache_cell_size", boost::program_options::value<float>()->default_value(0.1), "Width of the cells the cached integrator averages radiance over")(
+      "cache_entries", boost::program_options::value<int>()->default_value(1 << 20), "Number of cells the cached integrator has room for")(
+      "cache_depth", boost::program_options::value<int>()->default_value(2), "Number of bounces after which paths of the cached integrator end in the cache")(
+      "cache_spread", boost::program_options::value<float>()->default_value(1.0), "Spread in cells beyond which paths of the cached integrator end in the cache (0 disables it)")(
+      "cache_persist", boost::program_options::value<bool>()->default_value(true), "Keep the radiance cache of the cached integrator from pass to pass")(
+      "scene", boost::program_options::value<std::string>()->default_value("weekend"), "Scene: weekend, lit by the sky, or lamps, lit by emitters alone")(
+      "environment", boost::program_options::value<std::string>()->default_value(""), "Latitude-longitude PFM image lighting the scene in place of the sky (path without interleaving and mlt only)")(
+      "mis", boost::program_options::value<std::string>()->default_value("power"), "Heuristic combining light and material sampling: none, balance or power")(
       "num_threads,T", boost::program_options::value<int>()->default_value(1), "Number of threads for OpenMP")("help,h", "Shows help");
 
   boost::program_options::variables_map variables_map;
@@ -47,10 +86,93 @@ int main(int argc, char** argv) {
 
   auto image_width = variables_map["image_width"].as<int>();
   auto image_height = variables_map["image_height"].as<int>();
-  auto num_samples = variables_map["num_samples"].as<int>();
+  // sample counts are kept in the type the accumulation buffer counts with
+  using SampleCount = std::uint32_t;
+  auto num_samples = SampleCount(std::max(variables_map["num_samples"].as<int>(), 0));
   auto bernoulli_p = variables_map["bernoulli_p"].as<float>();
+  auto roulette_depth = variables_map["roulette_depth"].as<int>();
+  auto max_splits = variables_map["max_splits"].as<int>();
+  auto diffuse_splits = std::max(variables_map["diffuse_splits"].as<int>(), 1);
+  auto adaptive_error = variables_map["adaptive_error"].as<float>();
+  auto min_samples = SampleCount(std::max(variables_map["min_samples"].as<int>(), 2));
+  auto max_samples = std::max(SampleCount(std::max(variables_map["max_samples"].as<int>(), 0)), min_samples);
+  auto snapshot_interval = std::max(variables_map["snapshot_interval"].as<int>(), 0);
   auto random_seed = variables_map["random_seed"].as<int>();
   auto num_threads = variables_map["num_threads"].as<int>();
+  auto integrator = variables_map["integrator"].as<std::string>();
+  auto occlusion_distance = variables_map["occlusion_distance"].as<float>();
+  auto max_distance = variables_map["max_distance"].as<float>();
+  auto interleaved_paths = variables_map["interleaved_paths"].as<int>();
+  auto sort_rays = variables_map["sort_rays"].as<bool>();
+  auto sort_cell_size = variables_map["sort_cell_size"].as<float>();
+  auto mis = variables_map["mis"].as<std::string>();
+  auto restir_candidates = std::max(variables_map["restir_candidates"].as<int>(), 1);
+  auto restir_neighbors = std::max(variables_map["restir_neighbors"].as<int>(), 0);
+  auto restir_radius = variables_map["restir_radius"].as<float>();
+  auto bdpt_depth = std::max(variables_map["bdpt_depth"].as<int>(), 0);
+  auto photons = std::max(variables_map["photons"].as<int>(), 0);
+  auto photon_radius = variables_map["photon_radius"].as<float>();
+  auto photon_alpha = variables_map["photon_alpha"].as<float>();
+  auto guiding_iterations = std::max(variables_map["guiding_iterations"].as<int>(), 0);
+  auto guiding_extent = variables_map["guiding_extent"].as<float>();
+  auto mlt_bootstrap = std::max(variables_map["mlt_bootstrap"].as<int>(), 1);
+  auto mlt_chains = std::max(variables_map["mlt_chains"].as<int>(), 1);
+  auto mlt_sigma = variables_map["mlt_sigma"].as<float>();
+  auto mlt_large_step = variables_map["mlt_large_step"].as<float>();
+  auto cache_cell_size = variables_map["cache_cell_size"].as<float>();
+  auto cache_entries = std::max(variables_map["cache_entries"].as<int>(), 1);
+  auto cache_depth = std::max(variables_map["cache_depth"].as<int>(), 1);
+  auto cache_spread = std::max(variables_map["cache_spread"].as<float>(), 0.0f);
+  auto cache_persist = variables_map["cache_persist"].as<bool>();
+  auto scene = variables_map["scene"].as<std::string>();
+  auto environment_file = variables_map["environment"].as<std::string>();
+
+  if (!std::set<std::string>{"path", "ao", "albedo", "normal", "depth", "direct", "restir", "bdpt", "photon", "guided", "mlt", "cached"}.contains(integrator)) {
+    if (!communicator.rank()) std::cerr << "Unknown integrator: " << integrator << std::endl;
+    std::exit(EXIT_FAILURE);
+  }
+
+  // the termination policy counts in std::size_t, where negative values would wrap around
+  if (roulette_depth < 0) {
+    if (!communicator.rank()) std::cerr << "Negative roulette depth: " << roulette_depth << std::endl;
+    std::exit(EXIT_FAILURE);
+  }
+  if (max_splits < 1) {
+    if (!communicator.rank()) std::cerr << "Non-positive maximum number of splits: " << max_splits << std::endl;
+    std::exit(EXIT_FAILURE);
+  }
+
+  if (!std::set<std::string>{"weekend", "lamps"}.contains(scene)) {
+    if (!communicator.rank()) std::cerr << "Unknown scene: " << scene << std::endl;
+    std::exit(EXIT_FAILURE);
+  }
+
+  auto heuristics = std::map<std::string, pbpt::renderer::Heuristic>{
+      {"none", pbpt::renderer::Heuristic::none},
+      {"balance", pbpt::renderer::Heuristic::balance},
+      {"power", pbpt::renderer::Heuristic::power},
+  };
+  if (!heuristics.contains(mis)) {
+    if (!communicator.rank()) std::cerr << "Unknown heuristic: " << mis << std::endl;
+    std::exit(EXIT_FAILURE);
+  }
+
+  // only the recursive path integrator, which mlt also runs, splits at the first diffuse vertex
+  if (diffuse_splits > 1 && !((integrator == "path" && interleaved_paths <= 0) || integrator == "mlt")) {
+    if (!communicator.rank()) {
+      std::cerr << "--diffuse_splits is supported by -I path without --interleaved_paths and by -I mlt only"
+                << std::endl;
+    }
+    std::exit(EXIT_FAILURE);
+  }
+
+  // only the recursive path integrator, which mlt also runs, samples the environment map at every vertex
+  if (!environment_file.empty() && !((integrator == "path" && interleaved_paths <= 0) || integrator == "mlt")) {
+    if (!communicator.rank()) {
+      std::cerr << "--environment is supported by -I path without --interleaved_paths and by -I mlt only" << std::endl;
+    }
+    std::exit(EXIT_FAILURE);
+  }
 
   omp_set_num_threads(num_threads);
 
@@ -79,6 +201,30 @@ int main(int argc, char** argv) {
 
   auto num_total_pixels = image_width * image_height;
 
+  pbpt::renderer::AdaptiveRoulette<Scalar> termination_policy(
+      std::size_t(roulette_depth), bernoulli_p, std::size_t(max_splits)
+  );
+  pbpt::renderer::RaySorter<Scalar> ray_sorter(sort_rays, sort_cell_size);
+  pbpt::renderer::RadianceCache<Scalar> radiance_cache(
+      Scalar(cache_cell_size), integrator == "cached" ? std::size_t(cache_entries) : 1
+  );
+  // y points down in the scenes, so the zenith of the map turns to -y
+  std::optional<pbpt::renderer::EnvironmentMap<Scalar>> environment_map;
+  if (!environment_file.empty()) {
+    auto [environment_colors, environment_width, environment_height] =
+        pbpt::image::read_pfm<Scalar>(environment_file);
+    if (environment_colors.empty()) {
+      if (!communicator.rank()) std::cerr << "Unreadable environment map: " << environment_file << std::endl;
+      std::exit(EXIT_FAILURE);
+    }
+    pbpt::tensor::Matrix<Scalar, 3, 3> environment_rotation{
+        pbpt::tensor::Vector<Scalar, 3>{1, 0, 0},
+        pbpt::tensor::Vector<Scalar, 3>{0, -1, 0},
+        pbpt::tensor::Vector<Scalar, 3>{0, 0, -1},
+    };
+    environment_map.emplace(std::move(environment_colors), environment_width, environment_height, environment_rotation);
+  }
+
   auto num_split_pixels = num_total_pixels / communicator.size();
   auto num_extra_pixels = num_total_pixels % communicator.size();
 
@@ -89,59 +235,221 @@ int main(int argc, char** argv) {
 
   auto stop_index = start_index + num_split_pixels;
 
-  auto image = [&]() {
-    std::vector<std::array<Scalar, 3>> colors(num_split_pixels);
-    std::vector<std::size_t> rendered_samples(num_split_pixels);
+  // the scenes differ in type, so each renders through its own instantiation
+  auto render = [&](const auto &object, const auto &materials, const auto &camera, const auto &sky) {
+    auto guiding_offset = pbpt::tensor::Vector<Scalar, 3>{guiding_extent, guiding_extent, guiding_extent};
+    pbpt::renderer::PathGuide<Scalar> guide(
+        pbpt::tensor::evaluate(camera.position() - guiding_offset),
+        pbpt::tensor::evaluate(camera.position() + guiding_offset), std::size_t(guiding_iterations)
+    );
+    auto lights = pbpt::renderer::make_lights<Scalar>(object, materials, heuristics.at(mis));
+
+    pbpt::image::AccumulationBuffer<float, pbpt::tensor::Vector, false, true> accumulation_buffer(num_split_pixels);
+    std::vector<bool> active_pixels(num_split_pixels);
 
     auto image_writer = [&](auto global_index, const auto& color) constexpr {
-      using namespace std::placeholders;
-      auto local_index = global_index - start_index;
-      auto cur_color =
-          pbpt::tensor::elemwise(std::bind(pbpt::math::clamp<Scalar, Scalar, Scalar>, _1, 0.0, 1.0), color);
-      auto old_color =
-          pbpt::tensor::elemwise(pbpt::math::square<Scalar>, pbpt::tensor::Vector<Scalar, 3>(colors[local_index]));
-      auto new_color = pbpt::tensor::elemwise(
-          pbpt::math::sqrt<Scalar>,
-          (old_color * rendered_samples[local_index] + cur_color) / (rendered_samples[local_index] + 1)
-      );
-      colors[local_index] = new_color;
-      ++rendered_samples[local_index];
+      accumulation_buffer.add(global_index - start_index, color);
+    };
+
+    // standard error of the pixel mean relative to the mean itself (floored at one 8-bit quantization step)
+    auto pixel_error = [&](auto local_index) constexpr {
+      auto mean = accumulation_buffer.mean(local_index);
+      auto variance = accumulation_buffer.variance(local_index);
+      auto error = pbpt::tensor::elemwise(pbpt::math::sqrt<float>, variance / accumulation_buffer.count(local_index)) /
+                   pbpt::tensor::elemwise([](auto x) constexpr { return std::max(x, 1.0f / 255.0f); }, mean);
+      return pbpt::tensor::max(error);
     };
 
+    auto pixel_selector = [&](auto global_index) constexpr { return bool(active_pixels[global_index - start_index]); };
+
     if (communicator.rank()) std::cout.setstate(std::ios_base::badbit);
 
+    // adaptive sampling redistributes the same budget from converged pixels to noisy ones
+    std::size_t sample_budget = std::size_t(num_samples) * num_split_pixels;
+    std::size_t used_samples = 0;
+
     boost::progress_timer progress_timer;
-    boost::progress_display progress_display(num_samples);
+    boost::progress_display progress_display(sample_budget);
+
+    for (auto sample_index = 0;; ++sample_index) {
+      std::size_t num_active_pixels = 0;
+      for (auto local_index = 0; local_index < num_split_pixels; ++local_index) {
+        auto num_rendered_samples = accumulation_buffer.count(local_index);
+        active_pixels[local_index] =
+            adaptive_error > 0 ? num_rendered_samples < min_samples ||
+                                     (num_rendered_samples < max_samples && pixel_error(local_index) > adaptive_error)
+                               : num_rendered_samples < num_samples;
+        num_active_pixels += active_pixels[local_index];
+      }
+
+      auto continued = num_active_pixels && used_samples < sample_budget;
+      if (!boost::mpi::all_reduce(communicator, continued, std::logical_or<bool>())) break;
+
+      if (!continued) {
+        std::fill(std::begin(active_pixels), std::end(active_pixels), false);
+        num_active_pixels = 0;
+      }
+      used_samples += num_active_pixels;
 
-    for (auto sample_index = 0; sample_index < num_samples; ++sample_index) {
       auto sample_seed = random_seed + num_total_pixels * sample_index;
-      pbpt::renderer::path_tracer<Scalar, pbpt::tensor::Vector, std::mt19937>(
-          pbpt::scene::weekend::object, pbpt::scene::weekend::camera, pbpt::scene::weekend::background, image_width,
-          image_height, start_index, stop_index, bernoulli_p, sample_seed, image_writer
-      );
+      // the environment map, which only the path and mlt integrators accept, replaces the sky when there is one
+      auto dispatch = [&](const auto &background) {
+        if (integrator == "ao") {
+          pbpt::renderer::ambient_occlusion<Scalar, pbpt::tensor::Vector, std::mt19937>(
+              object, camera, Scalar(occlusion_distance), image_width, image_height, start_index, stop_index,
+              sample_seed, pixel_selector, image_writer
+          );
+        } else if (integrator == "albedo") {
+          pbpt::renderer::albedo_preview<Scalar, pbpt::tensor::Vector, std::mt19937>(
+              object, materials, camera, image_width, image_height, start_index, stop_index, sample_seed,
+              pixel_selector, image_writer
+          );
+        } else if (integrator == "normal") {
+          pbpt::renderer::normal_preview<Scalar, pbpt::tensor::Vector, std::mt19937>(
+              object, camera, image_width, image_height, start_index, stop_index, sample_seed, pixel_selector,
+              image_writer
+          );
+        } else if (integrator == "depth") {
+          pbpt::renderer::depth_preview<Scalar, pbpt::tensor::Vector, std::mt19937>(
+              object, camera, Scalar(max_distance), image_width, image_height, start_index, stop_index, sample_seed,
+              pixel_selector, image_writer
+          );
+        } else if (integrator == "direct") {
+          pbpt::renderer::direct_lighting<Scalar, pbpt::tensor::Vector, std::mt19937>(
+              object, materials, lights, camera, background, image_width, image_height, start_index, stop_index,
+              sample_seed, pixel_selector, image_writer
+          );
+        } else if (integrator == "restir") {
+          pbpt::renderer::restir_direct_lighting<Scalar, pbpt::tensor::Vector, std::mt19937>(
+              object, materials, lights, camera, background, image_width, image_height, start_index, stop_index,
+              restir_candidates, restir_neighbors, Scalar(restir_radius), sample_seed, pixel_selector, image_writer
+          );
+        } else if (integrator == "bdpt") {
+          pbpt::renderer::bidirectional_path_tracer<Scalar, pbpt::tensor::Vector, std::mt19937>(
+              object, materials, lights, camera, background, image_width, image_height, start_index, stop_index,
+              std::size_t(bdpt_depth), sample_seed, pixel_selector, image_writer
+          );
+        } else if (integrator == "photon") {
+          auto radius = pbpt::renderer::progressive_radius(Scalar(photon_radius), Scalar(photon_alpha), sample_index);
+          pbpt::renderer::photon_mapping<Scalar, pbpt::tensor::Vector, std::mt19937>(
+              object, materials, lights, camera, background, image_width, image_height, start_index, stop_index,
+              termination_policy, std::size_t(photons), radius, sample_seed, pixel_selector, image_writer
+          );
+        } else if (integrator == "guided") {
+          pbpt::renderer::guided_path_tracer<Scalar, pbpt::tensor::Vector, std::mt19937>(
+              object, materials, lights, camera, background, image_width, image_height, start_index, stop_index,
+              termination_policy, guide, sample_seed, pixel_selector, image_writer
+          );
+        } else if (integrator == "mlt") {
+          auto path_integrator = pbpt::renderer::path_integrator<Scalar>(
+              object, materials, lights, background, termination_policy, std::size_t(diffuse_splits)
+          );
+          pbpt::renderer::metropolis_light_transport<Scalar, pbpt::tensor::Vector, std::mt19937>(
+              camera, image_width, image_height, start_index, stop_index, std::size_t(mlt_bootstrap),
+              std::size_t(mlt_chains), Scalar(mlt_sigma), Scalar(mlt_large_step), sample_seed, pixel_selector,
+              image_writer, path_integrator
+          );
+        } else if (integrator == "cached") {
+          if (!cache_persist) radiance_cache.clear();
+          pbpt::renderer::cached_path_tracer<Scalar, pbpt::tensor::Vector, std::mt19937>(
+              object, materials, lights, camera, background, image_width, image_height, start_index, stop_index,
+              termination_policy, radiance_cache, std::size_t(cache_depth), Scalar(cache_spread), sample_seed,
+              pixel_selector, image_writer
+          );
+        } else if (interleaved_paths > 0) {
+          pbpt::renderer::interleaved_path_tracer<Scalar, pbpt::tensor::Vector, std::mt19937>(
+              object, materials, lights, camera, background, image_width, image_height, start_index, stop_index,
+              termination_policy, interleaved_paths, ray_sorter, sample_seed, pixel_selector, image_writer
+          );
+        } else {
+          pbpt::renderer::path_tracer<Scalar, pbpt::tensor::Vector, std::mt19937>(
+              object, materials, lights, camera, background, image_width, image_height, start_index, stop_index,
+              termination_policy, std::size_t(diffuse_splits), sample_seed, pixel_selector, image_writer
+          );
+        }
+      };
+      if (environment_map) {
+        dispatch(environment_map.value());
+      } else {
+        dispatch(sky);
+      }
 
       communicator.barrier();
 
-      std::vector<decltype(colors)> gathered_colors;
-      if (!communicator.rank()) gathered_colors.resize(communicator.size());
+      // snapshots cost a resolve, a gather and a write, so they are taken every few passes only
+      if (snapshot_interval && (sample_index + 1) % snapshot_interval == 0) {
+        auto colors = accumulation_buffer.resolve(pbpt::image::gamma_correction<pbpt::tensor::Vector<float, 3>>);
 
-      boost::mpi::gather(communicator, colors, gathered_colors, 0);
+        std::vector<decltype(colors)> gathered_colors;
+        if (!communicator.rank()) gathered_colors.resize(communicator.size());
 
-      if (!communicator.rank()) {
-        auto image = gathered_colors | std::views::join;
-        using namespace std::literals::string_literals;
-        std::filesystem::path filename = "outputs/"s + std::to_string(sample_index) + ".ppm"s;
-        std::filesystem::create_directories(filename.parent_path());
-        pbpt::image::write_ppm(filename, image, image_width, image_height);
+        boost::mpi::gather(communicator, colors, gathered_colors, 0);
+
+        if (!communicator.rank()) {
+          auto image = gathered_colors | std::views::join;
+          using namespace std::literals::string_literals;
+          std::filesystem::path filename = "outputs/"s + std::to_string(sample_index) + ".ppm"s;
+          std::filesystem::create_directories(filename.parent_path());
+          pbpt::image::write_ppm(filename, image, image_width, image_height);
+        }
       }
 
-      ++progress_display;
+      progress_display += std::min(num_active_pixels, progress_display.expected_count() - progress_display.count());
     }
 
-    return colors;
-  }();
+    std::size_t num_dropped = 0;
+    boost::mpi::reduce(communicator, accumulation_buffer.num_dropped(), num_dropped, std::plus<std::size_t>(), 0);
+    if (!communicator.rank() && num_dropped) std::cerr << "Dropped non-finite samples: " << num_dropped << std::endl;
+
+    std::vector<std::decay_t<decltype(accumulation_buffer.counts())>> gathered_samples;
+    if (!communicator.rank()) gathered_samples.resize(communicator.size());
+
+    boost::mpi::gather(communicator, accumulation_buffer.counts(), gathered_samples, 0);
 
-  std::filesystem::path filename = "outputs/image.ppm";
-  std::filesystem::create_directories(filename.parent_path());
-  pbpt::image::write_ppm(filename, image, image_width, image_height);
+    if (!communicator.rank()) {
+      auto samples = gathered_samples | std::views::join;
+      auto max_rendered_samples = std::ranges::max(samples);
+      std::vector<std::array<float, 3>> sample_map;
+      for (auto num_rendered_samples : samples) {
+        auto intensity = max_rendered_samples ? float(num_rendered_samples) / max_rendered_samples : 0.0f;
+        sample_map.push_back({intensity, intensity, intensity});
+      }
+      std::filesystem::path filename = "outputs/samples.ppm";
+      std::filesystem::create_directories(filename.parent_path());
+      pbpt::image::write_ppm(filename, sample_map, image_width, image_height);
+    }
+
+    // every rank resolves its own pixels for the final image, which only the root holds, still linear
+    auto colors = accumulation_buffer.resolve([](const auto& color) { return color; });
+
+    std::vector<decltype(colors)> gathered_colors;
+    if (!communicator.rank()) gathered_colors.resize(communicator.size());
+
+    boost::mpi::gather(communicator, colors, gathered_colors, 0);
+
+    decltype(colors) image;
+    for (const auto& rank_colors : gathered_colors) {
+      image.insert(std::end(image), std::begin(rank_colors), std::end(rank_colors));
+    }
+    return image;
+  };
+  auto image = scene == "lamps" ? render(
+                                      pbpt::scene::lamps::object, pbpt::scene::lamps::materials,
+                                      pbpt::scene::lamps::camera, pbpt::scene::lamps::background
+                                  )
+                                : render(
+                                      pbpt::scene::weekend::object, pbpt::scene::weekend::materials,
+                                      pbpt::scene::weekend::camera, pbpt::scene::weekend::background
+                                  );
+
+  if (!communicator.rank()) {
+    // the linear mean, unclamped, so that the integrators can be compared on it
+    std::filesystem::path filename = "outputs/image.pfm";
+    std::filesystem::create_directories(filename.parent_path());
+    pbpt::image::write_pfm(filename, image, image_width, image_height);
+
+    for (auto& color : image) color = pbpt::image::gamma_correction(pbpt::tensor::Vector<float, 3>(color));
+    filename = "outputs/image.ppm";
+    pbpt::image::write_ppm(filename, image, image_width, image_height);
+  }
 }
@@ -0,0 +1,157 @@
+#pragma once
+
+#include <numbers>
+#include <tuple>
+
+#include "geometry.hpp"
+#include "material.hpp"
+#include "math.hpp"
+#include "optics.hpp"
+#include "random.hpp"
+#include "tensor.hpp"
+
+#ifdef PBPT_SINGLE_PRECISION
+using Scalar = float;
+#else
+using Scalar = double;
+#endif
+
+namespace pbpt::scene::lamps {
+
+// the weekend layout lit only by emitters, under a black sky:
+// an area light above the spheres, whose glass one casts a caustic, and a ring of small lamps of unequal power
+inline constexpr auto scene = []() constexpr {
+  pbpt::random::LinearCongruentialGenerator<> generator(__LINE__);
+  pbpt::material::MaterialTable<Scalar, pbpt::tensor::Vector, 2, 1, 1, 25> materials;
+  auto make_sphere = [](auto &&...args) constexpr {
+    return pbpt::geometry::primitive::make_ellipsoid<Scalar, pbpt::tensor::Vector, pbpt::material::MaterialIndex>(
+        std::forward<decltype(args)>(args)...
+    );
+  };
+  // the plane is lit from -y (up), so it is turned over to face the floor
+  auto panel = pbpt::geometry::transform::make_rotation<Scalar>(
+      pbpt::geometry::primitive::Plane<Scalar, pbpt::tensor::Vector, pbpt::material::MaterialIndex>(
+          pbpt::tensor::Vector<Scalar, 2>{0.75, 0.75},
+          materials.add(pbpt::material::Emissive<Scalar>(pbpt::tensor::Vector<Scalar, 3>{8.0, 7.0, 6.0}))
+      ),
+      pbpt::tensor::Matrix<Scalar, 3, 3>{
+          pbpt::tensor::Vector<Scalar, 3>{1.0, 0.0, 0.0},
+          pbpt::tensor::Vector<Scalar, 3>{0.0, -1.0, 0.0},
+          pbpt::tensor::Vector<Scalar, 3>{0.0, 0.0, -1.0},
+      }
+  );
+  auto object = pbpt::geometry::csg::make_union(
+      // ground sphere
+      pbpt::geometry::transform::make_translation<Scalar>(
+          make_sphere(
+              pbpt::tensor::Vector<Scalar, 3>{1000.0, 1000.0, 1000.0},
+              materials.add(pbpt::material::Lambertian<Scalar>(pbpt::tensor::Vector<Scalar, 3>{0.5, 0.5, 0.5}))
+          ),
+          pbpt::tensor::Vector<Scalar, 3>{0.0, 1000.0, 0.0}
+      ),
+      pbpt::geometry::csg::make_union(
+          // left sphere (diffuse)
+          pbpt::geometry::transform::make_translation<Scalar>(
+              make_sphere(
+                  pbpt::tensor::Vector<Scalar, 3>{1.0, 1.0, 1.0},
+                  materials.add(pbpt::material::Lambertian<Scalar>(pbpt::tensor::Vector<Scalar, 3>{0.7, 0.3, 0.2}))
+              ),
+              pbpt::tensor::Vector<Scalar, 3>{-4.0, -1.0, 0.0}
+          ),
+          pbpt::geometry::csg::make_union(
+              // center sphere (glass)
+              pbpt::geometry::transform::make_translation<Scalar>(
+                  make_sphere(
+                      pbpt::tensor::Vector<Scalar, 3>{1.0, 1.0, 1.0},
+                      materials.add(pbpt::material::Dielectric<Scalar>(1.5))
+                  ),
+                  pbpt::tensor::Vector<Scalar, 3>{0.0, -1.0, 0.0}
+              ),
+              pbpt::geometry::csg::make_union(
+                  // right sphere (gold)
+                  pbpt::geometry::transform::make_translation<Scalar>(
+                      make_sphere(
+                          pbpt::tensor::Vector<Scalar, 3>{1.0, 1.0, 1.0},
+                          materials.add(pbpt::material::Metal<Scalar>(pbpt::tensor::Vector<std::complex<Scalar>, 3>{
+                              std::complex<Scalar>(0.18299, 3.42420),
+                              std::complex<Scalar>(0.42108, 2.34590),
+                              std::complex<Scalar>(1.37340, 1.77040),
+                          }))
+                      ),
+                      pbpt::tensor::Vector<Scalar, 3>{4.0, -1.0, 0.0}
+                  ),
+                  pbpt::geometry::csg::make_union(
+                      // area light above the glass sphere
+                      pbpt::geometry::transform::make_translation<Scalar>(
+                          std::move(panel), pbpt::tensor::Vector<Scalar, 3>{0.0, -4.0, 0.0}
+                      ),
+                      // small lamp (emission only)
+                      [function =
+                           [&]<auto I, auto... Is>(auto self, std::index_sequence<I, Is...>) constexpr {
+                             auto [sin_angle, cos_angle] =
+                                 pbpt::math::ExactPolicy::sincos(2 * std::numbers::pi_v<Scalar> * I / 24);
+                             auto position = pbpt::tensor::Vector<Scalar, 3>{6 * cos_angle, -0.1, 6 * sin_angle};
+                             // powers spread over two decades, so that choosing lamps by power pays off
+                             auto power = Scalar(I % 6 ? 2 : 200);
+                             auto emission = pbpt::tensor::Vector<Scalar, 3>{
+                                 power * pbpt::random::uniform(generator, Scalar(0.5), Scalar(1)),
+                                 power * pbpt::random::uniform(generator, Scalar(0.5), Scalar(1)),
+                                 power * pbpt::random::uniform(generator, Scalar(0.5), Scalar(1))
+                             };
+                             auto sphere = pbpt::geometry::transform::make_translation<Scalar>(
+                                 make_sphere(
+                                     pbpt::tensor::Vector<Scalar, 3>{0.1, 0.1, 0.1},
+                                     materials.add(pbpt::material::Emissive<Scalar>(std::move(emission)))
+                                 ),
+                                 std::move(position)
+                             );
+
+                             if constexpr (sizeof...(Is))
+                               return pbpt::geometry::csg::make_union(
+                                   std::move(sphere), self(self, std::index_sequence<Is...>{})
+                               );
+                             else
+                               return sphere;
+                           }](auto &&...args) { return function(function, std::forward<decltype(args)>(args)...); }(
+                          std::make_index_sequence<24>{}
+                      )
+                  )
+              )
+          )
+      )
+  );
+  return std::make_tuple(std::move(object), std::move(materials));
+}();
+
+inline constexpr const auto &object = std::get<0>(scene);
+inline constexpr const auto &materials = std::get<1>(scene);
+
+inline constexpr auto camera = []() constexpr {
+  auto vertical_fov = 25.0 / 180.0 * std::numbers::pi;
+  auto aspect_ratio = 1.5;
+  auto focal_distance = 12.0;
+  auto aperture_radius = 0.0;
+  auto response_function = [](const auto &in_direction, const auto &lens_normal) {
+    auto cos_theta = pbpt::tensor::dot(in_direction, lens_normal);
+    return pbpt::math::pow<-4>(cos_theta);
+  };
+
+  pbpt::tensor::Vector<Scalar, 3> position{12.0, -4.0, -6.0};
+  pbpt::tensor::Vector<Scalar, 3> target{0.0, -1.0, 0.0};
+  pbpt::tensor::Vector<Scalar, 3> down{0.0, 1.0, 0.0};
+
+  auto w = pbpt::tensor::normalized(target - position);
+  auto u = pbpt::tensor::normalized(pbpt::tensor::cross(down, w));
+  auto v = pbpt::tensor::cross(w, u);
+  auto rotation = pbpt::tensor::transposed(pbpt::tensor::Matrix<Scalar, 3, 3>{u, v, w});
+
+  return pbpt::optics::Camera<Scalar, pbpt::tensor::Vector, pbpt::tensor::Matrix, decltype(response_function)>(
+      vertical_fov, aspect_ratio, focal_distance, aperture_radius, response_function, position, rotation
+  );
+}();
+
+inline constexpr auto background = [](const auto &ray) constexpr {
+  return pbpt::tensor::Vector<Scalar, 3>{} * ray.weight();
+};
+
+}  // namespace pbpt::scene::lamps
@@ -1,5 +1,6 @@
 
 #include <numbers>
+#include <tuple>
 
 #include "geometry.hpp"
 #include "material.hpp"
@@ -8,53 +9,69 @@
 #include "random.hpp"
 #include "tensor.hpp"
 
+#ifdef PBPT_SINGLE_PRECISION
+using Scalar = float;
+#else
 using Scalar = double;
+#endif
 
 namespace pbpt::scene::weekend {
 
-inline constexpr auto object = []() constexpr {
-  using namespace std::literals::complex_literals;
+// the materials live in a table and the primitives refer to them by id
+inline constexpr auto scene = []() constexpr {
   pbpt::random::LinearCongruentialGenerator<> generator(__LINE__);
-  return pbpt::geometry::csg::make_union(
+  // exact so that the layout does not depend on PBPT_FAST_MATH
+  auto uniform_in_unit_circle = [&]() constexpr {
+    return pbpt::random::uniform_in_unit_circle<Scalar, pbpt::tensor::Vector, pbpt::math::ExactPolicy>(generator);
+  };
+  std::complex<Scalar> imaginary_unit(0, 1);
+  pbpt::material::MaterialTable<Scalar, pbpt::tensor::Vector, 401, 102, 201> materials;
+  auto make_sphere = [](auto &&...args) constexpr {
+    return pbpt::geometry::primitive::make_ellipsoid<Scalar, pbpt::tensor::Vector, pbpt::material::MaterialIndex>(
+        std::forward<decltype(args)>(args)...
+    );
+  };
+  auto object = pbpt::geometry::csg::make_union(
       // ground sphere
-      pbpt::geometry::transform::make_translation(
-          pbpt::geometry::primitive::make_ellipsoid(
+      pbpt::geometry::transform::make_translation<Scalar>(
+          make_sphere(
               pbpt::tensor::Vector<Scalar, 3>{1000.0, 1000.0, 1000.0},
-              pbpt::material::make_lambertian(pbpt::tensor::Vector<Scalar, 3>{0.5, 0.5, 0.5})
+              materials.add(pbpt::material::Lambertian<Scalar>(pbpt::tensor::Vector<Scalar, 3>{0.5, 0.5, 0.5}))
           ),
           pbpt::tensor::Vector<Scalar, 3>{0.0, 1000.0, 0.0}
       ),
       pbpt::geometry::csg::make_union(
           // left sphere (gold)
-          pbpt::geometry::transform::make_translation(
-              pbpt::geometry::primitive::make_ellipsoid(
+          pbpt::geometry::transform::make_translation<Scalar>(
+              make_sphere(
                   pbpt::tensor::Vector<Scalar, 3>{1.0, 1.0, 1.0},
-                  pbpt::material::make_metal(pbpt::tensor::Vector<std::complex<Scalar>, 3>{
-                      0.18299 + 3.42420i,
-                      0.42108 + 2.34590i,
-                      1.37340 + 1.77040i,
-                  })
+                  materials.add(pbpt::material::Metal<Scalar>(pbpt::tensor::Vector<std::complex<Scalar>, 3>{
+                      std::complex<Scalar>(0.18299, 3.42420),
+                      std::complex<Scalar>(0.42108, 2.34590),
+                      std::complex<Scalar>(1.37340, 1.77040),
+                  }))
               ),
               pbpt::tensor::Vector<Scalar, 3>{-4.0, -1.0, 0.0}
           ),
           pbpt::geometry::csg::make_union(
               // center sphere (glass)
-              pbpt::geometry::transform::make_translation(
-                  pbpt::geometry::primitive::make_ellipsoid(
-                      pbpt::tensor::Vector<Scalar, 3>{1.0, 1.0, 1.0}, pbpt::material::make_dielectric(1.5)
+              pbpt::geometry::transform::make_translation<Scalar>(
+                  make_sphere(
+                      pbpt::tensor::Vector<Scalar, 3>{1.0, 1.0, 1.0},
+                      materials.add(pbpt::material::Dielectric<Scalar>(1.5))
                   ),
                   pbpt::tensor::Vector<Scalar, 3>{0.0, -1.0, 0.0}
               ),
               pbpt::geometry::csg::make_union(
                   // right sphere (platinum)
-                  pbpt::geometry::transform::make_translation(
-                      pbpt::geometry::primitive::make_ellipsoid(
+                  pbpt::geometry::transform::make_translation<Scalar>(
+                      make_sphere(
                           pbpt::tensor::Vector<Scalar, 3>{1.0, 1.0, 1.0},
-                          pbpt::material::make_metal(pbpt::tensor::Vector<std::complex<Scalar>, 3>{
-                              2.37570 + 4.26550i,
-                              2.08470 + 3.71530i,
-                              1.84530 + 3.13650i,
-                          })
+                          materials.add(pbpt::material::Metal<Scalar>(pbpt::tensor::Vector<std::complex<Scalar>, 3>{
+                              std::complex<Scalar>(2.37570, 4.26550),
+                              std::complex<Scalar>(2.08470, 3.71530),
+                              std::complex<Scalar>(1.84530, 3.13650),
+                          }))
                       ),
                       pbpt::tensor::Vector<Scalar, 3>{4.0, -1.0, 0.0}
                   ),
@@ -62,21 +79,20 @@ inline constexpr auto object = []() constexpr {
                       // tiny sphere (scatteing only)
                       [function =
                            [&]<auto I, auto... Is>(auto self, std::index_sequence<I, Is...>) constexpr {
-                             auto [coord_x, coord_z] =
-                                 pbpt::random::uniform_in_unit_circle<Scalar, pbpt::tensor::Vector>(generator) * 10.0;
+                             auto [coord_x, coord_z] = uniform_in_unit_circle() * Scalar(10);
                              auto position = pbpt::tensor::Vector<Scalar, 3>{coord_x, -0.2, coord_z};
                              auto reflectance = pbpt::tensor::elemwise(
                                  pbpt::math::square<Scalar>,
                                  pbpt::tensor::Vector<Scalar, 3>{
-                                     pbpt::random::uniform(generator, 0.0, 1.0),
-                                     pbpt::random::uniform(generator, 0.0, 1.0),
-                                     pbpt::random::uniform(generator, 0.0, 1.0)
+                                     pbpt::random::uniform(generator, Scalar(0), Scalar(1)),
+                                     pbpt::random::uniform(generator, Scalar(0), Scalar(1)),
+                                     pbpt::random::uniform(generator, Scalar(0), Scalar(1))
                                  }
                              );
-                             auto sphere = pbpt::geometry::transform::make_translation(
-                                 pbpt::geometry::primitive::make_ellipsoid(
+                             auto sphere = pbpt::geometry::transform::make_translation<Scalar>(
+                                 make_sphere(
                                      pbpt::tensor::Vector<Scalar, 3>{0.2, 0.2, 0.2},
-                                     pbpt::material::make_lambertian(std::move(reflectance))
+                                     materials.add(pbpt::material::Lambertian<Scalar>(std::move(reflectance)))
                                  ),
                                  std::move(position)
                              );
@@ -94,15 +110,13 @@ inline constexpr auto object = []() constexpr {
                           // tiny sphere (transmission only)
                           [function =
                                [&]<auto I, auto... Is>(auto self, std::index_sequence<I, Is...>) constexpr {
-                                 auto [coord_x, coord_z] =
-                                     pbpt::random::uniform_in_unit_circle<Scalar, pbpt::tensor::Vector>(generator) *
-                                     10.0;
+                                 auto [coord_x, coord_z] = uniform_in_unit_circle() * Scalar(10);
                                  auto position = pbpt::tensor::Vector<Scalar, 3>{coord_x, -0.2, coord_z};
-                                 auto refractive_index = pbpt::random::uniform(generator, 1.0, 2.0);
-                                 auto sphere = pbpt::geometry::transform::make_translation(
-                                     pbpt::geometry::primitive::make_ellipsoid(
+                                 auto refractive_index = pbpt::random::uniform(generator, Scalar(1), Scalar(2));
+                                 auto sphere = pbpt::geometry::transform::make_translation<Scalar>(
+                                     make_sphere(
                                          pbpt::tensor::Vector<Scalar, 3>{0.2, 0.2, 0.2},
-                                         pbpt::material::make_dielectric(refractive_index)
+                                         materials.add(pbpt::material::Dielectric<Scalar>(refractive_index))
                                      ),
                                      std::move(position)
                                  );
@@ -119,22 +133,20 @@ inline constexpr auto object = []() constexpr {
                           // tiny sphere (reflection only)
                           [function =
                                [&]<auto I, auto... Is>(auto self, std::index_sequence<I, Is...>) constexpr {
-                                 auto [coord_x, coord_z] =
-                                     pbpt::random::uniform_in_unit_circle<Scalar, pbpt::tensor::Vector>(generator) *
-                                     10.0;
+                                 auto [coord_x, coord_z] = uniform_in_unit_circle() * Scalar(10);
                                  auto position = pbpt::tensor::Vector<Scalar, 3>{coord_x, -0.2, coord_z};
                                  pbpt::tensor::Vector<std::complex<Scalar>, 3> refractive_index{
-                                     pbpt::random::uniform(generator, 0.0, 5.0) +
-                                         pbpt::random::uniform(generator, 0.0, 5.0) * 1i,
-                                     pbpt::random::uniform(generator, 0.0, 5.0) +
-                                         pbpt::random::uniform(generator, 0.0, 5.0) * 1i,
-                                     pbpt::random::uniform(generator, 0.0, 5.0) +
-                                         pbpt::random::uniform(generator, 0.0, 5.0) * 1i,
+                                     pbpt::random::uniform(generator, Scalar(0), Scalar(5)) +
+                                         pbpt::random::uniform(generator, Scalar(0), Scalar(5)) * imaginary_unit,
+                                     pbpt::random::uniform(generator, Scalar(0), Scalar(5)) +
+                                         pbpt::random::uniform(generator, Scalar(0), Scalar(5)) * imaginary_unit,
+                                     pbpt::random::uniform(generator, Scalar(0), Scalar(5)) +
+                                         pbpt::random::uniform(generator, Scalar(0), Scalar(5)) * imaginary_unit,
                                  };
-                                 auto sphere = pbpt::geometry::transform::make_translation(
-                                     pbpt::geometry::primitive::make_ellipsoid(
+                                 auto sphere = pbpt::geometry::transform::make_translation<Scalar>(
+                                     make_sphere(
                                          pbpt::tensor::Vector<Scalar, 3>{0.2, 0.2, 0.2},
-                                         pbpt::material::make_metal(std::move(refractive_index))
+                                         materials.add(pbpt::material::Metal<Scalar>(std::move(refractive_index)))
                                      ),
                                      std::move(position)
                                  );
@@ -154,8 +166,12 @@ inline constexpr auto object = []() constexpr {
           )
       )
   );
+  return std::make_tuple(std::move(object), std::move(materials));
 }();
 
+inline constexpr const auto &object = std::get<0>(scene);
+inline constexpr const auto &materials = std::get<1>(scene);
+
 inline constexpr auto camera = []() constexpr {
   auto vertical_fov = 20.0 / 180.0 * std::numbers::pi;
   auto aspect_ratio = 1.5;
@@ -163,7 +179,7 @@ inline constexpr auto camera = []() constexpr {
   auto aperture_radius = 0.1;
   auto response_function = [](const auto &in_direction, const auto &lens_normal) {
     auto cos_theta = pbpt::tensor::dot(in_direction, lens_normal);
-    return 1.0 / pbpt::math::pow(cos_theta, 4);
+    return pbpt::math::pow<-4>(cos_theta);
   };
 
   pbpt::tensor::Vector<Scalar, 3> position{12.0, -2.0, -4.0};
@@ -182,8 +198,8 @@ inline constexpr auto camera = []() constexpr {
 
 inline constexpr auto background = [](const auto &ray) constexpr {
   return pbpt::math::lerp(
-             pbpt::tensor::get<1>(ray.direction()), -1.0, 1.0, pbpt::tensor::Vector<Scalar, 3>{0.5, 0.75, 1.0},
-             pbpt::tensor::Vector<Scalar, 3>{1.0, 1.0, 1.0}
+             pbpt::tensor::get<1>(ray.direction()), Scalar(-1), Scalar(1),
+             pbpt::tensor::Vector<Scalar, 3>{0.5, 0.75, 1.0}, pbpt::tensor::Vector<Scalar, 3>{1.0, 1.0, 1.0}
          ) *
          ray.weight();
 };
@@ -0,0 +1,61 @@
+#include <array>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <limits>
+
+#include "image/accumulator.hpp"
+#include "tensor.hpp"
+
+// Feeds non-finite samples between finite ones and expects them dropped and counted, with the mean and variance of
+// the pixel those of the finite samples alone.
+
+namespace {
+
+auto num_failures = 0;
+
+auto check(const char *name, bool condition) {
+  if (!condition) {
+    std::cerr << name << std::endl;
+    ++num_failures;
+  }
+}
+
+template <bool Compensated, bool Moments>
+auto check_drops(const char *name) {
+  constexpr auto nan = std::numeric_limits<float>::quiet_NaN();
+  constexpr auto inf = std::numeric_limits<float>::infinity();
+
+  pbpt::image::AccumulationBuffer<float, pbpt::tensor::Vector, Compensated, Moments> buffer(2);
+  buffer.add(0, pbpt::tensor::Vector<float, 3>{1, 2, 3});
+  buffer.add(0, pbpt::tensor::Vector<float, 3>{nan, 2, 3});
+  buffer.add(0, pbpt::tensor::Vector<float, 3>{3, 4, 5});
+  buffer.add(0, pbpt::tensor::Vector<float, 3>{1, -inf, 3});
+  buffer.add(1, pbpt::tensor::Vector<float, 3>{nan, nan, nan});
+
+  auto mean = buffer.mean(0);
+  check(name, buffer.num_dropped() == 3);
+  check(name, buffer.count(0) == 2 && buffer.count(1) == 0);
+  check(name, mean[0] == 2 && mean[1] == 3 && mean[2] == 4);
+  auto empty = buffer.mean(1);
+  check(name, empty[0] == 0 && empty[1] == 0 && empty[2] == 0);
+  if constexpr (Moments) {
+    auto variance = buffer.variance(0);
+    check(name, variance[0] == 2 && variance[1] == 2 && variance[2] == 2);
+  }
+  for (const auto &color : buffer.resolve([](const auto &color) { return color; })) {
+    check(name, std::isfinite(color[0]) && std::isfinite(color[1]) && std::isfinite(color[2]));
+  }
+}
+
+}  // namespace
+
+int main() {
+  check_drops<false, false>("AccumulationBuffer: non-finite sample in the sums");
+  check_drops<true, false>("AccumulationBuffer: non-finite sample in the compensated sums");
+  check_drops<false, true>("AccumulationBuffer: non-finite sample in the moments");
+  check_drops<true, true>("AccumulationBuffer: non-finite sample in the compensated moments");
+
+  if (num_failures) std::cerr << num_failures << " failures" << std::endl;
+  return num_failures ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,62 @@
+#include <cstdlib>
+#include <iostream>
+#include <stdexcept>
+
+#include "material.hpp"
+#include "tensor.hpp"
+
+// Fills the segments of a material table up to their capacities and expects the next material to be refused, and
+// the ids to refer back to the materials they were returned for.
+
+namespace {
+
+auto num_failures = 0;
+
+auto check(const char *name, bool condition) {
+  if (!condition) {
+    std::cerr << name << std::endl;
+    ++num_failures;
+  }
+}
+
+}  // namespace
+
+int main() {
+  using Scalar = double;
+  using Vector = pbpt::tensor::Vector<Scalar, 3>;
+
+  pbpt::material::MaterialTable<Scalar, pbpt::tensor::Vector, 2, 0, 1, 0> materials;
+  auto first = materials.add(pbpt::material::Lambertian<Scalar>(Vector{0.1, 0.2, 0.3}));
+  auto second = materials.add(pbpt::material::Lambertian<Scalar>(Vector{0.4, 0.5, 0.6}));
+  auto glass = materials.add(pbpt::material::Dielectric<Scalar>(1.5));
+  check("add: ids of one type", first.tag() == second.tag() && first.index() == 0 && second.index() == 1);
+  check("add: ids of another type", glass.tag() != first.tag() && glass.index() == 0);
+  check("size", materials.size<0>() == 2 && materials.size<1>() == 0 && materials.size<2>() == 1);
+
+  auto reflectance_of = [&](auto id) {
+    return materials.visit(id, [](const auto &material) -> Vector {
+      if constexpr (requires { material.reflectance(); }) {
+        return material.reflectance();
+      } else {
+        return {};
+      }
+    });
+  };
+  check("visit", reflectance_of(second)[0] == 0.4 && reflectance_of(first)[2] == 0.3);
+
+  auto refused = [&](const auto &material) {
+    try {
+      materials.add(material);
+    } catch (const std::length_error &) {
+      return true;
+    }
+    return false;
+  };
+  check("add: full segment", refused(pbpt::material::Lambertian<Scalar>(Vector{0.7, 0.8, 0.9})));
+  check("add: empty segment", refused(pbpt::material::Metal<Scalar>()));
+  check("add: refusal keeps the size", materials.size<0>() == 2 && materials.size<1>() == 0);
+  check("add: refusal keeps the materials", reflectance_of(second)[0] == 0.4);
+
+  if (num_failures) std::cerr << num_failures << " failures" << std::endl;
+  return num_failures ? EXIT_FAILURE : EXIT_SUCCESS;
+}
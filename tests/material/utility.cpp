@@ -0,0 +1,73 @@
+// the validation mode is what is tested, whatever the build
+#define PBPT_VALIDATE_MATERIALS
+
+#include <complex>
+#include <csignal>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+
+#include "material.hpp"
+#include "optics.hpp"
+#include "random.hpp"
+#include "tensor.hpp"
+
+// Shades with every baked material under PBPT_VALIDATE_MATERIALS, which aborts on any disagreement with the
+// parameters, and then expects the abort once a parameter is edited without a re-bake.
+
+namespace {
+
+using Scalar = double;
+using Vector = pbpt::tensor::Vector<Scalar, 3>;
+using Ray = pbpt::optics::Ray<Scalar, pbpt::tensor::Vector>;
+
+volatile std::sig_atomic_t expecting_abort = false;
+
+auto random_ray(auto &generator) {
+  auto direction = pbpt::random::uniform_on_unit_sphere<Scalar>(generator);
+  // rays arrive from the side of the normal (0, 0, 1)
+  auto [x, y, z] = direction;
+  return Ray(Vector{0, 0, 0}, Vector{x, y, -std::abs(z)}, Scalar(1));
+}
+
+auto shade(const auto &material, auto &generator) {
+  Vector normal{0, 0, 1};
+  for (auto trial = 0; trial < 1000; ++trial) {
+    auto ray = random_ray(generator);
+    material(ray, normal, generator);
+    if constexpr (requires { material.evaluate(-ray.direction(), normal, ray.direction()); }) {
+      auto in_direction = pbpt::random::uniform_on_unit_sphere<Scalar>(generator);
+      material.evaluate(-ray.direction(), normal, in_direction);
+    }
+  }
+}
+
+}  // namespace
+
+int main() {
+  std::mt19937 generator(0);
+
+  pbpt::material::Lambertian<Scalar> lambertian(Vector{0.8, 0.5, 0.2});
+  using Complex = std::complex<Scalar>;
+  pbpt::material::Metal<Scalar> metal(
+      pbpt::tensor::Vector<Complex, 3>{Complex(0.2, 3.9), Complex(0.9, 2.4), Complex(1.1, 2.2)}
+  );
+  pbpt::material::Dielectric<Scalar> dielectric(1.5);
+  shade(lambertian, generator);
+  shade(metal, generator);
+  shade(dielectric, generator);
+
+  // re-baking after an edit keeps the validation quiet
+  lambertian.reflectance() = Vector{0.1, 0.2, 0.3};
+  lambertian.bake();
+  shade(lambertian, generator);
+
+  std::signal(SIGABRT, [](int) {
+    if (expecting_abort) std::_Exit(EXIT_SUCCESS);
+  });
+  expecting_abort = true;
+  dielectric.refractive_index() = 2.4;
+  shade(dielectric, generator);
+  std::cerr << "editing a parameter without bake() went unnoticed" << std::endl;
+  return EXIT_FAILURE;
+}
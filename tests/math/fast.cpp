@@ -0,0 +1,88 @@
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <limits>
+#include <random>
+
+#include "math.hpp"
+
+// Measures the largest errors of the fast kernels against long double references and checks them against the
+// bounds documented in math/fast.hpp.
+
+namespace {
+
+constexpr auto num_arguments = 10'000'000;
+
+auto num_failures = 0;
+
+// Error in units of the last place of the reference rounded to T.
+template <typename T>
+auto ulp_error(T value, long double reference) {
+  auto rounded = static_cast<T>(reference);
+  auto ulp = static_cast<long double>(std::nextafter(std::abs(rounded), std::numeric_limits<T>::infinity())) -
+             std::abs(rounded);
+  if (rounded == 0) ulp = std::numeric_limits<T>::denorm_min();
+  return static_cast<double>(std::abs(static_cast<long double>(value) - reference) / ulp);
+}
+
+auto report(const char *name, const char *type, double error, double bound) {
+  std::cout << name << " (" << type << "): " << error << " ulp, bound " << bound << " ulp" << std::endl;
+  if (!(error <= bound)) {
+    std::cerr << name << " (" << type << ") exceeds its bound" << std::endl;
+    ++num_failures;
+  }
+}
+
+// x uniform in [-max, max]
+template <typename T>
+auto uniform_argument(auto &generator, T max) {
+  return std::uniform_real_distribution<T>(-max, max)(generator);
+}
+
+// x log-uniform over [min, max]
+template <typename T>
+auto log_uniform_argument(auto &generator, T min, T max) {
+  return std::exp2(std::uniform_real_distribution<T>(std::log2(min), std::log2(max))(generator));
+}
+
+template <typename T>
+auto test(const char *type, double sincos_bound, double rsqrt_bound, double sqrt_bound, double cbrt_bound) {
+  std::mt19937_64 generator(0);
+
+  double sincos_error = 0;
+  for (auto index = 0; index < num_arguments; ++index) {
+    // half of the arguments within one turn, where samplers draw them
+    auto x = uniform_argument<T>(generator, index % 2 ? T(65536) : T(4));
+    auto [sin, cos] = pbpt::math::fast_sincos(x);
+    sincos_error = std::max(sincos_error, ulp_error(sin, std::sin(static_cast<long double>(x))));
+    sincos_error = std::max(sincos_error, ulp_error(cos, std::cos(static_cast<long double>(x))));
+  }
+  report("fast_sincos", type, sincos_error, sincos_bound);
+
+  double rsqrt_error = 0, sqrt_error = 0;
+  for (auto index = 0; index < num_arguments; ++index) {
+    auto x = log_uniform_argument<T>(generator, std::numeric_limits<T>::min(), std::numeric_limits<T>::max());
+    auto reference = std::sqrt(static_cast<long double>(x));
+    rsqrt_error = std::max(rsqrt_error, ulp_error(pbpt::math::fast_rsqrt(x), 1 / reference));
+    sqrt_error = std::max(sqrt_error, ulp_error(pbpt::math::fast_sqrt(x), reference));
+  }
+  report("fast_rsqrt", type, rsqrt_error, rsqrt_bound);
+  report("fast_sqrt", type, sqrt_error, sqrt_bound);
+
+  double cbrt_error = 0;
+  for (auto index = 0; index < num_arguments; ++index) {
+    auto x = log_uniform_argument<T>(generator, std::numeric_limits<T>::min(), std::numeric_limits<T>::max() / 3);
+    if (index % 2) x = -x;
+    cbrt_error = std::max(cbrt_error, ulp_error(pbpt::math::fast_cbrt(x), std::cbrt(static_cast<long double>(x))));
+  }
+  report("fast_cbrt", type, cbrt_error, cbrt_bound);
+}
+
+}  // namespace
+
+int main() {
+  test<float>("float", 2, 1.5, 2, 1);
+  test<double>("double", 2.5, 1.5, 2, 1);
+  if (num_failures) std::cerr << num_failures << " failures" << std::endl;
+  return num_failures ? EXIT_FAILURE : EXIT_SUCCESS;
+}
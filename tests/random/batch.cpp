@@ -0,0 +1,123 @@
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <numbers>
+
+#include "random.hpp"
+
+// Checks the lane-parallel generator and the batch samplers by their ranges and first moments.
+
+namespace {
+
+constexpr auto num_lanes = 8;
+constexpr auto num_batches = 1 << 16;
+constexpr auto num_samples = num_lanes * num_batches;
+
+auto num_failures = 0;
+
+// The sample mean of a quantity with the given standard deviation is within 5 standard errors of its expectation.
+auto check_mean(const char *name, double sum, double expected, double deviation) {
+  auto mean = sum / num_samples;
+  auto tolerance = 5 * deviation / std::sqrt(double(num_samples));
+  if (!(std::abs(mean - expected) <= tolerance)) {
+    std::cerr << name << ": mean " << mean << " != " << expected << " +- " << tolerance << std::endl;
+    ++num_failures;
+  }
+}
+
+auto check(const char *name, bool condition) {
+  if (!condition) {
+    std::cerr << name << std::endl;
+    ++num_failures;
+  }
+}
+
+template <typename Scalar>
+auto test() {
+  using namespace pbpt::random::batch;
+  Xoshiro128PlusGenerator<num_lanes> generator(1);
+  auto tolerance = 16 * std::numeric_limits<Scalar>::epsilon();
+
+  double sum = 0, square_sum = 0, lag_sum = 0;
+  // double samples carry more than the 24 bits float samples do
+  auto fine = false;
+  for (auto batch = 0; batch < num_batches; ++batch) {
+    auto unit = uniform<Scalar>(generator, Scalar(0), Scalar(1));
+    for (std::size_t lane = 0; lane < num_lanes; ++lane) {
+      check("uniform: outside [0, 1)", unit[lane] >= 0 && unit[lane] < 1);
+      sum += unit[lane];
+      square_sum += unit[lane] * unit[lane];
+      // neighboring lanes must be independent streams
+      lag_sum += (unit[lane] - 0.5) * (unit[(lane + 1) % num_lanes] - 0.5);
+      auto scaled = double(unit[lane]) * 0x1.0p24;
+      fine = fine || scaled != std::floor(scaled);
+    }
+  }
+  check_mean("uniform", sum, 0.5, std::sqrt(1.0 / 12));
+  check_mean("uniform squared", square_sum, 1.0 / 3, std::sqrt(4.0 / 45));
+  check_mean("uniform lane correlation", lag_sum, 0, 1.0 / 12);
+  check("uniform: no bits below 2^-24", fine == std::is_same_v<Scalar, double>);
+
+  double circle_sum = 0;
+  for (auto batch = 0; batch < num_batches; ++batch) {
+    auto [coord_x, coord_y] = uniform_on_unit_circle<Scalar>(generator);
+    for (std::size_t lane = 0; lane < num_lanes; ++lane) {
+      auto norm = std::hypot(coord_x[lane], coord_y[lane]);
+      check("uniform_on_unit_circle: not unit", std::abs(norm - 1) <= tolerance);
+      circle_sum += coord_x[lane] * coord_x[lane];
+    }
+  }
+  check_mean("uniform_on_unit_circle x^2", circle_sum, 0.5, std::sqrt(1.0 / 8));
+
+  double disk_sum = 0;
+  for (auto batch = 0; batch < num_batches; ++batch) {
+    auto [coord_x, coord_y] = uniform_in_unit_circle<Scalar>(generator);
+    for (std::size_t lane = 0; lane < num_lanes; ++lane) {
+      auto squared_radius = coord_x[lane] * coord_x[lane] + coord_y[lane] * coord_y[lane];
+      check("uniform_in_unit_circle: outside", squared_radius <= 1 + tolerance);
+      disk_sum += squared_radius;
+    }
+  }
+  // r^2 is uniform on the disk
+  check_mean("uniform_in_unit_circle r^2", disk_sum, 0.5, std::sqrt(1.0 / 12));
+
+  double sphere_sum = 0, ball_sum = 0, semisphere_sum = 0, cosine_sum = 0;
+  for (auto batch = 0; batch < num_batches; ++batch) {
+    auto sphere = uniform_on_unit_sphere<Scalar>(generator);
+    auto ball = uniform_in_unit_sphere<Scalar>(generator);
+    auto semisphere = uniform_on_unit_semisphere<Scalar>(generator);
+    auto cosine = cosine_on_unit_semisphere<Scalar>(generator);
+    for (std::size_t lane = 0; lane < num_lanes; ++lane) {
+      auto squared_norm = [&](const auto &samples) {
+        auto [coord_x, coord_y, coord_z] = samples;
+        return double(coord_x[lane]) * coord_x[lane] + double(coord_y[lane]) * coord_y[lane] +
+               double(coord_z[lane]) * coord_z[lane];
+      };
+      check("uniform_on_unit_sphere: not unit", std::abs(squared_norm(sphere) - 1) <= tolerance);
+      check("uniform_in_unit_sphere: outside", squared_norm(ball) <= 1 + tolerance);
+      check("uniform_on_unit_semisphere: not unit", std::abs(squared_norm(semisphere) - 1) <= tolerance);
+      check("cosine_on_unit_semisphere: not unit", std::abs(squared_norm(cosine) - 1) <= tolerance);
+      check("uniform_on_unit_semisphere: below", pbpt::tensor::get<2>(semisphere)[lane] >= 0);
+      check("cosine_on_unit_semisphere: below", pbpt::tensor::get<2>(cosine)[lane] >= 0);
+      sphere_sum += pbpt::tensor::get<2>(sphere)[lane];
+      ball_sum += squared_norm(ball);
+      semisphere_sum += pbpt::tensor::get<2>(semisphere)[lane];
+      cosine_sum += pbpt::tensor::get<2>(cosine)[lane];
+    }
+  }
+  check_mean("uniform_on_unit_sphere z", sphere_sum, 0, std::sqrt(1.0 / 3));
+  // r^3 is uniform in the ball, so E[r^2] = 3/5
+  check_mean("uniform_in_unit_sphere r^2", ball_sum, 0.6, 0.3);
+  check_mean("uniform_on_unit_semisphere z", semisphere_sum, 0.5, std::sqrt(1.0 / 12));
+  // z = cos(theta) with density 2 z, so E[z] = 2/3
+  check_mean("cosine_on_unit_semisphere z", cosine_sum, 2.0 / 3, std::sqrt(1.0 / 18));
+}
+
+}  // namespace
+
+int main() {
+  test<float>();
+  test<double>();
+  if (num_failures) std::cerr << num_failures << " failures" << std::endl;
+  return num_failures ? EXIT_FAILURE : EXIT_SUCCESS;
+}
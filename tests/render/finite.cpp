@@ -0,0 +1,29 @@
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+
+#include "image/pfm.hpp"
+
+// Reads the PFM images given on the command line and fails on one that cannot be read or has a non-finite pixel.
+
+int main(int argc, char *argv[]) {
+  auto num_failures = 0;
+  for (auto argi = 1; argi < argc; ++argi) {
+    auto [colors, width, height] = pbpt::image::read_pfm(argv[argi]);
+    if (!width || !height) {
+      std::cerr << argv[argi] << ": not a PFM image" << std::endl;
+      ++num_failures;
+      continue;
+    }
+    std::size_t num_non_finite = 0;
+    for (const auto &color : colors) {
+      if (!(std::isfinite(color[0]) && std::isfinite(color[1]) && std::isfinite(color[2]))) ++num_non_finite;
+    }
+    if (num_non_finite) {
+      std::cerr << argv[argi] << ": " << num_non_finite << " non-finite pixels" << std::endl;
+      ++num_failures;
+    }
+  }
+  if (num_failures) std::cerr << num_failures << " failures" << std::endl;
+  return num_failures ? EXIT_FAILURE : EXIT_SUCCESS;
+}
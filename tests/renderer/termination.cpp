@@ -0,0 +1,69 @@
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+
+#include "renderer/termination.hpp"
+#include "tensor.hpp"
+
+// Checks the continuation rates of the termination policies and that tracing floor(q) or ceil(q) paths weighted by
+// 1 / q keeps the expected weight at one.
+
+namespace {
+
+auto num_failures = 0;
+
+auto check(const char *name, bool condition) {
+  if (!condition) {
+    std::cerr << name << std::endl;
+    ++num_failures;
+  }
+}
+
+// E[n / q] over n := floor(q) + Bernoulli(q - floor(q)), as the integrators draw it, is 1 within 5 standard errors.
+auto check_unbiased(const char *name, double continuation_rate) {
+  constexpr auto num_trials = 1 << 20;
+  std::mt19937 generator(1);
+  std::uniform_real_distribution<double> uniform(0, 1);
+  double sum = 0;
+  for (auto trial = 0; trial < num_trials; ++trial) {
+    auto num_paths = std::floor(continuation_rate);
+    if (uniform(generator) < continuation_rate - num_paths) ++num_paths;
+    sum += num_paths / continuation_rate;
+  }
+  auto fraction = continuation_rate - std::floor(continuation_rate);
+  auto deviation = std::sqrt(fraction * (1 - fraction)) / continuation_rate;
+  auto tolerance = 5 * deviation / std::sqrt(double(num_trials)) + 1e-12;
+  if (!(std::abs(sum / num_trials - 1) <= tolerance)) {
+    std::cerr << name << ": mean weight " << sum / num_trials << " != 1 +- " << tolerance << std::endl;
+    ++num_failures;
+  }
+}
+
+}  // namespace
+
+int main() {
+  using Vector = pbpt::tensor::Vector<double, 3>;
+
+  pbpt::renderer::RussianRoulette<double> russian_roulette(0.8);
+  check("RussianRoulette: rate depends on depth", russian_roulette(0, Vector{1, 1, 1}) == 0.8);
+  check("RussianRoulette: rate depends on throughput", russian_roulette(10, Vector{0.01, 5, 0}) == 0.8);
+  check("RussianRoulette: default does not terminate", pbpt::renderer::RussianRoulette<double>()(7, Vector{}) == 1);
+  check_unbiased("RussianRoulette", russian_roulette(0, Vector{}));
+
+  pbpt::renderer::AdaptiveRoulette<double> roulette(3, 0.99, 1);
+  check("AdaptiveRoulette: terminates before min_depth", roulette(2, Vector{0.1, 0.2, 0.05}) == 1);
+  check("AdaptiveRoulette: rate is not the max throughput", roulette(3, Vector{0.1, 0.2, 0.05}) == 0.2);
+  check("AdaptiveRoulette: rate exceeds max_probability", roulette(3, Vector{2, 0, 0}) == 0.99);
+  check("AdaptiveRoulette: dark paths survive", roulette(5, Vector{}) == 0);
+  check_unbiased("AdaptiveRoulette", roulette(4, Vector{0.3, 0.1, 0.1}));
+
+  pbpt::renderer::AdaptiveRoulette<double> splitting(3, 0.99, 4);
+  check("AdaptiveRoulette: bright paths are not split", splitting(0, Vector{2.5, 1, 1}) == 2.5);
+  check("AdaptiveRoulette: splits exceed max_splits", splitting(6, Vector{10, 1, 1}) == 4);
+  check("AdaptiveRoulette: dim paths are split", splitting(6, Vector{0.5, 0.5, 0.5}) == 0.5);
+  check_unbiased("AdaptiveRoulette splitting", splitting(6, Vector{2.5, 1, 1}));
+
+  if (num_failures) std::cerr << num_failures << " failures" << std::endl;
+  return num_failures ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,133 @@
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <limits>
+#include <random>
+#include <type_traits>
+
+#include "tensor.hpp"
+
+// Checks the structure-of-arrays batches lane by lane against the same operations on the unbatched tensors, and the
+// masked operations against the lanes they are meant to leave alone.
+
+namespace {
+
+constexpr auto num_lanes = 8;
+
+auto num_failures = 0;
+
+auto check(const char *name, bool condition) {
+  if (!condition) {
+    std::cerr << name << std::endl;
+    ++num_failures;
+  }
+}
+
+template <typename T>
+auto close(T batched, T plain) {
+  return std::abs(batched - plain) <= 8 * std::numeric_limits<T>::epsilon() * (1 + std::abs(plain));
+}
+
+template <typename T, auto N>
+auto close(const pbpt::tensor::Vector<T, N> &batched, const pbpt::tensor::Vector<T, N> &plain) {
+  for (std::size_t index = 0; index < N; ++index) {
+    if (!close(batched[index], plain[index])) return false;
+  }
+  return true;
+}
+
+template <typename T>
+auto test(auto &generator) {
+  using pbpt::tensor::evaluate;
+  using pbpt::tensor::get_lane;
+  using Lanes = pbpt::tensor::Lanes<T, num_lanes>;
+  using Mask = pbpt::tensor::Mask<num_lanes>;
+  using Vector = pbpt::tensor::Vector<T, 3>;
+  using Matrix = pbpt::tensor::Matrix<T, 3, 3>;
+  using VectorBatch = pbpt::tensor::VectorBatch<T, num_lanes, 3>;
+  using MatrixBatch = pbpt::tensor::MatrixBatch<T, num_lanes, 3, 3>;
+
+  static_assert(alignof(Lanes) == std::min<std::size_t>(num_lanes * sizeof(T), 64));
+  static_assert(std::is_same_v<pbpt::tensor::unbatched_t<VectorBatch>, Vector>);
+  static_assert(std::is_same_v<decltype(Mask{} & Mask{}), Mask>);
+  static_assert(std::is_same_v<decltype(Lanes{} < Lanes{}), Mask>);
+
+  std::uniform_real_distribution<T> distribution(-2, 2);
+  for (auto trial = 0; trial < 100; ++trial) {
+    Lanes x, y;
+    VectorBatch a, b;
+    MatrixBatch m;
+    for (std::size_t lane = 0; lane < num_lanes; ++lane) {
+      x[lane] = distribution(generator);
+      y[lane] = distribution(generator) + 3;
+      auto random_vector = [&] {
+        return Vector{distribution(generator), distribution(generator), distribution(generator)};
+      };
+      pbpt::tensor::set_lane(a, lane, random_vector());
+      pbpt::tensor::set_lane(b, lane, evaluate(random_vector() + T(3)));
+      pbpt::tensor::set_lane(m, lane, Matrix{random_vector(), random_vector(), random_vector()});
+    }
+    auto s = distribution(generator);
+
+    // lanes against scalars, with scalars of another type cast to the lane type
+    auto sum = x + y, difference = x - s, product = 2 * x, quotient = x / y;
+    auto less = x < y, greater = x > s;
+    auto all_less = true, any_greater = false;
+    for (std::size_t lane = 0; lane < num_lanes; ++lane) {
+      check("x + y", sum[lane] == x[lane] + y[lane]);
+      check("x - s", difference[lane] == x[lane] - s);
+      check("2 * x", product[lane] == T(2) * x[lane]);
+      check("x / y", quotient[lane] == x[lane] / y[lane]);
+      check("x < y", less[lane] == (x[lane] < y[lane]));
+      check("x > s", greater[lane] == (x[lane] > s));
+      check("x < y & x > s", (less & greater)[lane] == (x[lane] < y[lane] && x[lane] > s));
+      check("!(x > s)", (!greater)[lane] == !(x[lane] > s));
+      check("-x", (-x)[lane] == -x[lane]);
+      all_less = all_less && x[lane] < y[lane];
+      any_greater = any_greater || x[lane] > s;
+    }
+    check("all", pbpt::tensor::all(less) == all_less);
+    check("any", pbpt::tensor::any(greater) == any_greater);
+    check("none", pbpt::tensor::none(greater) == !any_greater);
+
+    // tensors against tensors
+    auto c = evaluate(a + b * s);
+    auto d = pbpt::tensor::dot(a, b);
+    auto e = pbpt::tensor::cross(a, b);
+    auto n = pbpt::tensor::normalized(b);
+    auto f = pbpt::tensor::elemwise([](auto x) { return x * x; }, a);
+    auto g = evaluate(m % a);
+    for (std::size_t lane = 0; lane < num_lanes; ++lane) {
+      auto a_lane = get_lane(a, lane), b_lane = get_lane(b, lane);
+      auto m_lane = get_lane(m, lane);
+      check("a + b * s", close(get_lane(c, lane), evaluate(a_lane + b_lane * s)));
+      check("dot", close(d[lane], pbpt::tensor::dot(a_lane, b_lane)));
+      check("cross", close(get_lane(e, lane), pbpt::tensor::cross(a_lane, b_lane)));
+      check("normalized", close(get_lane(n, lane), evaluate(pbpt::tensor::normalized(b_lane))));
+      check("elemwise", close(get_lane(f, lane), evaluate(a_lane * a_lane)));
+      check("matrix %", close(get_lane(g, lane), evaluate(m_lane % a_lane)));
+    }
+
+    // masked operations touch only the selected lanes
+    auto mask = x > 0;
+    auto selected = pbpt::tensor::select(mask, a, b);
+    auto assigned = b;
+    pbpt::tensor::masked_assign(mask, assigned, a);
+    for (std::size_t lane = 0; lane < num_lanes; ++lane) {
+      auto expected = mask[lane] ? get_lane(a, lane) : get_lane(b, lane);
+      check("select", get_lane(selected, lane) == expected);
+      check("masked_assign", get_lane(assigned, lane) == expected);
+    }
+  }
+}
+
+}  // namespace
+
+int main() {
+  std::mt19937 generator(0);
+  test<float>(generator);
+  test<double>(generator);
+  if (num_failures) std::cerr << num_failures << " failures" << std::endl;
+  return num_failures ? EXIT_FAILURE : EXIT_SUCCESS;
+}
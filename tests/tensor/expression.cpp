@@ -0,0 +1,110 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <limits>
+#include <random>
+#include <type_traits>
+
+#include "tensor.hpp"
+
+// Checks the lazy expressions element by element against the eager operators, that assigning an expression to one
+// of its own operands reads the operands before writing, and that lvalue operands are read when the expression is
+// evaluated while rvalue operands are captured when it is built.
+
+namespace {
+
+auto num_failures = 0;
+
+// the two sides may contract into different fused multiply-adds, so they agree up to rounding of the terms, whose
+// magnitude a sum of products of different signs exceeds
+template <typename T>
+auto check(const char *name, T lazy, T eager, T magnitude = 0) {
+  magnitude = std::max(magnitude, std::abs(eager));
+  if (!(std::abs(lazy - eager) <= 8 * std::numeric_limits<T>::epsilon() * (1 + magnitude))) {
+    std::cerr << name << ": " << lazy << " != " << eager << std::endl;
+    ++num_failures;
+  }
+}
+
+template <typename T, auto N>
+auto check(const char *name, const pbpt::tensor::Vector<T, N> &lazy, const pbpt::tensor::Vector<T, N> &eager) {
+  for (std::size_t index = 0; index < N; ++index) check(name, lazy[index], eager[index]);
+}
+
+template <typename T, auto N>
+auto test(auto &generator) {
+  using Vector = pbpt::tensor::Vector<T, N>;
+  using pbpt::tensor::evaluate;
+  using pbpt::tensor::lazy;
+
+  std::uniform_real_distribution<T> distribution(-2, 2);
+  for (auto trial = 0; trial < 100; ++trial) {
+    Vector a, b, c;
+    for (std::size_t index = 0; index < N; ++index) {
+      a[index] = distribution(generator);
+      b[index] = distribution(generator);
+      c[index] = distribution(generator) + 3;
+    }
+    auto s = distribution(generator);
+    auto square = [](auto x) constexpr { return x * x; };
+    auto magnitude = [](const auto &tensor) {
+      return pbpt::tensor::elemwise([](auto x) { return std::abs(x); }, tensor);
+    };
+
+    static_assert(std::is_same_v<decltype(evaluate(lazy(a) + b)), Vector>);
+    check("a + b", evaluate(lazy(a) + b), evaluate(a + b));
+    check("a - b", evaluate(lazy(a) - b), evaluate(a - b));
+    check("a * b", evaluate(lazy(a) * b), evaluate(a * b));
+    check("a / c", evaluate(lazy(a) / c), evaluate(a / c));
+    check("s * a - b", evaluate(s * lazy(a) - b), evaluate(s * a - b));
+    check("a / s + c", evaluate(lazy(a) / s + c), evaluate(a / s + c));
+    check("a + b * c", evaluate(lazy(a) + lazy(b) * c), evaluate(a + b * c));
+    check("(a - b) / (c * s)", evaluate((lazy(a) - b) / (lazy(c) * s)), evaluate((a - b) / (c * s)));
+    check("elemwise", evaluate(pbpt::tensor::elemwise(square, lazy(a) - b)), pbpt::tensor::elemwise(square, a - b));
+    check(
+        "sum", pbpt::tensor::sum(lazy(a) * c), pbpt::tensor::sum(evaluate(a * c)),
+        pbpt::tensor::sum(evaluate(magnitude(a) * magnitude(c)))
+    );
+    check("prod", pbpt::tensor::prod(lazy(c) + s), pbpt::tensor::prod(evaluate(c + s)));
+    check(
+        "dot", pbpt::tensor::dot(lazy(a) + b, c), pbpt::tensor::dot(evaluate(a + b), c),
+        pbpt::tensor::dot(evaluate(magnitude(a) + magnitude(b)), magnitude(c))
+    );
+    check("norm", pbpt::tensor::norm(lazy(a) - b), pbpt::tensor::norm(evaluate(a - b)));
+    check("normalized", evaluate(pbpt::tensor::normalized(lazy(c) - a)), pbpt::tensor::normalized(evaluate(c - a)));
+
+    // conversion on assignment
+    Vector assigned = lazy(a) * s + c;
+    check("assignment", assigned, evaluate(a * s + c));
+
+    // every element is computed before the target is written, so the target may be an operand
+    auto aliased = a;
+    aliased = lazy(aliased) * b + aliased;
+    check("aliased assignment", aliased, evaluate(a * b + a));
+
+    // lvalue operands are referred to and read on evaluation
+    auto operand = a;
+    auto referring = lazy(operand) + b;
+    operand = c;
+    check("lvalue operand", evaluate(referring), evaluate(c + b));
+
+    // rvalue operands are captured when the expression is built, and survive the end of the full expression
+    auto owning = lazy(evaluate(a + c)) - b;
+    check("rvalue operand", evaluate(owning), evaluate(a + c - b));
+
+    // an expression evaluates anew on every materialization
+    check("re-evaluation", evaluate(referring), evaluate(referring));
+  }
+}
+
+}  // namespace
+
+int main() {
+  std::mt19937 generator(0);
+  test<float, 3>(generator);
+  test<double, 3>(generator);
+  test<double, 5>(generator);
+  if (num_failures) std::cerr << num_failures << " failures" << std::endl;
+  return num_failures ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,87 @@
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <new>
+#include <random>
+
+#include "tensor.hpp"
+
+// Checks the SIMD storage backend lane by lane against the plain std::array tensors.
+
+namespace {
+
+auto num_failures = 0;
+
+template <typename T, auto N>
+auto check(const char *name, const pbpt::tensor::SimdVector<T, N> &simd, const auto &plain) {
+  for (std::size_t index = 0; index < N; ++index) {
+    auto expected = static_cast<T>(plain[index]);
+    if (std::abs(simd[index] - expected) > 4 * std::numeric_limits<T>::epsilon() * (1 + std::abs(expected))) {
+      std::cerr << name << "[" << index << "]: " << simd[index] << " != " << expected << std::endl;
+      ++num_failures;
+    }
+  }
+  for (std::size_t index = N; index < pbpt::tensor::SimdArray<T, N>::width; ++index) {
+    if (simd.data()[index] != 0) {
+      std::cerr << name << ": padding lane " << index << " is " << simd.data()[index] << std::endl;
+      ++num_failures;
+    }
+  }
+}
+
+template <typename T>
+auto check(const char *name, T simd, T plain) {
+  if (!(std::abs(simd - plain) <= 8 * std::numeric_limits<T>::epsilon() * (1 + std::abs(plain)))) {
+    std::cerr << name << ": " << simd << " != " << plain << std::endl;
+    ++num_failures;
+  }
+}
+
+template <typename T, auto N>
+auto test(auto &generator) {
+  std::uniform_real_distribution<T> distribution(-2, 2);
+  for (auto trial = 0; trial < 100; ++trial) {
+    // storage reused from garbage must not leak into the padding lanes
+    alignas(pbpt::tensor::SimdVector<T, N>) unsigned char storage_1[sizeof(pbpt::tensor::SimdVector<T, N>)];
+    alignas(pbpt::tensor::SimdVector<T, N>) unsigned char storage_2[sizeof(pbpt::tensor::SimdVector<T, N>)];
+    std::memset(storage_1, 0x7f, sizeof(storage_1));
+    std::memset(storage_2, 0x7f, sizeof(storage_2));
+    auto &simd_1 = *new (storage_1) pbpt::tensor::SimdVector<T, N>;
+    auto &simd_2 = *new (storage_2) pbpt::tensor::SimdVector<T, N>;
+    pbpt::tensor::Vector<T, N> plain_1, plain_2;
+    for (std::size_t index = 0; index < N; ++index) {
+      simd_1[index] = plain_1[index] = distribution(generator);
+      simd_2[index] = plain_2[index] = distribution(generator) + 3;
+    }
+    auto scalar = distribution(generator);
+
+    check("a + b", simd_1 + simd_2, pbpt::tensor::evaluate(plain_1 + plain_2));
+    check("a - b", simd_1 - simd_2, pbpt::tensor::evaluate(plain_1 - plain_2));
+    check("a * b", simd_1 * simd_2, pbpt::tensor::evaluate(plain_1 * plain_2));
+    check("a / b", simd_1 / simd_2, pbpt::tensor::evaluate(plain_1 / plain_2));
+    check("a + s", simd_1 + scalar, pbpt::tensor::evaluate(plain_1 + scalar));
+    check("s - a", scalar - simd_1, pbpt::tensor::evaluate(scalar - plain_1));
+    check("s * a", scalar * simd_1, pbpt::tensor::evaluate(scalar * plain_1));
+    check("a / s", simd_1 / scalar, pbpt::tensor::evaluate(plain_1 / scalar));
+    check("dot", pbpt::tensor::dot(simd_1, simd_2), pbpt::tensor::dot(plain_1, plain_2));
+    check("normalized", pbpt::tensor::normalized(simd_2), pbpt::tensor::evaluate(pbpt::tensor::normalized(plain_2)));
+    if constexpr (N == 3) {
+      check("cross", pbpt::tensor::cross(simd_1, simd_2), pbpt::tensor::cross(plain_1, plain_2));
+    }
+  }
+}
+
+}  // namespace
+
+int main() {
+  std::mt19937 generator(0);
+  test<float, 3>(generator);
+  test<float, 4>(generator);
+  test<float, 5>(generator);
+  test<double, 3>(generator);
+  test<double, 4>(generator);
+  test<double, 7>(generator);
+  if (num_failures) std::cerr << num_failures << " failures" << std::endl;
+  return num_failures ? EXIT_FAILURE : EXIT_SUCCESS;
+}